@@ -75,7 +75,11 @@ def _ToProbeConnectionFlow(
 def EstimateProbeTopologyFlow(
         probes: List[PopulationProbe],
         connections: List[ProbeConnection],
-        iteration_count: int) -> List[ProbeConnectionFlow]:
+        iteration_count: int,
+        reorder_probes: bool = False,
+        origin_sample_count: int = 0,
+        origin_cluster_radius: float = 0.0,
+        use_contraction_hierarchy: bool = False) -> List[ProbeConnectionFlow]:
     """It estimates the directed transportation flow over the connections. It
     uses an iterative algorithm to simulate and measure the flow. The estimate
     converges as more iterations are run.
@@ -86,17 +90,244 @@ def EstimateProbeTopologyFlow(
         connections (List[ProbeConnection]): THe undirected connections to
             estimate flow values upon.
         iteration_count (int): The number of iteration to run.
+        reorder_probes (bool, optional): Whether to internally permute the
+            probes along a Hilbert curve for memory locality. The flows still
+            refer to the order of the specified probes. Defaults to False.
+        origin_sample_count (int, optional): When positive, every iteration
+            simulates only this many origins, sampled afresh by population,
+            instead of every probe. Defaults to 0.
+        origin_cluster_radius (float, optional): When positive, the origins
+            within this many meters of each other share a shortest path tree.
+            It can't be combined with origin_sample_count, nor exceed 3000
+            meters. Defaults to 0.
+        use_contraction_hierarchy (bool, optional): Whether the exact
+            shortest paths are computed over a contraction hierarchy, which
+            is built once and customized on every iteration. It pays off on
+            large networks, and can't be combined with the approximations
+            above. Defaults to False.
 
     Returns:
         List[ProbeConnectionFlow]: The flow value of each directed connection.
+
+    Raises:
+        ValueError: When more than one of origin_sample_count,
+            origin_cluster_radius and use_contraction_hierarchy is set, or
+            when origin_cluster_radius exceeds 3000 meters.
     """
     internal_probes = _ToInternalProbes(probes)
     internal_connections = _ToInternalConnections(connections)
     internal_connection_flows = e8citydll.EstimateProbeTopologyFlow(
-        internal_probes, internal_connections, iteration_count)
+        internal_probes, internal_connections, iteration_count,
+        reorder_probes, origin_sample_count, origin_cluster_radius,
+        use_contraction_hierarchy)
     return _ToProbeConnectionFlow(internal_connection_flows)
 
 
+def EstimateProbeTopologyFlowScenarios(
+        probes: List[PopulationProbe],
+        connections: List[ProbeConnection],
+        scenario_populations: List[List[float]],
+        iteration_count: int,
+        reorder_probes: bool = False) -> List[List[ProbeConnectionFlow]]:
+    """Same as EstimateProbeTopologyFlow(), except that several demand
+    scenarios, e.g. peak hours or growth scenarios, are estimated over the
+    same connections together. The scenarios whose travel times coincide
+    share their shortest path searches, so it costs much less than
+    estimating them one by one.
+
+    Args:
+        probes (List[PopulationProbe]): The population probes connected by the
+            connections.
+        connections (List[ProbeConnection]): The undirected connections to
+            estimate flow values upon.
+        scenario_populations (List[List[float]]): The population of each
+            probe in each scenario, which stands in for population_grid_200.
+        iteration_count (int): The number of iteration to run.
+        reorder_probes (bool, optional): Whether to internally permute the
+            probes along a Hilbert curve for memory locality. The flows still
+            refer to the order of the specified probes. Defaults to False.
+
+    Returns:
+        List[List[ProbeConnectionFlow]]: The flow value of each directed
+            connection, for each scenario in order.
+    """
+    internal_probes = _ToInternalProbes(probes)
+    internal_connections = _ToInternalConnections(connections)
+    internal_scenario_flows = e8citydll.EstimateProbeTopologyFlowScenarios(
+        internal_probes, internal_connections, scenario_populations,
+        iteration_count, reorder_probes)
+    return [_ToProbeConnectionFlow(internal_connection_flows)
+            for internal_connection_flows in internal_scenario_flows]
+
+
+@dataclass(eq=True, frozen=True)
+class ProbeTopologyFlowEquilibrium:
+    """The flow estimate of an equilibrium solve.
+    """
+
+    # The flow value of each directed connection.
+    flows: List[ProbeConnectionFlow]
+
+    # The number of iterations actually run.
+    iteration_count: int
+
+    # The number of simulated flows the flows are the average of, including
+    # the ones a warm start stands for. It's the prior_iteration_count to
+    # re-estimate from these flows with.
+    averaged_iteration_count: int
+
+    # The relative gap of the flows. It vanishes at the equilibrium.
+    relative_gap: float
+
+    # The relative change of the flows made by each iteration. The iteration
+    # which reaches the tolerance leaves the flows unchanged and has no entry.
+    flow_changes: List[float]
+
+
+def _ToProbeTopologyFlowEquilibrium(
+        internal_result: e8citydll.ProbeTopologyFlowResult) -> \
+        ProbeTopologyFlowEquilibrium:
+    return ProbeTopologyFlowEquilibrium(
+        flows=_ToProbeConnectionFlow(internal_result.flows),
+        iteration_count=internal_result.iteration_count,
+        averaged_iteration_count=internal_result.averaged_iteration_count,
+        relative_gap=internal_result.relative_gap,
+        flow_changes=list(internal_result.flow_changes))
+
+
+def EstimateProbeTopologyFlowEquilibrium(
+        probes: List[PopulationProbe],
+        connections: List[ProbeConnection],
+        max_iteration_count: int,
+        tolerance: float,
+        reorder_probes: bool = False,
+        origin_sample_count: int = 0,
+        origin_cluster_radius: float = 0.0,
+        use_contraction_hierarchy: bool = False
+) -> ProbeTopologyFlowEquilibrium:
+    """Same as EstimateProbeTopologyFlow(), except that the flows are driven
+    to the equilibrium by the method of successive averages, and the
+    iterations stop once the relative gap drops to the tolerance.
+
+    Args:
+        probes (List[PopulationProbe]): The population probes connected by the
+            connections.
+        connections (List[ProbeConnection]): The undirected connections to
+            estimate flow values upon.
+        max_iteration_count (int): The maximum number of iterations to run.
+        tolerance (float): The relative gap at which the iterations stop.
+        reorder_probes (bool, optional): Whether to internally permute the
+            probes along a Hilbert curve for memory locality. The flows still
+            refer to the order of the specified probes. Defaults to False.
+        origin_sample_count (int, optional): When positive, every iteration
+            simulates only this many origins, sampled afresh by population,
+            instead of every probe. Defaults to 0.
+        origin_cluster_radius (float, optional): When positive, the origins
+            within this many meters of each other share a shortest path tree.
+            It can't be combined with origin_sample_count, nor exceed 3000
+            meters. Defaults to 0.
+        use_contraction_hierarchy (bool, optional): Whether the exact
+            shortest paths are computed over a contraction hierarchy, which
+            is built once and customized on every iteration. It pays off on
+            large networks, and can't be combined with the approximations
+            above. Defaults to False.
+
+    Returns:
+        ProbeTopologyFlowEquilibrium: The flow value of each directed
+            connection, along with the number of iterations run and the gap
+            reached.
+
+    Raises:
+        ValueError: When more than one of origin_sample_count,
+            origin_cluster_radius and use_contraction_hierarchy is set, or
+            when origin_cluster_radius exceeds 3000 meters.
+    """
+    internal_probes = _ToInternalProbes(probes)
+    internal_connections = _ToInternalConnections(connections)
+    internal_result = e8citydll.EstimateProbeTopologyFlowEquilibrium(
+        internal_probes, internal_connections, max_iteration_count, tolerance,
+        reorder_probes, origin_sample_count, origin_cluster_radius,
+        use_contraction_hierarchy)
+    return _ToProbeTopologyFlowEquilibrium(internal_result)
+
+
+def _ToInternalConnectionFlows(
+        flows: List[ProbeConnectionFlow]) -> \
+        List[e8citydll.ProbeConnectionFlow]:
+    internal_flows = list()
+    for flow in flows:
+        internal_flows.append(e8citydll.ProbeConnectionFlow(
+            flow.src_probe_index, flow.dst_probe_index, flow.flow,
+            flow.lane_count))
+    return internal_flows
+
+
+def ReestimateProbeTopologyFlow(
+        probes: List[PopulationProbe],
+        connections: List[ProbeConnection],
+        previous_flows: List[ProbeConnectionFlow],
+        prior_iteration_count: int,
+        max_iteration_count: int,
+        tolerance: float,
+        reorder_probes: bool = False,
+        origin_sample_count: int = 0,
+        origin_cluster_radius: float = 0.0,
+        use_contraction_hierarchy: bool = False
+) -> ProbeTopologyFlowEquilibrium:
+    """Same as EstimateProbeTopologyFlowEquilibrium(), except that the flows
+    start from a previous solution over a different set of connections, e.g.
+    after a few streets have been added or removed. The connections which
+    persist keep their previous flows and lane counts, and the averaging
+    carries on from them.
+
+    Args:
+        probes (List[PopulationProbe]): The population probes connected by the
+            connections.
+        connections (List[ProbeConnection]): The edited undirected
+            connections to estimate flow values upon.
+        previous_flows (List[ProbeConnectionFlow]): The flows estimated
+            before the connections were edited.
+        prior_iteration_count (int): The number of simulated flows the
+            previous flows weigh as much as the average of, usually the
+            averaged_iteration_count of the solve which produced them.
+        max_iteration_count (int): The maximum number of iterations to run.
+        tolerance (float): The relative gap at which the iterations stop.
+        reorder_probes (bool, optional): Whether to internally permute the
+            probes along a Hilbert curve for memory locality. The flows still
+            refer to the order of the specified probes. Defaults to False.
+        origin_sample_count (int, optional): When positive, every iteration
+            simulates only this many origins, sampled afresh by population,
+            instead of every probe. Defaults to 0.
+        origin_cluster_radius (float, optional): When positive, the origins
+            within this many meters of each other share a shortest path tree.
+            It can't be combined with origin_sample_count, nor exceed 3000
+            meters. Defaults to 0.
+        use_contraction_hierarchy (bool, optional): Whether the exact
+            shortest paths are computed over a contraction hierarchy, which
+            is built once and customized on every iteration. It pays off on
+            large networks, and can't be combined with the approximations
+            above. Defaults to False.
+
+    Returns:
+        ProbeTopologyFlowEquilibrium: The flow value of each directed
+            connection, along with the number of iterations run and the gap
+            reached.
+
+    Raises:
+        ValueError: When more than one of origin_sample_count,
+            origin_cluster_radius and use_contraction_hierarchy is set, or
+            when origin_cluster_radius exceeds 3000 meters.
+    """
+    internal_probes = _ToInternalProbes(probes)
+    internal_connections = _ToInternalConnections(connections)
+    internal_previous_flows = _ToInternalConnectionFlows(previous_flows)
+    internal_result = e8citydll.ReestimateProbeTopologyFlow(
+        internal_probes, internal_connections, internal_previous_flows,
+        prior_iteration_count, max_iteration_count, tolerance, reorder_probes,
+        origin_sample_count, origin_cluster_radius, use_contraction_hierarchy)
+    return _ToProbeTopologyFlowEquilibrium(internal_result)
+
+
 def VisualizeProbeTopologyFlow(probes: List[PopulationProbe],
                                flows: List[ProbeConnectionFlow],
                                figure: Figure,
@@ -0,0 +1,112 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/flow/cluster.hpp"
+#include "procedural/probing/flow/network.hpp"
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+unsigned const kUnassigned = std::numeric_limits<unsigned>::max();
+
+using DistanceAndVertex = std::pair<float, unsigned>;
+
+// Assigns the unassigned vertices within radius meters of the representative
+// to its cluster, by a Dijkstra search bounded by the radius. The distances
+// of the visited vertices are reset on return.
+void GrowCluster(unsigned representative, unsigned cluster, float radius,
+                 FlowNetwork const &network, std::vector<float> *distances,
+                 std::vector<unsigned> *clusters,
+                 std::vector<unsigned> *members) {
+  std::vector<unsigned> visited;
+  std::priority_queue<DistanceAndVertex, std::vector<DistanceAndVertex>,
+                      std::greater<DistanceAndVertex>>
+      queue;
+
+  (*distances)[representative] = 0;
+  visited.push_back(representative);
+  queue.push(std::make_pair(0.0f, representative));
+  while (!queue.empty()) {
+    auto [distance, u] = queue.top();
+    queue.pop();
+    if (distance > (*distances)[u]) {
+      // Outdated entry.
+      continue;
+    }
+
+    (*clusters)[u] = cluster;
+    members->push_back(u);
+
+    for (auto [current, end] = boost::out_edges(u, network.graph);
+         current != end; ++current) {
+      unsigned v = boost::target(*current, network.graph);
+      unsigned id = boost::get(boost::edge_index, network.graph, *current);
+      float v_distance = distance + network.distances[id];
+      if ((*clusters)[v] != kUnassigned || v_distance > radius ||
+          v_distance >= (*distances)[v]) {
+        continue;
+      }
+      if ((*distances)[v] == std::numeric_limits<float>::max()) {
+        visited.push_back(v);
+      }
+      (*distances)[v] = v_distance;
+      queue.push(std::make_pair(v_distance, v));
+    }
+  }
+
+  for (unsigned v : visited) {
+    (*distances)[v] = std::numeric_limits<float>::max();
+  }
+}
+
+} // namespace
+
+unsigned OriginClusters::ClusterCount() const { return offsets.size() - 1; }
+
+OriginClusters ClusterOrigins(FlowNetwork const &network, float radius) {
+  assert(radius >= 0);
+
+  unsigned vertex_count = network.VertexCount();
+  std::vector<unsigned> clusters(vertex_count, kUnassigned);
+  std::vector<float> distances(vertex_count,
+                               std::numeric_limits<float>::max());
+
+  OriginClusters result;
+  result.offsets.push_back(0);
+  result.members.reserve(vertex_count);
+  for (unsigned v = 0; v < vertex_count; ++v) {
+    if (clusters[v] != kUnassigned) {
+      continue;
+    }
+    GrowCluster(/*representative=*/v, /*cluster=*/result.ClusterCount(),
+                radius, network, &distances, &clusters, &result.members);
+    result.offsets.push_back(result.members.size());
+  }
+
+  assert(result.members.size() == vertex_count);
+  return result;
+}
+
+} // namespace procedural
+} // namespace e8
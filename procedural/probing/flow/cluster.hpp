@@ -0,0 +1,44 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "procedural/probing/flow/network.hpp"
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// Groups of nearby origins which share one shortest path tree, rooted at the
+// representative of the group. The members of cluster i are
+// members[offsets[i]] to members[offsets[i + 1] - 1], the first of which is
+// the representative.
+struct OriginClusters {
+  unsigned ClusterCount() const;
+
+  std::vector<unsigned> offsets;
+  std::vector<unsigned> members;
+};
+
+// Clusters every vertex of the network. The vertices are visited in the order
+// of their IDs, so that a spatially coherent ordering, such as the Hilbert
+// curve ordering, gives compact clusters. Each unassigned vertex becomes a
+// representative, then takes on every unassigned vertex within radius meters
+// of network distance. A zero radius leaves every vertex on its own.
+OriginClusters ClusterOrigins(FlowNetwork const &network, float radius);
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,66 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/flow/cluster.hpp"
+#include "procedural/probing/flow/network.hpp"
+#include "procedural/probing/probe/probe.hpp"
+#include <boost/test/unit_test.hpp>
+#include <eigen3/Eigen/Core>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+// A line of probes 100 meters apart.
+FlowNetwork CreateLineNetwork(unsigned probe_count) {
+  std::vector<PopulationProbe> probes;
+  std::vector<std::pair<unsigned, unsigned>> connections;
+  for (unsigned i = 0; i < probe_count; ++i) {
+    probes.push_back(PopulationProbe(Eigen::Vector3f(i * 100, 0, 0),
+                                     /*population_grid_200=*/1.f));
+    if (i > 0) {
+      connections.push_back(std::make_pair(i - 1, i));
+    }
+  }
+  return CreateFlowNetwork(probes, connections);
+}
+
+BOOST_AUTO_TEST_CASE(WhenRadiusIsZero_ThenCheckEveryOriginIsAlone) {
+  FlowNetwork network = CreateLineNetwork(/*probe_count=*/5);
+  OriginClusters clusters = ClusterOrigins(network, /*radius=*/0);
+
+  BOOST_CHECK_EQUAL(5, clusters.ClusterCount());
+  BOOST_CHECK((std::vector<unsigned>{0, 1, 2, 3, 4, 5}) == clusters.offsets);
+  BOOST_CHECK((std::vector<unsigned>{0, 1, 2, 3, 4}) == clusters.members);
+}
+
+BOOST_AUTO_TEST_CASE(WhenRadiusSpansNeighbors_ThenCheckClusters) {
+  FlowNetwork network = CreateLineNetwork(/*probe_count=*/7);
+  OriginClusters clusters = ClusterOrigins(network, /*radius=*/250);
+
+  // Each representative takes on the next two probes.
+  BOOST_CHECK_EQUAL(3, clusters.ClusterCount());
+  BOOST_CHECK((std::vector<unsigned>{0, 3, 6, 7}) == clusters.offsets);
+  BOOST_CHECK((std::vector<unsigned>{0, 1, 2, 3, 4, 5, 6}) ==
+              clusters.members);
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
@@ -15,67 +15,293 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/flow/flow.hpp"
+#include "procedural/probing/flow/cluster.hpp"
+#include "procedural/probing/flow/hierarchy.hpp"
+#include "procedural/probing/flow/network.hpp"
 #include "procedural/probing/flow/simulate.hpp"
-#include "procedural/probing/flow/topology.hpp"
+#include "procedural/probing/flow/time_cost.hpp"
 #include "procedural/probing/flow/update.hpp"
+#include "procedural/probing/probe/ordering.hpp"
 #include "procedural/probing/probe/probe.hpp"
+#include "procedural/probing/random/philox.hpp"
+#include "procedural/probing/topology/sampler.hpp"
 #include "procedural/probing/topology/topology.hpp"
-#include <boost/graph/adjacency_list.hpp>
+#include <algorithm>
+#include <boost/graph/compressed_sparse_row_graph.hpp>
 #include <boost/log/trivial.hpp>
 #include <cassert>
+#include <optional>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace e8 {
 namespace procedural {
 namespace {
 
-TopologyFlow ToFlow(std::vector<PopulationProbe> const &probes,
-                    std::vector<ProbeConnection> const &connections) {
-  TopologyFlow flow(probes.size());
+unsigned long const kSeed = 13L;
+
+// The access legs within a cluster stand in for the members' own paths, so
+// they must stay small next to the one hour travel time horizon. It takes
+// about 6 minutes to cover 3 km at the lowest speed.
+float const kMaxOriginClusterRadiusMeters = 3000.0f;
+
+// How the flows are simulated. The approximations and the contraction
+// hierarchy are all off by default, and at most one of them is on.
+struct FlowSimulationOptions {
+  // When positive, the number of origins sampled by population on every
+  // iteration. The sampling noise is then smoothed out by the averaging of the
+  // iterations.
+  unsigned origin_sample_count;
+
+  // When positive, the radius in meters within which the origins are
+  // clustered to share a shortest path tree.
+  float origin_cluster_radius;
+
+  // Whether the exact shortest paths are computed over a contraction
+  // hierarchy, which is built once and customized on every iteration.
+  bool use_contraction_hierarchy;
+};
+
+// The options come straight from the callers, so they are checked in release
+// builds as well.
+void CheckFlowSimulationOptions(FlowSimulationOptions const &options) {
+  unsigned enabled_count = (options.origin_sample_count > 0) +
+                           (options.origin_cluster_radius > 0) +
+                           options.use_contraction_hierarchy;
+  if (enabled_count > 1) {
+    throw std::invalid_argument(
+        "origin_sample_count, origin_cluster_radius and "
+        "use_contraction_hierarchy can't be combined.");
+  }
+  if (options.origin_cluster_radius > kMaxOriginClusterRadiusMeters) {
+    throw std::invalid_argument(
+        "origin_cluster_radius must not exceed 3000 meters.");
+  }
+}
+
+// Simulates the flows from every probe, or from the origins the approximation
+// selects.
+class FlowSimulator {
+public:
+  FlowSimulator(FlowNetwork const &network,
+                FlowSimulationOptions const &options)
+      : network_(network) {
+    CheckFlowSimulationOptions(options);
+
+    if (options.origin_sample_count > 0) {
+      origin_sampler_.emplace(network.population, options.origin_sample_count,
+                              PhiloxEngine(kSeed));
+    }
+    if (options.origin_cluster_radius > 0) {
+      origin_clusters_ = ClusterOrigins(network, options.origin_cluster_radius);
+    }
+    if (options.use_contraction_hierarchy) {
+      hierarchy_ = CreateContractionHierarchy(network);
+    }
+  }
+
+  FlowSimulator(FlowSimulator const &) = delete;
+
+  void Simulate(FlowState const &current, std::vector<float> *simulated_flow) {
+    if (origin_sampler_.has_value()) {
+      origin_sampler_->UpdateSamples();
+      SimulateFlow(network_, current, *origin_sampler_, simulated_flow);
+    } else if (origin_clusters_.has_value()) {
+      SimulateFlow(network_, current, *origin_clusters_, simulated_flow);
+    } else if (hierarchy_.has_value()) {
+      SimulateFlow(network_, current, *hierarchy_, simulated_flow);
+    } else {
+      SimulateFlow(network_, current, simulated_flow);
+    }
+  }
+
+private:
+  FlowNetwork const &network_;
+  std::optional<SourceImportanceSampler> origin_sampler_;
+  std::optional<OriginClusters> origin_clusters_;
+  std::optional<ContractionHierarchy> hierarchy_;
+};
+
+FlowNetwork ToFlow(std::vector<PopulationProbe> const &probes,
+                   std::vector<ProbeConnection> const &connections,
+                   ProbeOrdering const &ordering) {
+  std::vector<std::pair<unsigned, unsigned>> reordered_connections;
+  reordered_connections.reserve(connections.size());
   for (auto const &connection : connections) {
-    assert(connection.src_probe_index < boost::num_vertices(flow));
-    assert(connection.dst_probe_index < boost::num_vertices(flow));
-
-    FlowProperties properties(/*flow=*/0, /*lane_count=*/1);
-    bool successful1 =
-        boost::add_edge(connection.src_probe_index, connection.dst_probe_index,
-                        properties, flow)
-            .second;
-    bool successful2 =
-        boost::add_edge(connection.dst_probe_index, connection.src_probe_index,
-                        properties, flow)
-            .second;
-    assert(successful1);
-    assert(successful2);
+    assert(connection.src_probe_index < probes.size());
+    assert(connection.dst_probe_index < probes.size());
+
+    reordered_connections.push_back(
+        std::make_pair(ordering.to_reordered[connection.src_probe_index],
+                       ordering.to_reordered[connection.dst_probe_index]));
   }
-  return flow;
+  return CreateFlowNetwork(probes, reordered_connections);
 }
 
-std::vector<ProbeConnectionFlow> ToResult(TopologyFlow const &flow) {
+std::vector<ProbeConnectionFlow> ToResult(FlowNetwork const &network,
+                                          FlowState const &state,
+                                          ProbeOrdering const &ordering) {
   std::vector<ProbeConnectionFlow> result;
-  result.reserve(boost::num_edges(flow));
-
-  for (auto [current, end] = boost::edges(flow); current != end; ++current) {
-    FlowProperties properties =
-        boost::get(boost::edge_bundle_t(), flow, *current);
-    result.push_back(ProbeConnectionFlow(current->m_source, current->m_target,
-                                         properties.flow,
-                                         properties.lane_count));
+  result.reserve(network.EdgeCount());
+
+  for (auto [current, end] = boost::edges(network.graph); current != end;
+       ++current) {
+    unsigned id = boost::get(boost::edge_index, network.graph, *current);
+    result.push_back(ProbeConnectionFlow(
+        ordering.to_original[boost::source(*current, network.graph)],
+        ordering.to_original[boost::target(*current, network.graph)],
+        state.flow[id], state.lane_count[id]));
   }
 
   return result;
 }
 
+// Permutes the population of each scenario into the probe order of the
+// network.
+std::vector<std::vector<float>> ReorderScenarioPopulations(
+    std::vector<std::vector<float>> const &scenario_populations,
+    ProbeOrdering const &ordering) {
+  std::vector<std::vector<float>> reordered(scenario_populations.size());
+  for (unsigned k = 0; k < scenario_populations.size(); ++k) {
+    assert(scenario_populations[k].size() == ordering.to_original.size());
+    reordered[k].resize(ordering.to_original.size());
+    for (unsigned i = 0; i < ordering.to_original.size(); ++i) {
+      reordered[k][i] = scenario_populations[k][ordering.to_original[i]];
+    }
+  }
+  return reordered;
+}
+
+// Groups the scenarios whose edge costs are identical, so that they can be
+// simulated together.
+std::vector<std::vector<unsigned>>
+GroupScenariosByCost(std::vector<FlowState> const &states) {
+  std::vector<std::vector<unsigned>> groups;
+  for (unsigned k = 0; k < states.size(); ++k) {
+    auto group = std::find_if(groups.begin(), groups.end(),
+                              [&states, k](auto const &group) {
+                                return states[group[0]].cost == states[k].cost;
+                              });
+    if (group == groups.end()) {
+      groups.push_back(std::vector<unsigned>{k});
+    } else {
+      group->push_back(k);
+    }
+  }
+  return groups;
+}
+
+// Carries the flows and lane counts over from the previous solution to the
+// connections which persist. The others start without flow.
+FlowState ToFlowState(FlowNetwork const &network,
+                      std::vector<ProbeConnectionFlow> const &previous_flows,
+                      ProbeOrdering const &ordering) {
+  FlowState state(network);
+  for (auto const &previous : previous_flows) {
+    assert(previous.src_probe_index < ordering.to_reordered.size());
+    assert(previous.dst_probe_index < ordering.to_reordered.size());
+
+    unsigned id =
+        FindFlowEdge(ordering.to_reordered[previous.src_probe_index],
+                     ordering.to_reordered[previous.dst_probe_index],
+                     network.graph);
+    if (id == kNoFlowEdge) {
+      // The connection has been removed.
+      continue;
+    }
+    state.flow[id] = previous.flow;
+    state.lane_count[id] = previous.lane_count;
+  }
+  return state;
+}
+
+// Drives the flows from the initial state to the equilibrium by the method of
+// successive averages. The initial state weighs as much as the average of
+// prior_iteration_count iterations, so a warm start isn't overwritten by the
+// first step.
+ProbeTopologyFlowResult SolveEquilibrium(FlowNetwork const &network,
+                                         FlowState current,
+                                         unsigned prior_iteration_count,
+                                         unsigned max_iteration_count,
+                                         float tolerance,
+                                         FlowSimulationOptions const &options,
+                                         ProbeOrdering const &ordering) {
+  assert(tolerance >= 0);
+
+  FlowSimulator simulator(network, options);
+  FlowState next(network);
+  UpdateFlowCosts(network, &current);
+
+  ProbeTopologyFlowResult result{
+      .flows = {},
+      .iteration_count = 0,
+      .averaged_iteration_count = prior_iteration_count,
+      .relative_gap = 1,
+      .flow_changes = {},
+  };
+  while (result.iteration_count < max_iteration_count) {
+    // The simulated flows take the shortest paths under the current costs.
+    // They tell how far the current flows are from the equilibrium, and the
+    // direction to move them to.
+    simulator.Simulate(current, &next.flow);
+    result.relative_gap = RelativeGap(current, next.flow);
+    ++result.iteration_count;
+    if (result.relative_gap <= tolerance) {
+      break;
+    }
+
+    ++result.averaged_iteration_count;
+    float step = 1.0f / result.averaged_iteration_count;
+    FlowStatistics flow_statistics = UpdateFlow(current, step, &next);
+    result.flow_changes.push_back(RelativeFlowChange(current, next));
+    UpdateFlowCosts(network, &next);
+    std::swap(current, next);
+
+    BOOST_LOG_TRIVIAL(info)
+        << "SolveEquilibrium() iteration " << result.iteration_count
+        << ", gap=" << result.relative_gap
+        << ", change=" << result.flow_changes.back()
+        << ", mean(flow)=" << flow_statistics.mean
+        << ", std(flow)=" << flow_statistics.std;
+  }
+
+  result.flows = ToResult(network, current, ordering);
+  return result;
+}
+
 } // namespace
 
 std::vector<ProbeConnectionFlow>
 EstimateProbeTopologyFlow(std::vector<PopulationProbe> const &probes,
                           std::vector<ProbeConnection> const &connections,
-                          unsigned iteration_count) {
-  TopologyFlow flow = ToFlow(probes, connections);
+                          unsigned iteration_count, bool reorder_probes,
+                          unsigned origin_sample_count,
+                          float origin_cluster_radius,
+                          bool use_contraction_hierarchy) {
+  ProbeOrdering ordering = reorder_probes ? HilbertCurveOrdering(probes)
+                                          : IdentityOrdering(probes.size());
+  std::vector<PopulationProbe> reordered_probes =
+      ReorderProbes(probes, ordering);
+
+  // The network stays unchanged. The flow states are swapped between the
+  // iterations, one being read while the other receives the update.
+  FlowNetwork network = ToFlow(reordered_probes, connections, ordering);
+  FlowSimulator simulator(
+      network, FlowSimulationOptions{
+                   .origin_sample_count = origin_sample_count,
+                   .origin_cluster_radius = origin_cluster_radius,
+                   .use_contraction_hierarchy = use_contraction_hierarchy,
+               });
+  FlowState current(network);
+  FlowState next(network);
+  UpdateFlowCosts(network, &current);
+
   for (unsigned i = 0; i < iteration_count; ++i) {
-    TopologyFlow simulated_flow = SimulateFlow(flow, probes);
-    FlowStatistics flow_statistics = UpdateFlow(simulated_flow, &flow);
+    simulator.Simulate(current, &next.flow);
+    FlowStatistics flow_statistics = UpdateFlow(current, &next);
+    UpdateFlowCosts(network, &next);
+    std::swap(current, next);
 
     BOOST_LOG_TRIVIAL(info) << "EstimateProbeTopologyFlow() iteration " << i + 1
                             << ", mean(flow)=" << flow_statistics.mean
@@ -83,7 +309,113 @@ EstimateProbeTopologyFlow(std::vector<PopulationProbe> const &probes,
                             << ", min(flow)=" << flow_statistics.min
                             << ", max(flow)=" << flow_statistics.max;
   }
-  return ToResult(flow);
+  return ToResult(network, current, ordering);
+}
+
+std::vector<std::vector<ProbeConnectionFlow>>
+EstimateProbeTopologyFlowScenarios(
+    std::vector<PopulationProbe> const &probes,
+    std::vector<ProbeConnection> const &connections,
+    std::vector<std::vector<float>> const &scenario_populations,
+    unsigned iteration_count, bool reorder_probes) {
+  ProbeOrdering ordering = reorder_probes ? HilbertCurveOrdering(probes)
+                                          : IdentityOrdering(probes.size());
+  std::vector<PopulationProbe> reordered_probes =
+      ReorderProbes(probes, ordering);
+  std::vector<std::vector<float>> populations =
+      ReorderScenarioPopulations(scenario_populations, ordering);
+
+  FlowNetwork network = ToFlow(reordered_probes, connections, ordering);
+  std::vector<FlowState> current(populations.size(), FlowState(network));
+  std::vector<FlowState> next(populations.size(), FlowState(network));
+  for (auto &state : current) {
+    UpdateFlowCosts(network, &state);
+  }
+
+  std::vector<std::vector<float>> group_populations;
+  std::vector<std::vector<float>> group_flows;
+  for (unsigned i = 0; i < iteration_count; ++i) {
+    std::vector<std::vector<unsigned>> groups = GroupScenariosByCost(current);
+    for (auto const &group : groups) {
+      group_populations.clear();
+      for (unsigned k : group) {
+        group_populations.push_back(populations[k]);
+      }
+      SimulateFlow(network, current[group[0]], group_populations,
+                   &group_flows);
+      for (unsigned j = 0; j < group.size(); ++j) {
+        std::swap(next[group[j]].flow, group_flows[j]);
+      }
+    }
+
+    for (unsigned k = 0; k < populations.size(); ++k) {
+      UpdateFlow(current[k], &next[k]);
+      UpdateFlowCosts(network, &next[k]);
+      std::swap(current[k], next[k]);
+    }
+
+    BOOST_LOG_TRIVIAL(info)
+        << "EstimateProbeTopologyFlowScenarios() iteration " << i + 1
+        << ", scenario_count=" << populations.size()
+        << ", cost_group_count=" << groups.size();
+  }
+
+  std::vector<std::vector<ProbeConnectionFlow>> result;
+  result.reserve(populations.size());
+  for (auto const &state : current) {
+    result.push_back(ToResult(network, state, ordering));
+  }
+  return result;
+}
+
+ProbeTopologyFlowResult EstimateProbeTopologyFlowEquilibrium(
+    std::vector<PopulationProbe> const &probes,
+    std::vector<ProbeConnection> const &connections,
+    unsigned max_iteration_count, float tolerance, bool reorder_probes,
+    unsigned origin_sample_count, float origin_cluster_radius,
+    bool use_contraction_hierarchy) {
+  ProbeOrdering ordering = reorder_probes ? HilbertCurveOrdering(probes)
+                                          : IdentityOrdering(probes.size());
+  std::vector<PopulationProbe> reordered_probes =
+      ReorderProbes(probes, ordering);
+
+  FlowNetwork network = ToFlow(reordered_probes, connections, ordering);
+  return SolveEquilibrium(network, FlowState(network),
+                          /*prior_iteration_count=*/0, max_iteration_count,
+                          tolerance,
+                          FlowSimulationOptions{
+                              .origin_sample_count = origin_sample_count,
+                              .origin_cluster_radius = origin_cluster_radius,
+                              .use_contraction_hierarchy =
+                                  use_contraction_hierarchy,
+                          },
+                          ordering);
+}
+
+ProbeTopologyFlowResult ReestimateProbeTopologyFlow(
+    std::vector<PopulationProbe> const &probes,
+    std::vector<ProbeConnection> const &connections,
+    std::vector<ProbeConnectionFlow> const &previous_flows,
+    unsigned prior_iteration_count, unsigned max_iteration_count,
+    float tolerance, bool reorder_probes,
+    unsigned origin_sample_count, float origin_cluster_radius,
+    bool use_contraction_hierarchy) {
+  ProbeOrdering ordering = reorder_probes ? HilbertCurveOrdering(probes)
+                                          : IdentityOrdering(probes.size());
+  std::vector<PopulationProbe> reordered_probes =
+      ReorderProbes(probes, ordering);
+
+  FlowNetwork network = ToFlow(reordered_probes, connections, ordering);
+  FlowState previous = ToFlowState(network, previous_flows, ordering);
+  return SolveEquilibrium(network, std::move(previous), prior_iteration_count,
+                          max_iteration_count, tolerance,
+                          FlowSimulationOptions{
+                              .origin_sample_count = origin_sample_count,
+                              .origin_cluster_radius = origin_cluster_radius,
+                              .use_contraction_hierarchy =
+                                  use_contraction_hierarchy,
+                          },
+                          ordering);
 }
 
 } // namespace procedural
@@ -44,11 +44,92 @@ struct ProbeConnectionFlow {
 
 // It estimates the directed transportation flow over the connections. It uses
 // an iterative algorithm to simulate and measure the flow. The estimate
-// converges as more iterations are run.
+// converges as more iterations are run. When reorder_probes is set, the probes
+// are internally permuted along a Hilbert curve for memory locality. The
+// resulting flows always refer to the caller's probe indices. When
+// origin_sample_count is positive, every iteration simulates only that many
+// origins, sampled afresh by population, instead of every probe. The sampled
+// flows are rescaled to be unbiased, and the sampling noise averages out over
+// the iterations. When origin_cluster_radius is positive, the origins within
+// that many meters of each other share a shortest path tree instead, which
+// approximates the travel times of all but one origin per cluster. The radius
+// can't exceed 3000 meters, otherwise it throws std::invalid_argument. When
+// use_contraction_hierarchy is set, the exact shortest paths are computed over
+// a contraction hierarchy of the connections, which is built once then
+// customized with the travel times of every iteration. It pays off on large
+// networks. None of the three can be combined, otherwise it throws
+// std::invalid_argument.
 std::vector<ProbeConnectionFlow>
 EstimateProbeTopologyFlow(std::vector<PopulationProbe> const &probes,
                           std::vector<ProbeConnection> const &connections,
-                          unsigned iteration_count);
+                          unsigned iteration_count, bool reorder_probes = false,
+                          unsigned origin_sample_count = 0,
+                          float origin_cluster_radius = 0,
+                          bool use_contraction_hierarchy = false);
+
+// Same as above, except that several demand scenarios, e.g. peak hours or
+// growth scenarios, are estimated over the same connections. Each scenario
+// replaces the population_grid_200 of the probes with its own population per
+// probe. The flow network is built once, and the scenarios whose costs are
+// identical on an iteration share their shortest path searches, which is the
+// case for all of them on the first iteration. Returns the flows of each
+// scenario in order.
+std::vector<std::vector<ProbeConnectionFlow>>
+EstimateProbeTopologyFlowScenarios(
+    std::vector<PopulationProbe> const &probes,
+    std::vector<ProbeConnection> const &connections,
+    std::vector<std::vector<float>> const &scenario_populations,
+    unsigned iteration_count, bool reorder_probes = false);
+
+// The flow estimate of an equilibrium solve.
+struct ProbeTopologyFlowResult {
+  // The flow over each directed connection.
+  std::vector<ProbeConnectionFlow> flows;
+
+  // The number of iterations actually run.
+  unsigned iteration_count;
+
+  // The number of simulated flows the flows are the average of, including the
+  // ones a warm start stands for. It's the prior_iteration_count to re-estimate
+  // from these flows with.
+  unsigned averaged_iteration_count;
+
+  // The relative gap of the flows, see RelativeGap() in update.hpp.
+  float relative_gap;
+
+  // The relative change of the flows made by each iteration, see
+  // RelativeFlowChange() in update.hpp. The iteration which reaches the
+  // tolerance leaves the flows unchanged and has no entry.
+  std::vector<float> flow_changes;
+};
+
+// Same as above, except that the flows are driven to the equilibrium by the
+// method of successive averages. The iterations stop once the relative gap
+// drops to the tolerance, or after max_iteration_count iterations. With sampled
+// origins, the gap is measured against the sampled flows and carries their
+// noise, so the tolerance shouldn't be set below it.
+ProbeTopologyFlowResult EstimateProbeTopologyFlowEquilibrium(
+    std::vector<PopulationProbe> const &probes,
+    std::vector<ProbeConnection> const &connections,
+    unsigned max_iteration_count, float tolerance, bool reorder_probes = false,
+    unsigned origin_sample_count = 0, float origin_cluster_radius = 0,
+    bool use_contraction_hierarchy = false);
+
+// Same as above, except that the flows start from a previous solution over a
+// different set of connections, e.g. after a few streets have been added or
+// removed. The connections which persist keep their previous flows and lane
+// counts, which usually takes far fewer iterations than starting over. The
+// previous flows weigh as much as the average of prior_iteration_count
+// simulated flows, see ProbeTopologyFlowResult::averaged_iteration_count, so
+// the averaging carries on from them rather than overwriting them.
+ProbeTopologyFlowResult ReestimateProbeTopologyFlow(
+    std::vector<PopulationProbe> const &probes,
+    std::vector<ProbeConnection> const &connections,
+    std::vector<ProbeConnectionFlow> const &previous_flows,
+    unsigned prior_iteration_count, unsigned max_iteration_count,
+    float tolerance, bool reorder_probes = false,
+    unsigned origin_sample_count = 0, float origin_cluster_radius = 0,
+    bool use_contraction_hierarchy = false);
 
 } // namespace procedural
 } // namespace e8
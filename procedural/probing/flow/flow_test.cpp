@@ -0,0 +1,209 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/flow/flow.hpp"
+#include "procedural/probing/probe/probe.hpp"
+#include "procedural/probing/topology/topology.hpp"
+#include <boost/test/unit_test.hpp>
+#include <eigen3/Eigen/Core>
+#include <stdexcept>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+unsigned const kGridSize = 8;
+
+std::vector<PopulationProbe> CreateGridProbes() {
+  std::vector<PopulationProbe> probes;
+  for (unsigned y = 0; y < kGridSize; ++y) {
+    for (unsigned x = 0; x < kGridSize; ++x) {
+      probes.push_back(PopulationProbe(Eigen::Vector3f(x * 500, y * 500, 0),
+                                       /*population_grid_200=*/1e3f));
+    }
+  }
+  return probes;
+}
+
+std::vector<ProbeConnection> CreateGridConnections() {
+  std::vector<ProbeConnection> connections;
+  for (unsigned y = 0; y < kGridSize; ++y) {
+    for (unsigned x = 0; x < kGridSize; ++x) {
+      unsigned u = y * kGridSize + x;
+      if (x + 1 < kGridSize) {
+        connections.push_back(ProbeConnection(u, u + 1));
+      }
+      if (y + 1 < kGridSize) {
+        connections.push_back(ProbeConnection(u, u + kGridSize));
+      }
+    }
+  }
+  return connections;
+}
+
+BOOST_AUTO_TEST_CASE(WhenToleranceIsReached_ThenCheckIterationsStopEarly) {
+  std::vector<PopulationProbe> probes = CreateGridProbes();
+  std::vector<ProbeConnection> connections = CreateGridConnections();
+
+  ProbeTopologyFlowResult result = EstimateProbeTopologyFlowEquilibrium(
+      probes, connections, /*max_iteration_count=*/100, /*tolerance=*/1e-2f);
+
+  BOOST_CHECK_LT(result.iteration_count, 100);
+  BOOST_CHECK_LE(result.relative_gap, 1e-2f);
+  BOOST_CHECK_EQUAL(result.iteration_count - 1, result.flow_changes.size());
+  BOOST_CHECK_EQUAL(2 * connections.size(), result.flows.size());
+  for (auto const &flow : result.flows) {
+    BOOST_CHECK_GT(flow.flow, 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenToleranceIsUnreachable_ThenCheckAllIterationsRun) {
+  std::vector<PopulationProbe> probes = CreateGridProbes();
+  std::vector<ProbeConnection> connections = CreateGridConnections();
+
+  ProbeTopologyFlowResult result = EstimateProbeTopologyFlowEquilibrium(
+      probes, connections, /*max_iteration_count=*/3, /*tolerance=*/0);
+
+  BOOST_CHECK_EQUAL(3, result.iteration_count);
+  BOOST_CHECK_GT(result.relative_gap, 0);
+  BOOST_CHECK_EQUAL(3, result.flow_changes.size());
+}
+
+BOOST_AUTO_TEST_CASE(
+    WhenConnectionIsRemoved_ThenCheckWarmStartTakesFewerSteps) {
+  std::vector<PopulationProbe> probes = CreateGridProbes();
+  std::vector<ProbeConnection> connections = CreateGridConnections();
+  ProbeTopologyFlowResult previous = EstimateProbeTopologyFlowEquilibrium(
+      probes, connections, /*max_iteration_count=*/100, /*tolerance=*/1e-2f);
+
+  connections.erase(connections.begin() + connections.size() / 2);
+  ProbeTopologyFlowResult cold = EstimateProbeTopologyFlowEquilibrium(
+      probes, connections, /*max_iteration_count=*/100, /*tolerance=*/1e-2f);
+  ProbeTopologyFlowResult warm = ReestimateProbeTopologyFlow(
+      probes, connections, previous.flows, previous.averaged_iteration_count,
+      /*max_iteration_count=*/100, /*tolerance=*/1e-2f);
+
+  BOOST_CHECK_LE(cold.relative_gap, 1e-2f);
+  BOOST_CHECK_LE(warm.relative_gap, 1e-2f);
+  BOOST_CHECK_LT(warm.iteration_count, cold.iteration_count);
+  BOOST_CHECK_EQUAL(2 * connections.size(), warm.flows.size());
+}
+
+BOOST_AUTO_TEST_CASE(WhenNetworkIsUnchanged_ThenCheckWarmStartStaysPut) {
+  std::vector<PopulationProbe> probes = CreateGridProbes();
+  std::vector<ProbeConnection> connections = CreateGridConnections();
+  ProbeTopologyFlowResult previous = EstimateProbeTopologyFlowEquilibrium(
+      probes, connections, /*max_iteration_count=*/100, /*tolerance=*/1e-2f);
+  BOOST_CHECK_EQUAL(previous.flow_changes.size(),
+                    previous.averaged_iteration_count);
+
+  // Runs a single step each.
+  ProbeTopologyFlowResult cold = EstimateProbeTopologyFlowEquilibrium(
+      probes, connections, /*max_iteration_count=*/1, /*tolerance=*/0);
+  ProbeTopologyFlowResult warm = ReestimateProbeTopologyFlow(
+      probes, connections, previous.flows, previous.averaged_iteration_count,
+      /*max_iteration_count=*/1, /*tolerance=*/0);
+  ProbeTopologyFlowResult barely_warm = ReestimateProbeTopologyFlow(
+      probes, connections, previous.flows, /*prior_iteration_count=*/1,
+      /*max_iteration_count=*/1, /*tolerance=*/0);
+
+  BOOST_REQUIRE_EQUAL(1, cold.flow_changes.size());
+  BOOST_REQUIRE_EQUAL(1, warm.flow_changes.size());
+  BOOST_REQUIRE_EQUAL(1, barely_warm.flow_changes.size());
+  BOOST_CHECK_LT(warm.flow_changes[0], cold.flow_changes[0]);
+  // The weightier the warm start, the less the first step moves it.
+  BOOST_CHECK_LT(warm.flow_changes[0], barely_warm.flow_changes[0]);
+  BOOST_CHECK_EQUAL(previous.averaged_iteration_count + 1,
+                    warm.averaged_iteration_count);
+}
+
+BOOST_AUTO_TEST_CASE(WhenScenariosAreBatched_ThenCheckEachMatchesItsOwnRun) {
+  std::vector<PopulationProbe> probes = CreateGridProbes();
+  std::vector<ProbeConnection> connections = CreateGridConnections();
+
+  std::vector<std::vector<float>> scenario_populations{
+      std::vector<float>(probes.size(), 1e3f),
+      std::vector<float>(probes.size(), 3e3f)};
+  std::vector<std::vector<ProbeConnectionFlow>> scenario_flows =
+      EstimateProbeTopologyFlowScenarios(probes, connections,
+                                         scenario_populations,
+                                         /*iteration_count=*/3);
+
+  BOOST_CHECK_EQUAL(2, scenario_flows.size());
+  for (unsigned k = 0; k < scenario_populations.size(); ++k) {
+    std::vector<PopulationProbe> scenario_probes = probes;
+    for (unsigned i = 0; i < probes.size(); ++i) {
+      scenario_probes[i].population_grid_200 = scenario_populations[k][i];
+    }
+    std::vector<ProbeConnectionFlow> expected = EstimateProbeTopologyFlow(
+        scenario_probes, connections, /*iteration_count=*/3);
+
+    BOOST_CHECK_EQUAL(expected.size(), scenario_flows[k].size());
+    for (unsigned j = 0; j < expected.size(); ++j) {
+      BOOST_CHECK_EQUAL(expected[j].src_probe_index,
+                        scenario_flows[k][j].src_probe_index);
+      BOOST_CHECK_EQUAL(expected[j].dst_probe_index,
+                        scenario_flows[k][j].dst_probe_index);
+      BOOST_CHECK_CLOSE(expected[j].flow, scenario_flows[k][j].flow, 1e-1f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenCombineSimulationOptions_ThenCheckTheyAreRejected) {
+  std::vector<PopulationProbe> probes = CreateGridProbes();
+  std::vector<ProbeConnection> connections = CreateGridConnections();
+
+  BOOST_CHECK_THROW(EstimateProbeTopologyFlow(
+                        probes, connections, /*iteration_count=*/1,
+                        /*reorder_probes=*/false, /*origin_sample_count=*/8,
+                        /*origin_cluster_radius=*/600.f),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(EstimateProbeTopologyFlowEquilibrium(
+                        probes, connections, /*max_iteration_count=*/1,
+                        /*tolerance=*/0, /*reorder_probes=*/false,
+                        /*origin_sample_count=*/0,
+                        /*origin_cluster_radius=*/600.f,
+                        /*use_contraction_hierarchy=*/true),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(ReestimateProbeTopologyFlow(
+                        probes, connections, /*previous_flows=*/{},
+                        /*prior_iteration_count=*/1,
+                        /*max_iteration_count=*/1, /*tolerance=*/0,
+                        /*reorder_probes=*/false, /*origin_sample_count=*/8,
+                        /*origin_cluster_radius=*/0,
+                        /*use_contraction_hierarchy=*/true),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(WhenClusterRadiusIsTooLarge_ThenCheckItIsRejected) {
+  std::vector<PopulationProbe> probes = CreateGridProbes();
+  std::vector<ProbeConnection> connections = CreateGridConnections();
+
+  BOOST_CHECK_THROW(EstimateProbeTopologyFlow(
+                        probes, connections, /*iteration_count=*/1,
+                        /*reorder_probes=*/false, /*origin_sample_count=*/0,
+                        /*origin_cluster_radius=*/5000.f),
+                    std::invalid_argument);
+  BOOST_CHECK_NO_THROW(EstimateProbeTopologyFlow(
+      probes, connections, /*iteration_count=*/1, /*reorder_probes=*/false,
+      /*origin_sample_count=*/0, /*origin_cluster_radius=*/3000.f));
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
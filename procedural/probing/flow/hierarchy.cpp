@@ -0,0 +1,417 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/flow/hierarchy.hpp"
+#include "procedural/probing/flow/network.hpp"
+#include "procedural/probing/parallel/parallel.hpp"
+#include <algorithm>
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <cassert>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+// Stands for the cost of a missing direction. It's finite so that sums of two
+// stay comparable under fast math.
+float const kNoPathCost = 1e30f;
+
+unsigned const kMinRanksPerChunk = 256;
+
+using DegreeAndVertex = std::pair<unsigned, unsigned>;
+using CostAndRank = std::pair<float, unsigned>;
+
+std::vector<std::vector<unsigned>>
+UndirectedNeighbors(FlowNetwork const &network) {
+  std::vector<std::vector<unsigned>> neighbors(network.VertexCount());
+  for (unsigned id = 0; id < network.EdgeCount(); ++id) {
+    unsigned u = network.sources[id];
+    unsigned v = network.sources[network.reverse_edges[id]];
+    neighbors[u].push_back(v);
+    neighbors[v].push_back(u);
+  }
+  for (auto &vertex_neighbors : neighbors) {
+    std::sort(vertex_neighbors.begin(), vertex_neighbors.end());
+    vertex_neighbors.erase(
+        std::unique(vertex_neighbors.begin(), vertex_neighbors.end()),
+        vertex_neighbors.end());
+  }
+  return neighbors;
+}
+
+// Eliminates the vertices in increasing order of their remaining degree. The
+// remaining neighbors of an eliminated vertex are connected into a clique,
+// and they make up its upward neighbors in the chordal supergraph.
+void EliminateVertices(FlowNetwork const &network,
+                       ContractionHierarchy *hierarchy,
+                       std::vector<std::vector<unsigned>> *upward_neighbors) {
+  unsigned vertex_count = network.VertexCount();
+  std::vector<std::vector<unsigned>> neighbors = UndirectedNeighbors(network);
+  std::vector<unsigned char> eliminated(vertex_count, 0);
+
+  std::priority_queue<DegreeAndVertex, std::vector<DegreeAndVertex>,
+                      std::greater<DegreeAndVertex>>
+      queue;
+  for (unsigned v = 0; v < vertex_count; ++v) {
+    queue.push(std::make_pair(neighbors[v].size(), v));
+  }
+
+  hierarchy->ranks.resize(vertex_count);
+  hierarchy->vertices.clear();
+  hierarchy->vertices.reserve(vertex_count);
+  upward_neighbors->resize(vertex_count);
+  std::vector<unsigned> merged;
+  while (!queue.empty()) {
+    auto [degree, v] = queue.top();
+    queue.pop();
+    if (eliminated[v] || degree != neighbors[v].size()) {
+      // Outdated entry.
+      continue;
+    }
+
+    eliminated[v] = 1;
+    hierarchy->ranks[v] = hierarchy->vertices.size();
+    hierarchy->vertices.push_back(v);
+    (*upward_neighbors)[v] = neighbors[v];
+
+    std::vector<unsigned> const &clique = (*upward_neighbors)[v];
+    for (unsigned u : clique) {
+      // Replaces v with the rest of the clique.
+      merged.clear();
+      std::set_union(neighbors[u].begin(), neighbors[u].end(), clique.begin(),
+                     clique.end(), std::back_inserter(merged));
+      neighbors[u].clear();
+      for (unsigned w : merged) {
+        if (w != u && w != v) {
+          neighbors[u].push_back(w);
+        }
+      }
+      queue.push(std::make_pair(neighbors[u].size(), u));
+    }
+    neighbors[v].clear();
+  }
+  assert(hierarchy->vertices.size() == vertex_count);
+}
+
+void CreateArcs(FlowNetwork const &network,
+                std::vector<std::vector<unsigned>> const &upward_neighbors,
+                ContractionHierarchy *hierarchy) {
+  unsigned vertex_count = network.VertexCount();
+
+  hierarchy->first_arcs.assign(1, 0);
+  for (unsigned r = 0; r < vertex_count; ++r) {
+    unsigned v = hierarchy->vertices[r];
+
+    std::vector<unsigned> head_ranks;
+    for (unsigned w : upward_neighbors[v]) {
+      assert(hierarchy->ranks[w] > r);
+      head_ranks.push_back(hierarchy->ranks[w]);
+    }
+    std::sort(head_ranks.begin(), head_ranks.end());
+
+    for (unsigned head : head_ranks) {
+      unsigned w = hierarchy->vertices[head];
+      hierarchy->arc_tails.push_back(r);
+      hierarchy->arc_heads.push_back(head);
+      hierarchy->up_edges.push_back(FindFlowEdge(v, w, network.graph));
+      hierarchy->down_edges.push_back(FindFlowEdge(w, v, network.graph));
+    }
+    hierarchy->first_arcs.push_back(hierarchy->arc_heads.size());
+  }
+
+  // Groups the arcs by their head.
+  hierarchy->first_lower_arcs.assign(vertex_count + 1, 0);
+  for (unsigned head : hierarchy->arc_heads) {
+    ++hierarchy->first_lower_arcs[head + 1];
+  }
+  for (unsigned r = 0; r < vertex_count; ++r) {
+    hierarchy->first_lower_arcs[r + 1] += hierarchy->first_lower_arcs[r];
+  }
+  hierarchy->lower_arcs.resize(hierarchy->arc_heads.size());
+  std::vector<unsigned> next(hierarchy->first_lower_arcs.begin(),
+                             hierarchy->first_lower_arcs.end() - 1);
+  for (unsigned arc = 0; arc < hierarchy->arc_heads.size(); ++arc) {
+    hierarchy->lower_arcs[next[hierarchy->arc_heads[arc]]++] = arc;
+  }
+}
+
+void CreateLevels(ContractionHierarchy *hierarchy) {
+  unsigned vertex_count = hierarchy->VertexCount();
+
+  std::vector<unsigned> levels(vertex_count, 0);
+  unsigned level_count = vertex_count > 0 ? 1 : 0;
+  for (unsigned r = 0; r < vertex_count; ++r) {
+    for (unsigned arc = hierarchy->first_arcs[r];
+         arc < hierarchy->first_arcs[r + 1]; ++arc) {
+      unsigned head = hierarchy->arc_heads[arc];
+      levels[head] = std::max(levels[head], levels[r] + 1);
+      level_count = std::max(level_count, levels[head] + 1);
+    }
+  }
+
+  hierarchy->level_offsets.assign(level_count + 1, 0);
+  for (unsigned level : levels) {
+    ++hierarchy->level_offsets[level + 1];
+  }
+  for (unsigned l = 0; l < level_count; ++l) {
+    hierarchy->level_offsets[l + 1] += hierarchy->level_offsets[l];
+  }
+  hierarchy->level_ranks.resize(vertex_count);
+  std::vector<unsigned> next(hierarchy->level_offsets.begin(),
+                             hierarchy->level_offsets.end() - 1);
+  for (unsigned r = 0; r < vertex_count; ++r) {
+    hierarchy->level_ranks[next[levels[r]]++] = r;
+  }
+}
+
+float EdgeCost(unsigned edge, std::vector<float> const &edge_costs) {
+  return edge == kNoFlowEdge ? kNoPathCost : edge_costs[edge];
+}
+
+// Computes the costs of the arcs leaving the rank, given that the arcs of all
+// the lower ranks are final. arc_positions is a scratch buffer over the
+// ranks, which must be filled with kNoHierarchyArc, and it's left that way on
+// return.
+void CustomizeRank(unsigned r, ContractionHierarchy const &hierarchy,
+                   std::vector<float> const &edge_costs,
+                   std::vector<unsigned> *arc_positions,
+                   HierarchyMetric *metric) {
+  unsigned arcs_begin = hierarchy.first_arcs[r];
+  unsigned arcs_end = hierarchy.first_arcs[r + 1];
+  for (unsigned arc = arcs_begin; arc < arcs_end; ++arc) {
+    metric->up_costs[arc] = EdgeCost(hierarchy.up_edges[arc], edge_costs);
+    metric->down_costs[arc] = EdgeCost(hierarchy.down_edges[arc], edge_costs);
+    metric->up_triangle_tail_arcs[arc] = kNoHierarchyArc;
+    metric->up_triangle_head_arcs[arc] = kNoHierarchyArc;
+    metric->down_triangle_tail_arcs[arc] = kNoHierarchyArc;
+    metric->down_triangle_head_arcs[arc] = kNoHierarchyArc;
+    (*arc_positions)[hierarchy.arc_heads[arc]] = arc;
+  }
+
+  // Every lower triangle (u, r, w) offers a path through u.
+  for (unsigned i = hierarchy.first_lower_arcs[r];
+       i < hierarchy.first_lower_arcs[r + 1]; ++i) {
+    unsigned tail_arc = hierarchy.lower_arcs[i];
+    unsigned u = hierarchy.arc_tails[tail_arc];
+    for (unsigned head_arc = hierarchy.first_arcs[u];
+         head_arc < hierarchy.first_arcs[u + 1]; ++head_arc) {
+      unsigned arc = (*arc_positions)[hierarchy.arc_heads[head_arc]];
+      if (arc == kNoHierarchyArc) {
+        continue;
+      }
+
+      float up_cost =
+          metric->down_costs[tail_arc] + metric->up_costs[head_arc];
+      if (up_cost < metric->up_costs[arc]) {
+        metric->up_costs[arc] = up_cost;
+        metric->up_triangle_tail_arcs[arc] = tail_arc;
+        metric->up_triangle_head_arcs[arc] = head_arc;
+      }
+      float down_cost =
+          metric->down_costs[head_arc] + metric->up_costs[tail_arc];
+      if (down_cost < metric->down_costs[arc]) {
+        metric->down_costs[arc] = down_cost;
+        metric->down_triangle_tail_arcs[arc] = tail_arc;
+        metric->down_triangle_head_arcs[arc] = head_arc;
+      }
+    }
+  }
+
+  for (unsigned arc = arcs_begin; arc < arcs_end; ++arc) {
+    (*arc_positions)[hierarchy.arc_heads[arc]] = kNoHierarchyArc;
+  }
+}
+
+} // namespace
+
+unsigned ContractionHierarchy::VertexCount() const { return vertices.size(); }
+
+unsigned ContractionHierarchy::ArcCount() const { return arc_heads.size(); }
+
+HierarchyPaths::HierarchyPaths(unsigned vertex_count)
+    : time_cost(vertex_count), parents(vertex_count),
+      parent_arc_directions(vertex_count), first_children(vertex_count + 1) {
+  settle_order.reserve(vertex_count);
+  children.reserve(vertex_count);
+}
+
+ContractionHierarchy CreateContractionHierarchy(FlowNetwork const &network) {
+  ContractionHierarchy hierarchy;
+  std::vector<std::vector<unsigned>> upward_neighbors;
+  EliminateVertices(network, &hierarchy, &upward_neighbors);
+  CreateArcs(network, upward_neighbors, &hierarchy);
+  CreateLevels(&hierarchy);
+  return hierarchy;
+}
+
+void CustomizeContractionHierarchy(ContractionHierarchy const &hierarchy,
+                                   std::vector<float> const &edge_costs,
+                                   HierarchyMetric *metric,
+                                   bool multithreaded) {
+  unsigned arc_count = hierarchy.ArcCount();
+  metric->up_costs.resize(arc_count);
+  metric->down_costs.resize(arc_count);
+  metric->up_triangle_tail_arcs.resize(arc_count);
+  metric->up_triangle_head_arcs.resize(arc_count);
+  metric->down_triangle_tail_arcs.resize(arc_count);
+  metric->down_triangle_head_arcs.resize(arc_count);
+
+  std::vector<std::vector<unsigned>> worker_arc_positions(
+      ParallelWorkerCount());
+  for (unsigned l = 0; l + 1 < hierarchy.level_offsets.size(); ++l) {
+    unsigned level_begin = hierarchy.level_offsets[l];
+    unsigned level_size = hierarchy.level_offsets[l + 1] - level_begin;
+    ParallelForChunks(
+        level_size,
+        [&hierarchy, &edge_costs, &worker_arc_positions, metric,
+         level_begin](unsigned worker, unsigned begin, unsigned end) {
+          std::vector<unsigned> &arc_positions = worker_arc_positions[worker];
+          arc_positions.resize(hierarchy.VertexCount(), kNoHierarchyArc);
+          for (unsigned i = begin; i < end; ++i) {
+            CustomizeRank(hierarchy.level_ranks[level_begin + i], hierarchy,
+                          edge_costs, &arc_positions, metric);
+          }
+        },
+        /*min_chunk_size=*/multithreaded ? kMinRanksPerChunk : level_size);
+  }
+}
+
+void ComputeHierarchyPaths(ContractionHierarchy const &hierarchy,
+                           HierarchyMetric const &metric, unsigned source_rank,
+                           float horizon, HierarchyPaths *paths) {
+  unsigned vertex_count = hierarchy.VertexCount();
+  std::fill(paths->time_cost.begin(), paths->time_cost.end(), kNoPathCost);
+  paths->settle_order.clear();
+
+  // The upward search only follows the arcs towards higher ranks, so it's
+  // confined to the few ranks above the source.
+  std::priority_queue<CostAndRank, std::vector<CostAndRank>,
+                      std::greater<CostAndRank>>
+      queue;
+  paths->time_cost[source_rank] = 0;
+  queue.push(std::make_pair(0.0f, source_rank));
+  while (!queue.empty()) {
+    auto [time_cost, u] = queue.top();
+    queue.pop();
+    if (time_cost > paths->time_cost[u]) {
+      // Outdated entry.
+      continue;
+    }
+
+    for (unsigned arc = hierarchy.first_arcs[u];
+         arc < hierarchy.first_arcs[u + 1]; ++arc) {
+      unsigned w = hierarchy.arc_heads[arc];
+      float w_time_cost = time_cost + metric.up_costs[arc];
+      if (metric.up_costs[arc] < kNoPathCost && w_time_cost <= horizon &&
+          w_time_cost < paths->time_cost[w]) {
+        paths->time_cost[w] = w_time_cost;
+        paths->parents[w] = u;
+        paths->parent_arc_directions[w] = 2 * arc;
+        queue.push(std::make_pair(w_time_cost, w));
+      }
+    }
+  }
+
+  // Every shortest path goes up, then down. Sweeping from the top rank down,
+  // each rank pulls from its higher neighbors, which are final by then.
+  for (unsigned u = vertex_count; u-- > 0;) {
+    for (unsigned arc = hierarchy.first_arcs[u];
+         arc < hierarchy.first_arcs[u + 1]; ++arc) {
+      unsigned w = hierarchy.arc_heads[arc];
+      float u_time_cost = paths->time_cost[w] + metric.down_costs[arc];
+      if (metric.down_costs[arc] < kNoPathCost && u_time_cost <= horizon &&
+          u_time_cost < paths->time_cost[u]) {
+        paths->time_cost[u] = u_time_cost;
+        paths->parents[u] = w;
+        paths->parent_arc_directions[u] = 2 * arc + 1;
+      }
+    }
+  }
+
+  // The upward search and the sweep may both set the parent of a rank, so
+  // neither of their orders is final. The settle order walks the final parents
+  // breadth first from the source instead.
+  paths->first_children.assign(vertex_count + 1, 0);
+  for (unsigned u = 0; u < vertex_count; ++u) {
+    if (u != source_rank && paths->time_cost[u] < kNoPathCost) {
+      ++paths->first_children[paths->parents[u] + 1];
+    }
+  }
+  for (unsigned u = 0; u < vertex_count; ++u) {
+    paths->first_children[u + 1] += paths->first_children[u];
+  }
+  paths->children.resize(paths->first_children[vertex_count]);
+  for (unsigned u = 0; u < vertex_count; ++u) {
+    if (u != source_rank && paths->time_cost[u] < kNoPathCost) {
+      paths->children[paths->first_children[paths->parents[u]]++] = u;
+    }
+  }
+  // Each offset has been shifted onto the next rank's.
+  for (unsigned u = vertex_count; u > 0; --u) {
+    paths->first_children[u] = paths->first_children[u - 1];
+  }
+  paths->first_children[0] = 0;
+
+  paths->settle_order.push_back(source_rank);
+  for (unsigned i = 0; i < paths->settle_order.size(); ++i) {
+    unsigned u = paths->settle_order[i];
+    paths->settle_order.insert(
+        paths->settle_order.end(),
+        paths->children.begin() + paths->first_children[u],
+        paths->children.begin() + paths->first_children[u + 1]);
+  }
+}
+
+void UnpackArcFlows(ContractionHierarchy const &hierarchy,
+                    HierarchyMetric const &metric,
+                    std::vector<float> *arc_direction_flows,
+                    std::vector<float> *edge_flows) {
+  assert(arc_direction_flows->size() == 2 * hierarchy.ArcCount());
+
+  // A shortcut is made of arcs leaving lower ranks, which come earlier.
+  std::vector<float> &flows = *arc_direction_flows;
+  for (unsigned arc = hierarchy.ArcCount(); arc-- > 0;) {
+    float up_flow = flows[2 * arc];
+    if (up_flow > 0) {
+      unsigned tail_arc = metric.up_triangle_tail_arcs[arc];
+      if (tail_arc == kNoHierarchyArc) {
+        (*edge_flows)[hierarchy.up_edges[arc]] += up_flow;
+      } else {
+        flows[2 * tail_arc + 1] += up_flow;
+        flows[2 * metric.up_triangle_head_arcs[arc]] += up_flow;
+      }
+    }
+
+    float down_flow = flows[2 * arc + 1];
+    if (down_flow > 0) {
+      unsigned tail_arc = metric.down_triangle_tail_arcs[arc];
+      if (tail_arc == kNoHierarchyArc) {
+        (*edge_flows)[hierarchy.down_edges[arc]] += down_flow;
+      } else {
+        flows[2 * metric.down_triangle_head_arcs[arc] + 1] += down_flow;
+        flows[2 * tail_arc] += down_flow;
+      }
+    }
+  }
+}
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,137 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "procedural/probing/flow/network.hpp"
+#include <limits>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// Denotes the absence of an arc.
+constexpr unsigned const kNoHierarchyArc = std::numeric_limits<unsigned>::max();
+
+// The metric independent part of a customizable contraction hierarchy over a
+// flow network. The vertices are identified by their rank in the contraction
+// order. Each arc connects a vertex to a higher ranked neighbor in the chordal
+// supergraph of the network, and carries both directions: up, from the lower
+// ranked tail to the higher ranked head, and down, the other way around. It
+// only depends on the connections, so it's computed once and customized with
+// new edge costs on every iteration.
+struct ContractionHierarchy {
+  unsigned VertexCount() const;
+  unsigned ArcCount() const;
+
+  // The rank of each vertex, and the vertex at each rank.
+  std::vector<unsigned> ranks;
+  std::vector<unsigned> vertices;
+
+  // The arcs leaving the vertex of rank r, towards higher ranks, are
+  // first_arcs[r] to first_arcs[r + 1] - 1.
+  std::vector<unsigned> first_arcs;
+  std::vector<unsigned> arc_tails;
+  std::vector<unsigned> arc_heads;
+
+  // The flow network edge of the up and down direction of each arc, or
+  // kNoFlowEdge when the direction is a shortcut only.
+  std::vector<unsigned> up_edges;
+  std::vector<unsigned> down_edges;
+
+  // The arcs entering the vertex of rank r, from lower ranks, are
+  // lower_arcs[first_lower_arcs[r]] to
+  // lower_arcs[first_lower_arcs[r + 1] - 1].
+  std::vector<unsigned> first_lower_arcs;
+  std::vector<unsigned> lower_arcs;
+
+  // The ranks grouped by customization level. A vertex is customized after all
+  // its lower neighbors, so the ranks of level l, which are
+  // level_ranks[level_offsets[l]] to level_ranks[level_offsets[l + 1] - 1],
+  // are customized concurrently.
+  std::vector<unsigned> level_offsets;
+  std::vector<unsigned> level_ranks;
+};
+
+// The costs of a contraction hierarchy under a metric.
+struct HierarchyMetric {
+  // The cost of the up and down direction of each arc.
+  std::vector<float> up_costs;
+  std::vector<float> down_costs;
+
+  // The lower triangle a shortcut direction is made of, identified by the
+  // lower arc sharing the tail of the arc. The other lower arc shares the head.
+  // Say the arc is (v, w) and the lower triangle is made of the arcs (u, v)
+  // and (u, w), then v->w goes through v->u->w, and w->v through w->u->v. It's
+  // kNoHierarchyArc when the direction is an edge of the network.
+  std::vector<unsigned> up_triangle_tail_arcs;
+  std::vector<unsigned> up_triangle_head_arcs;
+  std::vector<unsigned> down_triangle_tail_arcs;
+  std::vector<unsigned> down_triangle_head_arcs;
+};
+
+// The shortest paths from a source within a time horizon, over the vertex
+// ranks of a contraction hierarchy.
+struct HierarchyPaths {
+  explicit HierarchyPaths(unsigned vertex_count);
+
+  // The time cost to reach each rank.
+  std::vector<float> time_cost;
+
+  // The rank preceding each rank on its shortest path, and the arc direction
+  // leading from it, which is 2 * arc for up and 2 * arc + 1 for down. They
+  // are only valid for the settled ranks other than the source.
+  std::vector<unsigned> parents;
+  std::vector<unsigned> parent_arc_directions;
+
+  // The ranks within the horizon. The source comes first, and every rank comes
+  // after its parent.
+  std::vector<unsigned> settle_order;
+
+  // Scratch buffers. The children of rank r are children[first_children[r]]
+  // to children[first_children[r + 1] - 1].
+  std::vector<unsigned> first_children;
+  std::vector<unsigned> children;
+};
+
+// Orders the vertices by minimum degree elimination and builds the chordal
+// supergraph that the elimination fills in.
+ContractionHierarchy CreateContractionHierarchy(FlowNetwork const &network);
+
+// Computes the arc costs from the edge costs of the network. The vertices of a
+// level are customized in parallel when multithreaded.
+void CustomizeContractionHierarchy(ContractionHierarchy const &hierarchy,
+                                   std::vector<float> const &edge_costs,
+                                   HierarchyMetric *metric,
+                                   bool multithreaded = true);
+
+// Computes the shortest paths from the source rank to every rank within the
+// horizon, by an upward search from the source followed by a downward sweep
+// over all the ranks.
+void ComputeHierarchyPaths(ContractionHierarchy const &hierarchy,
+                           HierarchyMetric const &metric, unsigned source_rank,
+                           float horizon, HierarchyPaths *paths);
+
+// Unpacks the flows over the arc directions, indexed as in
+// HierarchyPaths::parent_arc_directions, into the flows over the edges of the
+// network. The arc flows are consumed.
+void UnpackArcFlows(ContractionHierarchy const &hierarchy,
+                    HierarchyMetric const &metric,
+                    std::vector<float> *arc_direction_flows,
+                    std::vector<float> *edge_flows);
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,200 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/flow/hierarchy.hpp"
+#include "procedural/probing/flow/network.hpp"
+#include "procedural/probing/flow/simulate.hpp"
+#include "procedural/probing/flow/time_cost.hpp"
+#include "procedural/probing/probe/probe.hpp"
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+#include <boost/property_map/property_map.hpp>
+#include <boost/test/unit_test.hpp>
+#include <eigen3/Eigen/Core>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+unsigned const kGridSize = 10;
+
+// A grid of probes roughly 500 meters apart. The probes are jittered so that
+// the shortest paths are unique.
+FlowNetwork CreateJitteredGridNetwork() {
+  std::default_random_engine random_engine(7);
+  std::uniform_real_distribution<float> jitter(-100, 100);
+
+  std::vector<PopulationProbe> probes;
+  std::vector<std::pair<unsigned, unsigned>> connections;
+  for (unsigned i = 0; i < kGridSize; ++i) {
+    for (unsigned j = 0; j < kGridSize; ++j) {
+      probes.push_back(PopulationProbe(
+          Eigen::Vector3f(i * 500 + jitter(random_engine),
+                          j * 500 + jitter(random_engine), 0),
+          /*population_grid_200=*/1e3f));
+
+      unsigned v = i * kGridSize + j;
+      if (i > 0) {
+        connections.push_back(std::make_pair(v - kGridSize, v));
+      }
+      if (j > 0) {
+        connections.push_back(std::make_pair(v - 1, v));
+      }
+    }
+  }
+  return CreateFlowNetwork(probes, connections);
+}
+
+// Loads the network with uneven flows, so the costs of the two directions of
+// a connection differ.
+FlowState CreateUnevenFlowState(FlowNetwork const &network) {
+  std::default_random_engine random_engine(11);
+  std::uniform_real_distribution<float> flow(0, 2e4f);
+
+  FlowState state(network);
+  for (unsigned i = 0; i < network.EdgeCount(); ++i) {
+    state.flow[i] = flow(random_engine);
+  }
+  UpdateFlowCosts(network, &state);
+  return state;
+}
+
+BOOST_AUTO_TEST_CASE(WhenHierarchyIsCreated_ThenCheckArcsGoUpward) {
+  FlowNetwork network = CreateJitteredGridNetwork();
+  ContractionHierarchy hierarchy = CreateContractionHierarchy(network);
+
+  BOOST_CHECK_EQUAL(network.VertexCount(), hierarchy.VertexCount());
+  for (unsigned r = 0; r < hierarchy.VertexCount(); ++r) {
+    BOOST_CHECK_EQUAL(r, hierarchy.ranks[hierarchy.vertices[r]]);
+    for (unsigned arc = hierarchy.first_arcs[r];
+         arc < hierarchy.first_arcs[r + 1]; ++arc) {
+      BOOST_CHECK_EQUAL(r, hierarchy.arc_tails[arc]);
+      BOOST_CHECK_LT(r, hierarchy.arc_heads[arc]);
+    }
+  }
+
+  // Every edge of the network is an arc direction.
+  unsigned edge_count = 0;
+  for (unsigned arc = 0; arc < hierarchy.ArcCount(); ++arc) {
+    edge_count += hierarchy.up_edges[arc] != kNoFlowEdge;
+    edge_count += hierarchy.down_edges[arc] != kNoFlowEdge;
+  }
+  BOOST_CHECK_EQUAL(network.EdgeCount(), edge_count);
+}
+
+BOOST_AUTO_TEST_CASE(WhenPathsAreComputed_ThenCheckTimeCostsMatchDijkstra) {
+  FlowNetwork network = CreateJitteredGridNetwork();
+  FlowState state = CreateUnevenFlowState(network);
+  ContractionHierarchy hierarchy = CreateContractionHierarchy(network);
+  HierarchyMetric metric;
+  CustomizeContractionHierarchy(hierarchy, state.cost, &metric);
+
+  HierarchyPaths paths(network.VertexCount());
+  std::vector<float> expected_time_cost(network.VertexCount());
+  for (unsigned source = 0; source < network.VertexCount(); ++source) {
+    boost::dijkstra_shortest_paths(
+        network.graph, boost::vertex(source, network.graph),
+        boost::weight_map(boost::make_iterator_property_map(
+                              state.cost.begin(),
+                              boost::get(boost::edge_index, network.graph)))
+            .distance_map(boost::make_iterator_property_map(
+                expected_time_cost.begin(),
+                boost::get(boost::vertex_index, network.graph))));
+    ComputeHierarchyPaths(hierarchy, metric, hierarchy.ranks[source],
+                          /*horizon=*/1e6f, &paths);
+
+    BOOST_CHECK_EQUAL(network.VertexCount(), paths.settle_order.size());
+    BOOST_CHECK_EQUAL(hierarchy.ranks[source], paths.settle_order[0]);
+    for (unsigned v = 0; v < network.VertexCount(); ++v) {
+      BOOST_CHECK_CLOSE(expected_time_cost[v],
+                        paths.time_cost[hierarchy.ranks[v]], 1e-3f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenHorizonIsShort_ThenCheckFarRanksAreLeftOut) {
+  FlowNetwork network = CreateJitteredGridNetwork();
+  FlowState state = CreateUnevenFlowState(network);
+  ContractionHierarchy hierarchy = CreateContractionHierarchy(network);
+  HierarchyMetric metric;
+  CustomizeContractionHierarchy(hierarchy, state.cost, &metric);
+
+  HierarchyPaths paths(network.VertexCount());
+  ComputeHierarchyPaths(hierarchy, metric, /*source_rank=*/0,
+                        /*horizon=*/200, &paths);
+
+  BOOST_CHECK_LT(paths.settle_order.size(), network.VertexCount());
+  for (unsigned r : paths.settle_order) {
+    BOOST_CHECK_LE(paths.time_cost[r], 200);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenCostsAreTiedOrZero_ThenCheckParentsAreSettledFirst) {
+  FlowNetwork network = CreateJitteredGridNetwork();
+  ContractionHierarchy hierarchy = CreateContractionHierarchy(network);
+
+  // Every other edge is free, and the rest cost the same, so that the upward
+  // search and the sweep tie on many ranks.
+  std::vector<float> costs(network.EdgeCount());
+  for (unsigned i = 0; i < network.EdgeCount(); ++i) {
+    costs[i] = i % 2 == 0 ? 0.0f : 60.0f;
+  }
+  HierarchyMetric metric;
+  CustomizeContractionHierarchy(hierarchy, costs, &metric);
+
+  HierarchyPaths paths(network.VertexCount());
+  std::vector<unsigned> positions(network.VertexCount());
+  for (unsigned source = 0; source < network.VertexCount(); ++source) {
+    unsigned source_rank = hierarchy.ranks[source];
+    ComputeHierarchyPaths(hierarchy, metric, source_rank,
+                          /*horizon=*/1e6f, &paths);
+
+    BOOST_REQUIRE_EQUAL(network.VertexCount(), paths.settle_order.size());
+    BOOST_CHECK_EQUAL(source_rank, paths.settle_order[0]);
+    for (unsigned i = 0; i < paths.settle_order.size(); ++i) {
+      positions[paths.settle_order[i]] = i;
+    }
+    for (unsigned r = 0; r < network.VertexCount(); ++r) {
+      if (r != source_rank) {
+        BOOST_CHECK_LT(positions[paths.parents[r]], positions[r]);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenFlowIsSimulatedOverHierarchy_ThenCheckItMatches) {
+  FlowNetwork network = CreateJitteredGridNetwork();
+  FlowState state = CreateUnevenFlowState(network);
+  ContractionHierarchy hierarchy = CreateContractionHierarchy(network);
+
+  std::vector<float> expected_flow;
+  SimulateFlow(network, state, &expected_flow);
+  std::vector<float> hierarchy_flow;
+  SimulateFlow(network, state, hierarchy, &hierarchy_flow);
+
+  BOOST_CHECK_EQUAL(expected_flow.size(), hierarchy_flow.size());
+  for (unsigned i = 0; i < expected_flow.size(); ++i) {
+    BOOST_CHECK_CLOSE(expected_flow[i], hierarchy_flow[i], 1e-2f);
+  }
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
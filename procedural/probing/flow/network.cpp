@@ -0,0 +1,150 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/flow/network.hpp"
+#include "procedural/probing/flow/topology.hpp"
+#include "procedural/probing/probe/probe.hpp"
+#include <algorithm>
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+// The edges must be sorted by their source vertex. The edge IDs follow the
+// order of the edges.
+FlowNetwork
+CreateFlowNetworkWith(std::vector<std::pair<unsigned, unsigned>> const &edges,
+                      std::vector<PopulationProbe> const &probes) {
+  FlowNetwork network{
+      .graph = FlowGraph(boost::edges_are_sorted, edges.begin(), edges.end(),
+                         probes.size()),
+      .sources = std::vector<unsigned>(edges.size()),
+      .reverse_edges = std::vector<unsigned>(edges.size()),
+      .distances = std::vector<float>(edges.size()),
+      .population = std::vector<float>(probes.size()),
+  };
+
+  for (unsigned i = 0; i < edges.size(); ++i) {
+    auto [u, v] = edges[i];
+    assert(FindFlowEdge(u, v, network.graph) == i);
+
+    network.sources[i] = u;
+    network.reverse_edges[i] = FindFlowEdge(v, u, network.graph);
+    assert(network.reverse_edges[i] != kNoFlowEdge);
+
+    assert(probes[u].location != probes[v].location);
+    network.distances[i] = (probes[v].location - probes[u].location).norm();
+  }
+
+  for (unsigned i = 0; i < probes.size(); ++i) {
+    network.population[i] = probes[i].population_grid_200;
+  }
+
+  return network;
+}
+
+} // namespace
+
+unsigned FindFlowEdge(unsigned u, unsigned v, FlowGraph const &graph) {
+  for (auto [current, end] = boost::out_edges(u, graph); current != end;
+       ++current) {
+    if (boost::target(*current, graph) == v) {
+      return boost::get(boost::edge_index, graph, *current);
+    }
+  }
+  return kNoFlowEdge;
+}
+
+unsigned FlowNetwork::VertexCount() const { return boost::num_vertices(graph); }
+
+unsigned FlowNetwork::EdgeCount() const { return boost::num_edges(graph); }
+
+FlowState::FlowState(FlowNetwork const &network)
+    : flow(network.EdgeCount(), 0.0f), lane_count(network.EdgeCount(), 1),
+      cost(network.EdgeCount(), 0.0f),
+      incoming_flow(network.VertexCount(), 0.0f) {}
+
+FlowNetwork CreateFlowNetwork(
+    std::vector<PopulationProbe> const &probes,
+    std::vector<std::pair<unsigned, unsigned>> const &connections) {
+  std::vector<std::pair<unsigned, unsigned>> edges;
+  edges.reserve(2 * connections.size());
+  for (auto [u, v] : connections) {
+    assert(u < probes.size());
+    assert(v < probes.size());
+    edges.push_back(std::make_pair(u, v));
+    edges.push_back(std::make_pair(v, u));
+  }
+  std::stable_sort(edges.begin(), edges.end(),
+                   [](auto const &a, auto const &b) {
+                     return a.first < b.first;
+                   });
+
+  return CreateFlowNetworkWith(edges, probes);
+}
+
+std::vector<boost::graph_traits<TopologyFlow>::edge_descriptor>
+FlowEdgesInIdOrder(TopologyFlow const &flow) {
+  // boost::edges() follows the insertion order of the edges rather than their
+  // source vertices.
+  std::vector<boost::graph_traits<TopologyFlow>::edge_descriptor> edges;
+  edges.reserve(boost::num_edges(flow));
+  for (auto [v, v_end] = boost::vertices(flow); v != v_end; ++v) {
+    for (auto [current, end] = boost::out_edges(*v, flow); current != end;
+         ++current) {
+      edges.push_back(*current);
+    }
+  }
+  return edges;
+}
+
+FlowNetwork CreateFlowNetworkFrom(TopologyFlow const &flow,
+                                  std::vector<PopulationProbe> const &probes) {
+  assert(boost::num_vertices(flow) == probes.size());
+
+  // The edges are enumerated vertex by vertex, so they are already sorted.
+  std::vector<std::pair<unsigned, unsigned>> edges;
+  edges.reserve(boost::num_edges(flow));
+  for (auto const &edge : FlowEdgesInIdOrder(flow)) {
+    edges.push_back(
+        std::make_pair(boost::source(edge, flow), boost::target(edge, flow)));
+  }
+
+  return CreateFlowNetworkWith(edges, probes);
+}
+
+FlowState CreateFlowStateFrom(TopologyFlow const &flow,
+                              FlowNetwork const &network) {
+  assert(boost::num_edges(flow) == network.EdgeCount());
+
+  FlowState state(network);
+  unsigned id = 0;
+  for (auto const &edge : FlowEdgesInIdOrder(flow)) {
+    assert(network.sources[id] == boost::source(edge, flow));
+    state.flow[id] = boost::get(&FlowProperties::flow, flow, edge);
+    state.lane_count[id] = boost::get(&FlowProperties::lane_count, flow, edge);
+    ++id;
+  }
+  return state;
+}
+
+} // namespace procedural
+} // namespace e8
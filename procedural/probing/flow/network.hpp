@@ -0,0 +1,108 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "procedural/probing/flow/topology.hpp"
+#include "procedural/probing/probe/probe.hpp"
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// The directed connections of a flow network in compressed sparse row form.
+// The edges are identified by their built-in edge index, which runs over the
+// out-edges of vertex 0, then vertex 1, and so on.
+using FlowGraph = boost::compressed_sparse_row_graph<
+    /*Directed=*/boost::directedS, /*VertexProperty=*/boost::no_property,
+    /*EdgeProperty=*/boost::no_property, /*GraphProperty=*/boost::no_property,
+    /*Vertex=*/unsigned, /*EdgeIndex=*/unsigned>;
+
+// Denotes the absence of an edge.
+constexpr unsigned const kNoFlowEdge = std::numeric_limits<unsigned>::max();
+
+// Finds the ID of the edge u->v, or kNoFlowEdge when there isn't one.
+unsigned FindFlowEdge(unsigned u, unsigned v, FlowGraph const &graph);
+
+// The part of a flow network which stays unchanged while the flows are being
+// estimated. Per edge quantities are flat arrays indexed by the edge ID.
+struct FlowNetwork {
+  FlowGraph graph;
+
+  // The source vertex of each edge.
+  std::vector<unsigned> sources;
+
+  // The ID of the edge running in the opposite direction of each edge.
+  std::vector<unsigned> reverse_edges;
+
+  // The length of each edge in meters.
+  std::vector<float> distances;
+
+  // The population at each vertex.
+  std::vector<float> population;
+
+  unsigned VertexCount() const;
+  unsigned EdgeCount() const;
+};
+
+// The flow measured over a flow network. Per edge quantities are flat arrays
+// indexed by the edge ID.
+struct FlowState {
+  explicit FlowState(FlowNetwork const &network);
+
+  // The flow over each edge.
+  std::vector<float> flow;
+
+  // The number of lanes of each edge.
+  std::vector<unsigned> lane_count;
+
+  // The number of seconds to traverse each edge. It derives from the above by
+  // UpdateFlowCosts().
+  std::vector<float> cost;
+
+  // The total flow entering each vertex. It derives from the above by
+  // UpdateFlowCosts().
+  std::vector<float> incoming_flow;
+};
+
+// Creates a flow network over the probes. Every connection (u, v) is made of
+// a pair of directed edges u->v and v->u. The edges leaving the same vertex
+// keep the order of the connections.
+FlowNetwork CreateFlowNetwork(
+    std::vector<PopulationProbe> const &probes,
+    std::vector<std::pair<unsigned, unsigned>> const &connections);
+
+// Lists the edges of the topology flow in the order of their IDs in the flow
+// network created from it, that is, vertex by vertex over the out-edges.
+std::vector<boost::graph_traits<TopologyFlow>::edge_descriptor>
+FlowEdgesInIdOrder(TopologyFlow const &flow);
+
+// Creates a flow network with the same edges as the topology flow, where the
+// edge IDs follow the order of FlowEdgesInIdOrder(flow). Every edge must have
+// a reverse edge.
+FlowNetwork CreateFlowNetworkFrom(TopologyFlow const &flow,
+                                  std::vector<PopulationProbe> const &probes);
+
+// Copies the flows and lane counts out of the topology flow, which must be the
+// one the network is created from.
+FlowState CreateFlowStateFrom(TopologyFlow const &flow,
+                              FlowNetwork const &network);
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,123 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/flow/network.hpp"
+#include "procedural/probing/flow/topology.hpp"
+#include "procedural/probing/probe/probe.hpp"
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/compressed_sparse_row_graph.hpp>
+#include <boost/test/unit_test.hpp>
+#include <eigen3/Eigen/Core>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+std::vector<PopulationProbe> CreateGridProbes() {
+  std::vector<PopulationProbe> probes;
+  for (int y = 1; y >= -1; --y) {
+    for (int x = -1; x <= 1; ++x) {
+      probes.push_back(PopulationProbe(Eigen::Vector3f(x * 1000, y * 1000, 0),
+                                       /*population_grid_200=*/1e2f));
+    }
+  }
+  return probes;
+}
+
+BOOST_AUTO_TEST_CASE(WhenCreateFromConnections_ThenCheckPairedEdges) {
+  std::vector<PopulationProbe> probes = CreateGridProbes();
+  FlowNetwork network =
+      CreateFlowNetwork(probes, {std::make_pair(4, 1), std::make_pair(3, 4),
+                                 std::make_pair(4, 5)});
+
+  BOOST_CHECK_EQUAL(9, network.VertexCount());
+  BOOST_CHECK_EQUAL(6, network.EdgeCount());
+
+  for (auto [current, end] = boost::edges(network.graph); current != end;
+       ++current) {
+    unsigned id = boost::get(boost::edge_index, network.graph, *current);
+    unsigned reverse = network.reverse_edges[id];
+
+    BOOST_CHECK_EQUAL(id, network.reverse_edges[reverse]);
+    BOOST_CHECK_EQUAL(boost::source(*current, network.graph),
+                      network.sources[id]);
+    BOOST_CHECK_EQUAL(boost::target(*current, network.graph),
+                      network.sources[reverse]);
+    BOOST_CHECK_CLOSE(1000.f, network.distances[id], 1e-3f);
+  }
+
+  // The edges leaving vertex 4 keep the order of the connections.
+  std::vector<unsigned> targets;
+  for (auto [current, end] = boost::out_edges(4U, network.graph);
+       current != end; ++current) {
+    targets.push_back(boost::target(*current, network.graph));
+  }
+  BOOST_CHECK((std::vector<unsigned>{1, 3, 5}) == targets);
+}
+
+BOOST_AUTO_TEST_CASE(WhenCreateFromTopologyFlow_ThenCheckEdgeOrder) {
+  std::vector<PopulationProbe> probes = CreateGridProbes();
+  TopologyFlow flow = testing::CreateGridTopologyFlow(/*flow_value=*/5.f);
+  auto [edge_47, exists_47] = boost::edge(4, 7, flow);
+  BOOST_REQUIRE(exists_47);
+  boost::put(&FlowProperties::lane_count, flow, edge_47, 2);
+
+  FlowNetwork network = CreateFlowNetworkFrom(flow, probes);
+  FlowState state = CreateFlowStateFrom(flow, network);
+  BOOST_REQUIRE_EQUAL(boost::num_edges(flow), network.EdgeCount());
+
+  unsigned id = 0;
+  for (auto const &edge : FlowEdgesInIdOrder(flow)) {
+    BOOST_CHECK_EQUAL(boost::source(edge, flow), network.sources[id]);
+    BOOST_CHECK_EQUAL(boost::target(edge, flow),
+                      network.sources[network.reverse_edges[id]]);
+    BOOST_CHECK_EQUAL(5.f, state.flow[id]);
+    BOOST_CHECK_EQUAL(boost::get(&FlowProperties::lane_count, flow, edge),
+                      state.lane_count[id]);
+    ++id;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenTopologyFlowEdgesAreUnsorted_ThenCheckEdgeOrder) {
+  std::vector<PopulationProbe> probes = CreateGridProbes();
+  TopologyFlow flow(probes.size());
+  boost::add_edge(2, 1, FlowProperties(/*flow=*/21.f, /*lane_count=*/1), flow);
+  boost::add_edge(1, 2, FlowProperties(/*flow=*/12.f, /*lane_count=*/1), flow);
+  boost::add_edge(1, 0, FlowProperties(/*flow=*/10.f, /*lane_count=*/1), flow);
+  boost::add_edge(0, 1, FlowProperties(/*flow=*/1.f, /*lane_count=*/1), flow);
+
+  FlowNetwork network = CreateFlowNetworkFrom(flow, probes);
+  FlowState state = CreateFlowStateFrom(flow, network);
+
+  BOOST_CHECK((std::vector<unsigned>{0, 1, 1, 2}) == network.sources);
+  for (auto [current, end] = boost::edges(network.graph); current != end;
+       ++current) {
+    unsigned id = boost::get(boost::edge_index, network.graph, *current);
+    auto [edge, existence] =
+        boost::edge(boost::source(*current, network.graph),
+                    boost::target(*current, network.graph), flow);
+    BOOST_REQUIRE(existence);
+    BOOST_CHECK_EQUAL(boost::get(&FlowProperties::flow, flow, edge),
+                      state.flow[id]);
+  }
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
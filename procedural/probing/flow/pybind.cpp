@@ -33,9 +33,53 @@ void RegisterFlowTopology(pybind11::module *m) {
       .def_readonly("lane_count", &ProbeConnectionFlow::lane_count,
                     pybind11::return_value_policy::copy);
 
+  pybind11::class_<ProbeTopologyFlowResult>(*m, "ProbeTopologyFlowResult")
+      .def(pybind11::init<>())
+      .def_readonly("flows", &ProbeTopologyFlowResult::flows,
+                    pybind11::return_value_policy::copy)
+      .def_readonly("iteration_count",
+                    &ProbeTopologyFlowResult::iteration_count,
+                    pybind11::return_value_policy::copy)
+      .def_readonly("averaged_iteration_count",
+                    &ProbeTopologyFlowResult::averaged_iteration_count,
+                    pybind11::return_value_policy::copy)
+      .def_readonly("relative_gap", &ProbeTopologyFlowResult::relative_gap,
+                    pybind11::return_value_policy::copy)
+      .def_readonly("flow_changes", &ProbeTopologyFlowResult::flow_changes,
+                    pybind11::return_value_policy::copy);
+
   // Function.
   m->def("EstimateProbeTopologyFlow", &EstimateProbeTopologyFlow,
-         pybind11::return_value_policy::copy);
+         pybind11::return_value_policy::copy, pybind11::arg("probes"),
+         pybind11::arg("connections"), pybind11::arg("iteration_count"),
+         pybind11::arg("reorder_probes") = false,
+         pybind11::arg("origin_sample_count") = 0,
+         pybind11::arg("origin_cluster_radius") = 0.0f,
+         pybind11::arg("use_contraction_hierarchy") = false);
+  m->def("EstimateProbeTopologyFlowScenarios",
+         &EstimateProbeTopologyFlowScenarios,
+         pybind11::return_value_policy::copy, pybind11::arg("probes"),
+         pybind11::arg("connections"),
+         pybind11::arg("scenario_populations"),
+         pybind11::arg("iteration_count"),
+         pybind11::arg("reorder_probes") = false);
+  m->def("EstimateProbeTopologyFlowEquilibrium",
+         &EstimateProbeTopologyFlowEquilibrium,
+         pybind11::return_value_policy::copy, pybind11::arg("probes"),
+         pybind11::arg("connections"), pybind11::arg("max_iteration_count"),
+         pybind11::arg("tolerance"), pybind11::arg("reorder_probes") = false,
+         pybind11::arg("origin_sample_count") = 0,
+         pybind11::arg("origin_cluster_radius") = 0.0f,
+         pybind11::arg("use_contraction_hierarchy") = false);
+  m->def("ReestimateProbeTopologyFlow", &ReestimateProbeTopologyFlow,
+         pybind11::return_value_policy::copy, pybind11::arg("probes"),
+         pybind11::arg("connections"), pybind11::arg("previous_flows"),
+         pybind11::arg("prior_iteration_count"),
+         pybind11::arg("max_iteration_count"), pybind11::arg("tolerance"),
+         pybind11::arg("reorder_probes") = false,
+         pybind11::arg("origin_sample_count") = 0,
+         pybind11::arg("origin_cluster_radius") = 0.0f,
+         pybind11::arg("use_contraction_hierarchy") = false);
 }
 
 } // namespace procedural
@@ -15,13 +15,25 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/flow/simulate.hpp"
+#include "procedural/probing/flow/cluster.hpp"
+#include "procedural/probing/flow/hierarchy.hpp"
+#include "procedural/probing/flow/network.hpp"
 #include "procedural/probing/flow/time_cost.hpp"
-#include "procedural/probing/flow/topology.hpp"
-#include "procedural/probing/probe/probe.hpp"
-#include <boost/graph/adjacency_list.hpp>
+#include "procedural/probing/kernel/likelihood.hpp"
+#include "procedural/probing/parallel/parallel.hpp"
+#include "procedural/probing/path/delta_stepping.hpp"
+#include "procedural/probing/path/graph.hpp"
+#include "procedural/probing/path/multi_source.hpp"
+#include "procedural/probing/topology/sampler.hpp"
+#include <algorithm>
+#include <boost/graph/compressed_sparse_row_graph.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
+#include <boost/property_map/property_map.hpp>
 #include <cassert>
-#include <numbers>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
 #include <vector>
 
 namespace e8 {
@@ -31,138 +43,923 @@ namespace {
 constexpr float const kAcos04 = 1.159279481f;
 constexpr float const kMaxTolerableTravelTimeSeconds = 3600.0f;
 
-TopologyFlow CreateNewFlowsFrom(TopologyFlow const &previous_flow) {
-  TopologyFlow new_flows(boost::num_vertices(previous_flow));
+TravelLikelihoodKernel const kTravelLikelihood(
+    /*phi=*/-kAcos04,
+    /*max_time_seconds=*/kMaxTolerableTravelTimeSeconds);
 
-  for (auto [current, end] = boost::edges(previous_flow); current != end;
-       ++current) {
-    unsigned previous_lane_count =
-        boost::get(&FlowProperties::lane_count, previous_flow, *current);
-    FlowProperties new_properties(/*flow=*/0,
-                                  /*lane_count=*/previous_lane_count);
-    auto [edge, successful] =
-        boost::add_edge(current->m_source, current->m_target, new_flows);
-    assert(successful);
+unsigned const kEdgesPerChunk = 4096;
+unsigned const kMinVerticesPerChunk = 4096;
+
+// Multithreaded, the flows out of the sources are accumulated per chunk of
+// consecutive sources, then the chunks are summed up in the order of their
+// indices. The chunks only depend on the number of sources, not on the thread
+// budget, so neither do the bits of the simulated flows.
+unsigned const kMinSourcesPerChunk = 16;
+unsigned const kMaxSourceChunkCount = 64;
+
+// Below this size, a search is too short to be worth sharing amongst workers.
+unsigned const kMinVerticesPerParallelSearch = 1 << 14;
+
+// The shortest path tree rooted at a source, limited to the vertices within
+// the travel time horizon. The buffers are reused across sources. The vertex
+// and edge IDs are stored as Index, see FitsCompactIndex().
+template <typename Index> struct SimulatedPaths {
+  explicit SimulatedPaths(unsigned vertex_count)
+      : time_cost(vertex_count), predecessor_edges(vertex_count) {
+    settle_order.reserve(vertex_count);
   }
 
-  return new_flows;
+  std::vector<float> time_cost;
+
+  // The ID of the last edge on the shortest path to each vertex. It's only
+  // valid for the settled vertices other than the source.
+  std::vector<Index> predecessor_edges;
+
+  // The vertices within the horizon in the order they are settled. The source
+  // comes first, and every vertex comes after its predecessor.
+  std::vector<Index> settle_order;
+};
+
+// Whether every vertex and edge ID of the network fits into 16 bits, which
+// halves the per source buffers of SimulatedPaths streamed by the flow
+// accumulation. Every simulation over SimulatedPaths picks its index by it.
+bool FitsCompactIndex(FlowNetwork const &network) {
+  return network.VertexCount() <= std::numeric_limits<std::uint16_t>::max() &&
+         network.EdgeCount() <= std::numeric_limits<std::uint16_t>::max();
 }
 
-struct SimulatedPaths {
-  SimulatedPaths(unsigned vertex_count,
-                 FlowCostMap::vertex_descriptor const &source)
-      : time_cost(vertex_count), source(source), predecessors(vertex_count) {}
+// The travel population from a source to the destinations within the travel
+// time horizon. The entries are aligned with the settle order of the source's
+// shortest path tree, so the destinations beyond the horizon are never
+// enumerated.
+struct SparseDemand {
+  explicit SparseDemand(unsigned vertex_count) {
+    time_cost.reserve(vertex_count);
+    population.reserve(vertex_count);
+    travel_population.reserve(vertex_count);
+  }
 
   std::vector<float> time_cost;
-  FlowCostMap::vertex_descriptor source;
-  std::vector<FlowCostMap::vertex_descriptor> predecessors;
+  std::vector<float> population;
+  std::vector<float> travel_population;
+};
+
+// The travel population of several demand scenarios from a source. The
+// scenarios are interleaved: travel_population[i * K + k] is the travel
+// population of scenario k to the i-th destination, for K scenarios, so that
+// the scenarios of a destination are processed in SIMD lanes.
+struct ScenarioDemand {
+  ScenarioDemand(unsigned vertex_count, unsigned scenario_count)
+      : evidence(scenario_count), scale(scenario_count) {
+    time_cost.reserve(vertex_count);
+    likelihood.reserve(vertex_count);
+    travel_population.reserve(vertex_count * scenario_count);
+  }
+
+  std::vector<float> time_cost;
+  std::vector<float> likelihood;
+  std::vector<float> travel_population;
+
+  // Per scenario scratch buffers.
+  std::vector<float> evidence;
+  std::vector<float> scale;
 };
 
-SimulatedPaths SimulatePathsFrom(unsigned probe_index,
-                                 FlowCostMap const &flow_cost) {
-  FlowCostMap::vertex_descriptor source = boost::vertex(probe_index, flow_cost);
-  SimulatedPaths result(boost::num_vertices(flow_cost), source);
-  boost::dijkstra_shortest_paths(flow_cost, source,
-                                 boost::distance_map(&result.time_cost[0])
-                                     .predecessor_map(&result.predecessors[0]));
-  return result;
+// Thrown to stop the search once the horizon is passed.
+struct HorizonReached {};
+
+template <typename Index>
+class ShortestPathTreeRecorder : public boost::default_dijkstra_visitor {
+public:
+  explicit ShortestPathTreeRecorder(SimulatedPaths<Index> *paths)
+      : paths_(paths) {}
+
+  void examine_vertex(FlowGraph::vertex_descriptor u, FlowGraph const &) {
+    if (paths_->time_cost[u] > kMaxTolerableTravelTimeSeconds) {
+      // The remaining vertices are even farther, where no one travels to.
+      throw HorizonReached();
+    }
+    paths_->settle_order.push_back(u);
+  }
+
+private:
+  SimulatedPaths<Index> *paths_;
+};
+
+// Reaches the vertex through its canonical predecessor edge, the incoming edge
+// which minimizes the time cost of the vertex, the one of the smallest ID
+// amongst ties. Any search which computes the same time costs thus agrees on
+// the shortest path tree.
+template <typename Index>
+void PickCanonicalPredecessor(unsigned v, FlowNetwork const &network,
+                              std::vector<float> const &costs,
+                              SimulatedPaths<Index> *paths) {
+  float min_time_cost = kUnreachedTimeCost;
+  unsigned min_edge = std::numeric_limits<unsigned>::max();
+  for (auto [current, end] = boost::out_edges(v, network.graph);
+       current != end; ++current) {
+    unsigned incoming = network.reverse_edges[boost::get(
+        boost::edge_index, network.graph, *current)];
+    float time_cost =
+        paths->time_cost[network.sources[incoming]] + costs[incoming];
+    if (time_cost < min_time_cost ||
+        (time_cost == min_time_cost && incoming < min_edge)) {
+      min_time_cost = time_cost;
+      min_edge = incoming;
+    }
+  }
+  paths->predecessor_edges[v] = min_edge;
+}
+
+// Reorders the vertices of equal time cost in the settle order by their IDs,
+// then picks the canonical predecessor of every settled vertex but the source.
+// The settle order must already be sorted by the time costs.
+template <typename Index>
+void CanonicalizeShortestPathTree(FlowNetwork const &network,
+                                  std::vector<float> const &costs,
+                                  SimulatedPaths<Index> *paths) {
+  auto &settle_order = paths->settle_order;
+  for (unsigned begin = 1; begin < settle_order.size();) {
+    float time_cost = paths->time_cost[settle_order[begin]];
+    unsigned end = begin + 1;
+    while (end < settle_order.size() &&
+           paths->time_cost[settle_order[end]] == time_cost) {
+      ++end;
+    }
+    if (end - begin > 1) {
+      std::sort(settle_order.begin() + begin, settle_order.begin() + end);
+    }
+    begin = end;
+  }
+  for (unsigned i = 1; i < settle_order.size(); ++i) {
+    PickCanonicalPredecessor(settle_order[i], network, costs, paths);
+  }
+}
+
+template <typename Index>
+void SimulatePathsFrom(unsigned probe_index, FlowNetwork const &network,
+                       std::vector<float> const &costs,
+                       SimulatedPaths<Index> *paths) {
+  paths->settle_order.clear();
+  try {
+    boost::dijkstra_shortest_paths(
+        network.graph, boost::vertex(probe_index, network.graph),
+        boost::weight_map(boost::make_iterator_property_map(
+                              costs.begin(),
+                              boost::get(boost::edge_index, network.graph)))
+            .distance_map(boost::make_iterator_property_map(
+                paths->time_cost.begin(),
+                boost::get(boost::vertex_index, network.graph)))
+            .visitor(ShortestPathTreeRecorder<Index>(paths)));
+  } catch (HorizonReached const &) {
+    // Early termination is the only way out of a Boost.Graph search.
+  }
+  CanonicalizeShortestPathTree(network, costs, paths);
+}
+
+// Lays the flow network out for the searches under path/. The arcs are the
+// edges in the order of their IDs.
+PathGraph CreatePathGraph(FlowNetwork const &network,
+                          std::vector<float> const &costs) {
+  PathGraph graph;
+  graph.first_arcs.assign(network.VertexCount() + 1, 0);
+  for (unsigned source : network.sources) {
+    ++graph.first_arcs[source + 1];
+  }
+  for (unsigned v = 0; v < network.VertexCount(); ++v) {
+    graph.first_arcs[v + 1] += graph.first_arcs[v];
+  }
+  graph.heads.resize(network.EdgeCount());
+  for (unsigned id = 0; id < network.EdgeCount(); ++id) {
+    graph.heads[id] = network.sources[network.reverse_edges[id]];
+  }
+  graph.costs = costs;
+  return graph;
+}
+
+// Recovers the shortest path tree from the time costs computed by one of the
+// searches under path/. The source is settled first, then the other vertices
+// in the order of their time costs and IDs, and each one is reached through
+// its canonical predecessor edge, see PickCanonicalPredecessor(). The tree is
+// thus the same as SimulatePathsFrom()'s. The edge costs must be positive.
+template <typename Index>
+void RecoverShortestPathTree(unsigned probe_index, FlowNetwork const &network,
+                             PathGraph const &path_graph, bool multithreaded,
+                             SimulatedPaths<Index> *paths) {
+  paths->settle_order.clear();
+  paths->settle_order.push_back(probe_index);
+  for (unsigned v = 0; v < network.VertexCount(); ++v) {
+    if (v != probe_index &&
+        paths->time_cost[v] <= kMaxTolerableTravelTimeSeconds) {
+      paths->settle_order.push_back(v);
+    }
+  }
+  std::sort(paths->settle_order.begin() + 1, paths->settle_order.end(),
+            [paths](unsigned a, unsigned b) {
+              return paths->time_cost[a] < paths->time_cost[b] ||
+                     (paths->time_cost[a] == paths->time_cost[b] && a < b);
+            });
+
+  unsigned count = paths->settle_order.size() - 1;
+  ParallelForChunks(
+      count,
+      [&network, &path_graph, paths](unsigned, unsigned begin, unsigned end) {
+        for (unsigned i = begin + 1; i < end + 1; ++i) {
+          PickCanonicalPredecessor(paths->settle_order[i], network,
+                                   path_graph.costs, paths);
+        }
+      },
+      /*min_chunk_size=*/multithreaded ? kMinVerticesPerChunk : count);
+}
+
+// Same as SimulatePathsFrom(), except that the search itself is parallelized
+// by delta stepping.
+template <typename Index>
+void SimulatePathsInParallelFrom(unsigned probe_index,
+                                 FlowNetwork const &network,
+                                 PathGraph const &path_graph,
+                                 float bucket_width,
+                                 SimulatedPaths<Index> *paths) {
+  DeltaSteppingShortestPaths(path_graph, probe_index, bucket_width,
+                             /*horizon=*/kMaxTolerableTravelTimeSeconds,
+                             &paths->time_cost);
+  RecoverShortestPathTree(probe_index, network, path_graph,
+                          /*multithreaded=*/true, paths);
+}
+
+// Computes the number of people travelling from the source probe to each
+// destination within the horizon, listed by settle_order, scaled by the weight
+// of the source. The time costs are offset by access_time_cost, for an origin
+// which reaches the source first.
+template <typename Index>
+void ComputeTravelPopulation(unsigned source_probe_index, float source_weight,
+                             float access_time_cost,
+                             std::vector<Index> const &settle_order,
+                             std::vector<float> const &time_cost,
+                             std::vector<float> const &population,
+                             SparseDemand *demand) {
+  unsigned destination_count = settle_order.size();
+  demand->time_cost.resize(destination_count);
+  demand->population.resize(destination_count);
+  for (unsigned i = 0; i < destination_count; ++i) {
+    unsigned v = settle_order[i];
+    demand->time_cost[i] = time_cost[v] + access_time_cost;
+    demand->population[i] = population[v];
+  }
+
+  // Calculates the likelihood for a person to travel to each destination
+  // probe, then normalizes it to the posterior distribution.
+  float evidence = kTravelLikelihood.MultiplyAccumulate(
+      demand->time_cost, demand->population, &demand->travel_population);
+  if (evidence <= 0) {
+    // Every destination is beyond the horizon.
+    std::fill(demand->travel_population.begin(),
+              demand->travel_population.end(), 0.0f);
+    return;
+  }
+  float scale = source_weight * population[source_probe_index] / evidence;
+  for (float &destination_population : demand->travel_population) {
+    destination_population *= scale;
+  }
+}
+
+// Same as above, for several scenarios at once. The travel likelihoods only
+// depend on the time costs, so they are evaluated once and shared by the
+// scenarios. populations is interleaved like ScenarioDemand::travel_population
+// over the vertices.
+template <typename Index>
+void ComputeScenarioTravelPopulation(unsigned source_probe_index,
+                                     SimulatedPaths<Index> const &paths,
+                                     unsigned scenario_count,
+                                     std::vector<float> const &populations,
+                                     ScenarioDemand *demand) {
+  unsigned const K = scenario_count;
+  unsigned destination_count = paths.settle_order.size();
+  demand->time_cost.resize(destination_count);
+  for (unsigned i = 0; i < destination_count; ++i) {
+    demand->time_cost[i] = paths.time_cost[paths.settle_order[i]];
+  }
+  kTravelLikelihood.Evaluate(demand->time_cost, &demand->likelihood);
+
+  std::fill(demand->evidence.begin(), demand->evidence.end(), 0.0f);
+  for (unsigned i = 0; i < destination_count; ++i) {
+    float const *population = populations.data() + paths.settle_order[i] * K;
+    for (unsigned k = 0; k < K; ++k) {
+      demand->evidence[k] += demand->likelihood[i] * population[k];
+    }
+  }
+  float const *source_population = populations.data() + source_probe_index * K;
+  for (unsigned k = 0; k < K; ++k) {
+    // A scenario gets no travel population when every destination is beyond
+    // the horizon.
+    demand->scale[k] = demand->evidence[k] > 0
+                           ? source_population[k] / demand->evidence[k]
+                           : 0.0f;
+  }
+
+  demand->travel_population.resize(destination_count * K);
+  for (unsigned i = 0; i < destination_count; ++i) {
+    float const *population = populations.data() + paths.settle_order[i] * K;
+    float *travel_population = demand->travel_population.data() + i * K;
+    for (unsigned k = 0; k < K; ++k) {
+      travel_population[k] =
+          demand->likelihood[i] * population[k] * demand->scale[k];
+    }
+  }
+}
+
+// Pushes the travel population up the shortest path tree. Visiting the
+// vertices in reverse settle order, the subtree below a vertex is complete by
+// the time it's visited, so every edge receives the travel population of all
+// the destinations routed through it. subtree_population is a zeroed buffer
+// over the vertices, and it's left zeroed on return.
+template <typename Index>
+void AccumulateFlows(SimulatedPaths<Index> const &paths,
+                     FlowNetwork const &network, SparseDemand const &demand,
+                     std::vector<float> *subtree_population,
+                     std::vector<float> *edge_flows) {
+  assert(demand.travel_population.size() == paths.settle_order.size());
+
+  for (unsigned i = paths.settle_order.size(); i-- > 1;) {
+    unsigned v = paths.settle_order[i];
+    unsigned edge = paths.predecessor_edges[v];
+    float population = (*subtree_population)[v] + demand.travel_population[i];
+    (*subtree_population)[v] = 0;
+
+    (*edge_flows)[edge] += population;
+    (*subtree_population)[network.sources[edge]] += population;
+  }
+  if (!paths.settle_order.empty()) {
+    (*subtree_population)[paths.settle_order[0]] = 0;
+  }
 }
 
-float LikelihoodToTravel(float time_cost) {
-  assert(time_cost >= 0.0);
+// Same as above, for several scenarios at once. subtree_population and
+// edge_flows are interleaved like ScenarioDemand::travel_population over the
+// vertices and the edges respectively.
+template <typename Index>
+void AccumulateScenarioFlows(SimulatedPaths<Index> const &paths,
+                             FlowNetwork const &network,
+                             ScenarioDemand const &demand,
+                             unsigned scenario_count,
+                             std::vector<float> *subtree_population,
+                             std::vector<float> *edge_flows) {
+  unsigned const K = scenario_count;
+  assert(demand.travel_population.size() == paths.settle_order.size() * K);
 
-  if (time_cost > kMaxTolerableTravelTimeSeconds) {
-    return 0;
+  for (unsigned i = paths.settle_order.size(); i-- > 1;) {
+    unsigned v = paths.settle_order[i];
+    unsigned edge = paths.predecessor_edges[v];
+    float const *travel_population = demand.travel_population.data() + i * K;
+    float *v_population = subtree_population->data() + v * K;
+    float *u_population =
+        subtree_population->data() + network.sources[edge] * K;
+    float *flows = edge_flows->data() + edge * K;
+    for (unsigned k = 0; k < K; ++k) {
+      float population = v_population[k] + travel_population[k];
+      v_population[k] = 0;
+      flows[k] += population;
+      u_population[k] += population;
+    }
+  }
+  if (!paths.settle_order.empty()) {
+    std::fill_n(subtree_population->begin() + paths.settle_order[0] * K, K,
+                0.0f);
   }
+}
+
+// Same as above, over the shortest paths of a contraction hierarchy, where the
+// travel population is pushed onto the arc directions. subtree_population is
+// a zeroed buffer over the ranks.
+void AccumulateArcFlows(HierarchyPaths const &paths, SparseDemand const &demand,
+                        std::vector<float> *subtree_population,
+                        std::vector<float> *arc_direction_flows) {
+  assert(demand.travel_population.size() == paths.settle_order.size());
 
-  constexpr float phi = -kAcos04;
-  constexpr float omega =
-      (std::numbers::pi - phi) / kMaxTolerableTravelTimeSeconds;
-  return 0.5 * (1 + std::cos(omega * time_cost + phi));
+  for (unsigned i = paths.settle_order.size(); i-- > 1;) {
+    unsigned r = paths.settle_order[i];
+    float population = (*subtree_population)[r] + demand.travel_population[i];
+    (*subtree_population)[r] = 0;
+
+    (*arc_direction_flows)[paths.parent_arc_directions[r]] += population;
+    (*subtree_population)[paths.parents[r]] += population;
+  }
+  if (!paths.settle_order.empty()) {
+    (*subtree_population)[paths.settle_order[0]] = 0;
+  }
 }
 
-std::vector<float>
-ComputeTravelProbability(SimulatedPaths const &paths,
-                         std::vector<PopulationProbe> const &probes) {
-  assert(paths.time_cost.size() == probes.size());
+// The number of source chunks AccumulateSourceChunks() splits the sources
+// into.
+unsigned SourceChunkCount(unsigned source_count) {
+  unsigned chunk_size = std::max(
+      kMinSourcesPerChunk,
+      (source_count + kMaxSourceChunkCount - 1) / kMaxSourceChunkCount);
+  return (source_count + chunk_size - 1) / chunk_size;
+}
 
-  // Calculates the likelihood for a person to travel to each destination probe.
-  std::vector<float> p_travel(probes.size());
-  float evidence = 0;
-  for (unsigned i = 0; i < probes.size(); ++i) {
-    float p_travel_to_i =
-        LikelihoodToTravel(paths.time_cost[i]) * probes[i].population_grid_200;
-    p_travel[i] = p_travel_to_i;
-    evidence += p_travel_to_i;
+// Runs chunk_fn(begin, end, chunk_flows) over the sources in [0, source_count)
+// and sums up the flows it adds to the zero initialized chunk_flows, of
+// flow_count elements, into flows.
+//
+// Single threaded, the whole range is a single chunk accumulated straight into
+// flows. Multithreaded, the sources are split into SourceChunkCount() chunks
+// which depend only on source_count. The chunks run in waves of
+// ParallelWorkerCount(), each wave folded into flows in chunk order before the
+// next one starts. Every element is therefore summed in chunk order whatever
+// the thread budget, while at most a wave of chunk buffers is alive.
+void AccumulateSourceChunks(
+    unsigned source_count, unsigned flow_count, bool multithreaded,
+    std::function<void(unsigned begin, unsigned end,
+                       std::vector<float> *chunk_flows)> const &chunk_fn,
+    std::vector<float> *flows) {
+  flows->assign(flow_count, 0.0f);
+  if (!multithreaded) {
+    chunk_fn(0, source_count, flows);
+    return;
   }
 
-  // Normalizes to posterior distribution.
-  for (unsigned i = 0; i < probes.size(); ++i) {
-    p_travel[i] /= evidence;
+  unsigned chunk_count = SourceChunkCount(source_count);
+  if (chunk_count == 0) {
+    return;
+  }
+  unsigned chunk_size = (source_count + chunk_count - 1) / chunk_count;
+  unsigned wave_size = std::min(chunk_count, ParallelWorkerCount());
+  std::vector<std::vector<float>> wave_flows(wave_size);
+  for (unsigned wave_begin = 0; wave_begin < chunk_count;
+       wave_begin += wave_size) {
+    unsigned wave_end = std::min(chunk_count, wave_begin + wave_size);
+    ParallelFor(wave_end - wave_begin,
+                [&chunk_fn, &wave_flows, source_count, flow_count, chunk_size,
+                 wave_begin](unsigned i) {
+                  std::vector<float> &chunk_flows = wave_flows[i];
+                  chunk_flows.assign(flow_count, 0.0f);
+                  unsigned begin = (wave_begin + i) * chunk_size;
+                  chunk_fn(begin, std::min(source_count, begin + chunk_size),
+                           &chunk_flows);
+                });
+    ParallelForFixedChunks(
+        flow_count, kEdgesPerChunk,
+        [&wave_flows, flows, wave_begin, wave_end](unsigned, unsigned begin,
+                                                   unsigned end) {
+          for (unsigned c = 0; c < wave_end - wave_begin; ++c) {
+            std::vector<float> const &chunk_flows = wave_flows[c];
+            for (unsigned i = begin; i < end; ++i) {
+              (*flows)[i] += chunk_flows[i];
+            }
+          }
+        });
   }
+}
+
+// Same as SimulateFlowFrom() below, except that each search is shared amongst
+// the workers by delta stepping, with Index for the shortest path trees. The
+// sources are simulated one after another, into the same source chunks summed
+// up in the same order as AccumulateSourceChunks(). The shortest path trees
+// are the canonical ones as well, so the flows are the same bit for bit as
+// the ones of the search per source.
+template <typename Index>
+void SimulateFlowByDeltaSteppingFrom(std::vector<unsigned> const &sources,
+                                     std::vector<float> const &source_weights,
+                                     FlowNetwork const &network,
+                                     FlowState const &current,
+                                     std::vector<float> *simulated_flow) {
+  assert(current.cost.size() == network.EdgeCount());
+  assert(sources.size() == source_weights.size());
+
+  unsigned vertex_count = network.VertexCount();
+  unsigned edge_count = network.EdgeCount();
+  PathGraph path_graph = CreatePathGraph(network, current.cost);
+  float bucket_width = SuitableBucketWidth(path_graph);
 
-  return p_travel;
+  SimulatedPaths<Index> simulated_paths(vertex_count);
+  SparseDemand demand(vertex_count);
+  std::vector<float> subtree_population(vertex_count, 0.0f);
+  std::vector<float> chunk_flows;
+  simulated_flow->assign(edge_count, 0.0f);
+  unsigned chunk_count = SourceChunkCount(sources.size());
+  for (unsigned chunk = 0; chunk < chunk_count; ++chunk) {
+    unsigned chunk_size = (sources.size() + chunk_count - 1) / chunk_count;
+    unsigned begin = chunk * chunk_size;
+    unsigned end = std::min<unsigned>(sources.size(), begin + chunk_size);
+    chunk_flows.assign(edge_count, 0.0f);
+    for (unsigned i = begin; i < end; ++i) {
+      SimulatePathsInParallelFrom(sources[i], network, path_graph,
+                                  bucket_width, &simulated_paths);
+      ComputeTravelPopulation(sources[i], source_weights[i],
+                              /*access_time_cost=*/0,
+                              simulated_paths.settle_order,
+                              simulated_paths.time_cost, network.population,
+                              &demand);
+      AccumulateFlows(simulated_paths, network, demand, &subtree_population,
+                      &chunk_flows);
+    }
+    for (unsigned j = 0; j < edge_count; ++j) {
+      (*simulated_flow)[j] += chunk_flows[j];
+    }
+  }
+}
+
+// Simulates the flows out of the sources, where the flows out of each source
+// count source_weights[i] times.
+template <typename Index>
+void SimulateFlowFrom(std::vector<unsigned> const &sources,
+                      std::vector<float> const &source_weights,
+                      FlowNetwork const &network, FlowState const &current,
+                      std::vector<float> *simulated_flow, bool multithreaded) {
+  assert(current.cost.size() == network.EdgeCount());
+  assert(sources.size() == source_weights.size());
+
+  unsigned vertex_count = network.VertexCount();
+  unsigned edge_count = network.EdgeCount();
+  if (multithreaded && sources.size() < ParallelWorkerCount() &&
+      vertex_count >= kMinVerticesPerParallelSearch) {
+    // Too few sources to keep every worker busy, so the workers share each
+    // search instead.
+    SimulateFlowByDeltaSteppingFrom<Index>(sources, source_weights, network,
+                                           current, simulated_flow);
+    return;
+  }
+
+  AccumulateSourceChunks(
+      sources.size(), edge_count, multithreaded,
+      [&sources, &source_weights, &network, &current,
+       vertex_count](unsigned begin, unsigned end,
+                     std::vector<float> *edge_flows) {
+        SimulatedPaths<Index> simulated_paths(vertex_count);
+        SparseDemand demand(vertex_count);
+        std::vector<float> subtree_population(vertex_count, 0.0f);
+        for (unsigned i = begin; i < end; ++i) {
+          SimulatePathsFrom(sources[i], network, current.cost,
+                            &simulated_paths);
+          ComputeTravelPopulation(sources[i], source_weights[i],
+                                  /*access_time_cost=*/0,
+                                  simulated_paths.settle_order,
+                                  simulated_paths.time_cost,
+                                  network.population, &demand);
+          AccumulateFlows(simulated_paths, network, demand,
+                          &subtree_population, edge_flows);
+        }
+      },
+      simulated_flow);
+}
+
+// Same as above, with the narrowest index the network fits in.
+void SimulateFlowFrom(std::vector<unsigned> const &sources,
+                      std::vector<float> const &source_weights,
+                      FlowNetwork const &network, FlowState const &current,
+                      std::vector<float> *simulated_flow, bool multithreaded) {
+  if (FitsCompactIndex(network)) {
+    SimulateFlowFrom<std::uint16_t>(sources, source_weights, network, current,
+                                    simulated_flow, multithreaded);
+  } else {
+    SimulateFlowFrom<std::uint32_t>(sources, source_weights, network, current,
+                                    simulated_flow, multithreaded);
+  }
 }
 
-std::vector<float>
-ComputeTravelPopulation(unsigned source_probe_index,
-                        SimulatedPaths const &paths,
-                        std::vector<PopulationProbe> const &probes) {
-  std::vector<float> p_travel = ComputeTravelProbability(paths, probes);
+// Lists the sampled sources along with the weights which make their flows an
+// unbiased estimate of the flows from every source.
+void ToWeightedSources(SourceSamplerInterface const &source_sampler,
+                       std::vector<unsigned> *sources,
+                       std::vector<float> *source_weights) {
+  // Every sample stands for PopulationCount() / SampleCount() sources, besides
+  // its correction for being drawn more or less likely than uniformly.
+  float sample_scale = static_cast<float>(source_sampler.PopulationCount()) /
+                       source_sampler.SampleCount();
 
-  std::vector<float> result(probes.size());
-  for (unsigned i = 0; i < probes.size(); ++i) {
-    result[i] = p_travel[i] * probes[source_probe_index].population_grid_200;
+  sources->clear();
+  source_weights->clear();
+  sources->reserve(source_sampler.SourceSamples().size());
+  source_weights->reserve(source_sampler.SourceSamples().size());
+  for (auto const &sample : source_sampler.SourceSamples()) {
+    sources->push_back(sample.source_index);
+    source_weights->push_back(sample.frequency * sample.correction *
+                              sample_scale);
   }
-  return result;
 }
 
-void AccumulateFlowsToPath(
-    unsigned path_destination,
-    std::vector<FlowCostMap::vertex_descriptor> const &predecessors,
-    float to_be_added, TopologyFlow *topology_flow) {
-  FlowCostMap::vertex_descriptor current = path_destination;
-  FlowCostMap::vertex_descriptor parent = predecessors[path_destination];
+// Whether the search settled the vertex, i.e. whether the shortest path tree
+// reaches it within the travel time horizon.
+template <typename Index>
+bool IsSettled(unsigned v, SimulatedPaths<Index> const &paths) {
+  return paths.time_cost[v] <= kMaxTolerableTravelTimeSeconds;
+}
 
-  while (parent != current) {
-    auto [edge, existence] = boost::edge(parent, current, *topology_flow);
-    assert(existence);
+// Sends the travel population of a cluster member to the representative,
+// against the shortest path tree, then removes it from the member. What
+// remains is the demand the member puts onto the representative's tree. The
+// tree must have settled the member.
+template <typename Index>
+void AccumulateAccessFlows(unsigned member, unsigned representative,
+                           SimulatedPaths<Index> const &paths,
+                           FlowNetwork const &network, SparseDemand *demand,
+                           std::vector<float> *edge_flows) {
+  assert(IsSettled(member, paths));
 
-    float current_flow =
-        boost::get(&FlowProperties::flow, *topology_flow, edge);
-    boost::put(&FlowProperties::flow, *topology_flow, edge,
-               current_flow + to_be_added);
+  float departing_population = 0;
+  for (unsigned i = 0; i < paths.settle_order.size(); ++i) {
+    if (paths.settle_order[i] == member) {
+      // The member doesn't travel to itself.
+      demand->travel_population[i] = 0;
+    }
+    departing_population += demand->travel_population[i];
+  }
+  if (member == representative) {
+    return;
+  }
 
-    current = parent;
-    parent = predecessors[current];
+  for (unsigned v = member; v != representative;) {
+    unsigned edge = paths.predecessor_edges[v];
+    (*edge_flows)[network.reverse_edges[edge]] += departing_population;
+    v = network.sources[edge];
   }
 }
 
-void AccumulateFlows(std::vector<float> const &travel_population,
-                     SimulatedPaths const &paths, TopologyFlow *topology_flow) {
-  for (unsigned destination = 0; destination < travel_population.size();
-       ++destination) {
-    AccumulateFlowsToPath(destination, paths.predecessors,
-                          travel_population[destination], topology_flow);
+// Same as SimulateFlow() over origin clusters, with Index for the shortest
+// path trees.
+template <typename Index>
+void SimulateClusteredFlow(FlowNetwork const &network,
+                           FlowState const &current,
+                           OriginClusters const &origin_clusters,
+                           std::vector<float> *simulated_flow,
+                           bool multithreaded) {
+  assert(current.cost.size() == network.EdgeCount());
+  assert(origin_clusters.members.size() == network.VertexCount());
+
+  unsigned vertex_count = network.VertexCount();
+  unsigned edge_count = network.EdgeCount();
+  AccumulateSourceChunks(
+      origin_clusters.ClusterCount(), edge_count, multithreaded,
+      [&network, &current, &origin_clusters,
+       vertex_count](unsigned begin, unsigned end,
+                     std::vector<float> *edge_flows) {
+        SimulatedPaths<Index> simulated_paths(vertex_count);
+        SimulatedPaths<Index> member_paths(vertex_count);
+        SparseDemand member_demand(vertex_count);
+        SparseDemand cluster_demand(vertex_count);
+        std::vector<float> subtree_population(vertex_count, 0.0f);
+        for (unsigned i = begin; i < end; ++i) {
+          unsigned const *members =
+              origin_clusters.members.data() + origin_clusters.offsets[i];
+          unsigned member_count =
+              origin_clusters.offsets[i + 1] - origin_clusters.offsets[i];
+          unsigned representative = members[0];
+
+          SimulatePathsFrom(representative, network, current.cost,
+                            &simulated_paths);
+          cluster_demand.travel_population.assign(
+              simulated_paths.settle_order.size(), 0.0f);
+          for (unsigned j = 0; j < member_count; ++j) {
+            if (!IsSettled(members[j], simulated_paths)) {
+              // The representative's tree doesn't reach the member, e.g. under
+              // congestion, so there's no access leg to share. The member
+              // travels as an origin of its own instead.
+              SimulatePathsFrom(members[j], network, current.cost,
+                                &member_paths);
+              ComputeTravelPopulation(members[j], /*source_weight=*/1.0f,
+                                      /*access_time_cost=*/0,
+                                      member_paths.settle_order,
+                                      member_paths.time_cost,
+                                      network.population, &member_demand);
+              AccumulateFlows(member_paths, network, member_demand,
+                              &subtree_population, edge_flows);
+              continue;
+            }
+
+            // Approximates the member's travel time by the access leg to the
+            // representative followed by the representative's path.
+            ComputeTravelPopulation(
+                members[j], /*source_weight=*/1.0f,
+                /*access_time_cost=*/simulated_paths.time_cost[members[j]],
+                simulated_paths.settle_order, simulated_paths.time_cost,
+                network.population, &member_demand);
+            AccumulateAccessFlows(members[j], representative, simulated_paths,
+                                  network, &member_demand, edge_flows);
+            for (unsigned k = 0; k < simulated_paths.settle_order.size();
+                 ++k) {
+              cluster_demand.travel_population[k] +=
+                  member_demand.travel_population[k];
+            }
+          }
+          AccumulateFlows(simulated_paths, network, cluster_demand,
+                          &subtree_population, edge_flows);
+        }
+      },
+      simulated_flow);
+}
+
+// Same as SimulateFlow() over demand scenarios, with Index for the shortest
+// path trees.
+template <typename Index>
+void SimulateScenarioFlows(
+    FlowNetwork const &network, FlowState const &current,
+    std::vector<std::vector<float>> const &scenario_populations,
+    std::vector<std::vector<float>> *simulated_flows, bool multithreaded) {
+  assert(current.cost.size() == network.EdgeCount());
+
+  unsigned const K = scenario_populations.size();
+  unsigned vertex_count = network.VertexCount();
+  unsigned edge_count = network.EdgeCount();
+
+  // Interleaves the scenarios.
+  std::vector<float> populations(vertex_count * K);
+  for (unsigned k = 0; k < K; ++k) {
+    assert(scenario_populations[k].size() == vertex_count);
+    for (unsigned v = 0; v < vertex_count; ++v) {
+      populations[v * K + k] = scenario_populations[k][v];
+    }
+  }
+
+  std::vector<float> interleaved_flows;
+  AccumulateSourceChunks(
+      vertex_count, edge_count * K, multithreaded,
+      [&network, &current, &populations, K,
+       vertex_count](unsigned begin, unsigned end,
+                     std::vector<float> *edge_flows) {
+        SimulatedPaths<Index> simulated_paths(vertex_count);
+        ScenarioDemand demand(vertex_count, K);
+        std::vector<float> subtree_population(vertex_count * K, 0.0f);
+        for (unsigned source = begin; source < end; ++source) {
+          SimulatePathsFrom(source, network, current.cost, &simulated_paths);
+          ComputeScenarioTravelPopulation(source, simulated_paths, K,
+                                          populations, &demand);
+          AccumulateScenarioFlows(simulated_paths, network, demand, K,
+                                  &subtree_population, edge_flows);
+        }
+      },
+      &interleaved_flows);
+
+  simulated_flows->resize(K);
+  for (unsigned k = 0; k < K; ++k) {
+    (*simulated_flows)[k].resize(edge_count);
+    for (unsigned i = 0; i < edge_count; ++i) {
+      (*simulated_flows)[k][i] = interleaved_flows[i * K + k];
+    }
   }
 }
 
+// Same as the public SimulateFlowBySourceBlocks(), with Index for the shortest
+// path trees.
+template <typename Index>
+void SimulateFlowBySourceBlocks(FlowNetwork const &network,
+                                FlowState const &current,
+                                std::vector<float> *simulated_flow,
+                                bool multithreaded) {
+  assert(current.cost.size() == network.EdgeCount());
+
+  unsigned vertex_count = network.VertexCount();
+  unsigned edge_count = network.EdgeCount();
+  PathGraph path_graph = CreatePathGraph(network, current.cost);
+  unsigned block_count =
+      (vertex_count + kSourceBlockSize - 1) / kSourceBlockSize;
+
+  AccumulateSourceChunks(
+      block_count, edge_count, multithreaded,
+      [&network, &path_graph, vertex_count](unsigned begin, unsigned end,
+                                            std::vector<float> *edge_flows) {
+        std::vector<unsigned> sources;
+        std::vector<float> block_time_costs;
+        SimulatedPaths<Index> simulated_paths(vertex_count);
+        SparseDemand demand(vertex_count);
+        std::vector<float> subtree_population(vertex_count, 0.0f);
+        for (unsigned b = begin; b < end; ++b) {
+          // Consecutive probes are close to each other when the probes are
+          // reordered, so their searches overlap the most.
+          sources.clear();
+          for (unsigned source = b * kSourceBlockSize;
+               source < std::min(vertex_count, (b + 1) * kSourceBlockSize);
+               ++source) {
+            sources.push_back(source);
+          }
+          MultiSourceShortestPaths(path_graph, sources,
+                                   /*horizon=*/kMaxTolerableTravelTimeSeconds,
+                                   &block_time_costs);
+
+          unsigned const K = sources.size();
+          for (unsigned k = 0; k < K; ++k) {
+            for (unsigned v = 0; v < vertex_count; ++v) {
+              simulated_paths.time_cost[v] = block_time_costs[v * K + k];
+            }
+            RecoverShortestPathTree(sources[k], network, path_graph,
+                                    /*multithreaded=*/false, &simulated_paths);
+            ComputeTravelPopulation(sources[k], /*source_weight=*/1.0f,
+                                    /*access_time_cost=*/0,
+                                    simulated_paths.settle_order,
+                                    simulated_paths.time_cost,
+                                    network.population, &demand);
+            AccumulateFlows(simulated_paths, network, demand,
+                            &subtree_population, edge_flows);
+          }
+        }
+      },
+      simulated_flow);
+}
+
 } // namespace
 
-TopologyFlow SimulateFlow(TopologyFlow const &previous_flow,
-                          std::vector<PopulationProbe> const &probes) {
-  TopologyFlow current_flows = CreateNewFlowsFrom(previous_flow);
+void SimulateFlow(FlowNetwork const &network, FlowState const &current,
+                  OriginClusters const &origin_clusters,
+                  std::vector<float> *simulated_flow, bool multithreaded) {
+  if (FitsCompactIndex(network)) {
+    SimulateClusteredFlow<std::uint16_t>(network, current, origin_clusters,
+                                         simulated_flow, multithreaded);
+  } else {
+    SimulateClusteredFlow<std::uint32_t>(network, current, origin_clusters,
+                                         simulated_flow, multithreaded);
+  }
+}
+
+void SimulateFlow(FlowNetwork const &network, FlowState const &current,
+                  ContractionHierarchy const &hierarchy,
+                  std::vector<float> *simulated_flow, bool multithreaded) {
+  assert(current.cost.size() == network.EdgeCount());
+  assert(hierarchy.VertexCount() == network.VertexCount());
+
+  HierarchyMetric metric;
+  CustomizeContractionHierarchy(hierarchy, current.cost, &metric,
+                                multithreaded);
+
+  // The searches run over the ranks, so is the population.
+  unsigned vertex_count = network.VertexCount();
+  std::vector<float> rank_population(vertex_count);
+  for (unsigned r = 0; r < vertex_count; ++r) {
+    rank_population[r] = network.population[hierarchy.vertices[r]];
+  }
+
+  unsigned arc_direction_count = 2 * hierarchy.ArcCount();
+  std::vector<float> arc_flows;
+  AccumulateSourceChunks(
+      vertex_count, arc_direction_count, multithreaded,
+      [&hierarchy, &metric, &rank_population,
+       vertex_count](unsigned begin, unsigned end,
+                     std::vector<float> *arc_direction_flows) {
+        HierarchyPaths paths(vertex_count);
+        SparseDemand demand(vertex_count);
+        std::vector<float> subtree_population(vertex_count, 0.0f);
+        for (unsigned r = begin; r < end; ++r) {
+          ComputeHierarchyPaths(hierarchy, metric, r,
+                                /*horizon=*/kMaxTolerableTravelTimeSeconds,
+                                &paths);
+          ComputeTravelPopulation(r, /*source_weight=*/1.0f,
+                                  /*access_time_cost=*/0, paths.settle_order,
+                                  paths.time_cost, rank_population, &demand);
+          AccumulateArcFlows(paths, demand, &subtree_population,
+                             arc_direction_flows);
+        }
+      },
+      &arc_flows);
+  simulated_flow->assign(network.EdgeCount(), 0.0f);
+  UnpackArcFlows(hierarchy, metric, &arc_flows, simulated_flow);
+}
+
+void SimulateFlow(FlowNetwork const &network, FlowState const &current,
+                  std::vector<std::vector<float>> const &scenario_populations,
+                  std::vector<std::vector<float>> *simulated_flows,
+                  bool multithreaded) {
+  if (FitsCompactIndex(network)) {
+    SimulateScenarioFlows<std::uint16_t>(network, current,
+                                         scenario_populations, simulated_flows,
+                                         multithreaded);
+  } else {
+    SimulateScenarioFlows<std::uint32_t>(network, current,
+                                         scenario_populations, simulated_flows,
+                                         multithreaded);
+  }
+}
 
-  FlowCostMap flow_cost = CreateFlowCostMapFrom(previous_flow, probes);
-  for (unsigned source = 0; source < boost::num_vertices(previous_flow);
-       ++source) {
-    SimulatedPaths simulated_paths = SimulatePathsFrom(source, flow_cost);
-    std::vector<float> travel_population =
-        ComputeTravelPopulation(source, simulated_paths, probes);
-    AccumulateFlows(travel_population, simulated_paths, &current_flows);
+void SimulateFlowBySourceBlocks(FlowNetwork const &network,
+                                FlowState const &current,
+                                std::vector<float> *simulated_flow,
+                                bool multithreaded) {
+  if (FitsCompactIndex(network)) {
+    SimulateFlowBySourceBlocks<std::uint16_t>(network, current,
+                                              simulated_flow, multithreaded);
+  } else {
+    SimulateFlowBySourceBlocks<std::uint32_t>(network, current,
+                                              simulated_flow, multithreaded);
   }
+}
+
+void SimulateFlow(FlowNetwork const &network, FlowState const &current,
+                  std::vector<float> *simulated_flow, bool multithreaded) {
+  std::vector<unsigned> sources(network.VertexCount());
+  std::iota(sources.begin(), sources.end(), 0);
+  std::vector<float> source_weights(network.VertexCount(), 1.0f);
+  SimulateFlowFrom(sources, source_weights, network, current, simulated_flow,
+                   multithreaded);
+}
+
+void SimulateFlow(FlowNetwork const &network, FlowState const &current,
+                  SourceSamplerInterface const &source_sampler,
+                  std::vector<float> *simulated_flow, bool multithreaded) {
+  assert(source_sampler.PopulationCount() == network.VertexCount());
 
-  return current_flows;
+  std::vector<unsigned> sources;
+  std::vector<float> source_weights;
+  ToWeightedSources(source_sampler, &sources, &source_weights);
+  SimulateFlowFrom(sources, source_weights, network, current, simulated_flow,
+                   multithreaded);
 }
 
 } // namespace procedural
@@ -16,18 +16,83 @@
 
 #pragma once
 
-#include "procedural/probing/flow/topology.hpp"
-#include "procedural/probing/probe/probe.hpp"
+#include "procedural/probing/flow/cluster.hpp"
+#include "procedural/probing/flow/hierarchy.hpp"
+#include "procedural/probing/flow/network.hpp"
+#include "procedural/probing/topology/sampler.hpp"
 #include <vector>
 
 namespace e8 {
 namespace procedural {
 
-// It simulates how the population would transport over the topology given the
-// previous flow meansurement, then it aggregates transportations to measure the
-// new flows.
-TopologyFlow SimulateFlow(TopologyFlow const &previous_flow,
-                          std::vector<PopulationProbe> const &probes);
+// It simulates how the population would transport over the flow network given
+// the current flow state, then it aggregates transportations to measure the
+// new flows. The edge costs of the current flow state must be up to date. The
+// simulated flow of each edge is stored into simulated_flow. Each shortest
+// path search stops at the travel time horizon, beyond which no one travels,
+// so only the destinations within it are enumerated. When multithreaded, the
+// sources are partitioned into chunks, each of which accumulates the flows
+// privately. The private flows are summed up in chunk order, a wave of workers
+// at a time. The chunks only depend on the number of sources, so the flows are
+// the same bit for bit whatever the thread budget. Single threaded, the flows
+// are accumulated directly, source by source.
+void SimulateFlow(FlowNetwork const &network, FlowState const &current,
+                  std::vector<float> *simulated_flow,
+                  bool multithreaded = true);
+
+// Same as above, except that the sources are searched kSourceBlockSize at a
+// time by MultiSourceShortestPaths(), which shares the traversal of the edges
+// amongst the sources of a block. The shortest path trees are recovered from
+// the time costs, so the paths of equal time cost may be taken differently
+// than by Dijkstra's algorithm. It's opt-in, the flow estimation runs the
+// above.
+void SimulateFlowBySourceBlocks(FlowNetwork const &network,
+                                FlowState const &current,
+                                std::vector<float> *simulated_flow,
+                                bool multithreaded = true);
+
+// Same as above, except that the flows of several demand scenarios are
+// simulated over the same costs. Each scenario replaces the population of the
+// network with its own, and receives its simulated flow in simulated_flows.
+// The shortest path trees and the travel likelihoods are shared by the
+// scenarios, and their flows are accumulated side by side.
+void SimulateFlow(FlowNetwork const &network, FlowState const &current,
+                  std::vector<std::vector<float>> const &scenario_populations,
+                  std::vector<std::vector<float>> *simulated_flows,
+                  bool multithreaded = true);
+
+// Same as above, except that only the sampled sources are simulated. The flows
+// out of each sample are scaled by its frequency and correction factor, so
+// the simulated flow is an unbiased estimate of the one from every source.
+// When multithreaded with fewer samples than workers over a large network, the
+// samples are simulated one after another, and the workers share each search
+// by delta stepping instead, see DeltaSteppingShortestPaths(). Either way, the
+// shortest path trees are the canonical ones of the time costs, so the flows
+// are the same bit for bit whatever the thread budget.
+void SimulateFlow(FlowNetwork const &network, FlowState const &current,
+                  SourceSamplerInterface const &source_sampler,
+                  std::vector<float> *simulated_flow,
+                  bool multithreaded = true);
+
+// Same as above, except that one shortest path tree is searched per origin
+// cluster. Every member's demand is computed from the representative's travel
+// times plus the member's access time to the representative, and it's routed
+// to the representative, then down the representative's tree.
+void SimulateFlow(FlowNetwork const &network, FlowState const &current,
+                  OriginClusters const &origin_clusters,
+                  std::vector<float> *simulated_flow,
+                  bool multithreaded = true);
+
+// Same as the exact simulation above, except that the shortest paths are
+// computed over the contraction hierarchy of the network. The hierarchy is
+// customized with the current edge costs first, then every source runs an
+// upward search followed by a downward sweep in place of Dijkstra's algorithm.
+// The flows are accumulated over the hierarchy's arcs, then unpacked onto the
+// edges.
+void SimulateFlow(FlowNetwork const &network, FlowState const &current,
+                  ContractionHierarchy const &hierarchy,
+                  std::vector<float> *simulated_flow,
+                  bool multithreaded = true);
 
 } // namespace procedural
 } // namespace e8
@@ -15,12 +15,20 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define BOOST_TEST_MAIN
+#include "procedural/probing/flow/cluster.hpp"
+#include "procedural/probing/flow/network.hpp"
 #include "procedural/probing/flow/simulate.hpp"
-#include "procedural/probing/flow/topology.hpp"
+#include "procedural/probing/flow/time_cost.hpp"
+#include "procedural/probing/parallel/parallel.hpp"
 #include "procedural/probing/probe/probe.hpp"
-#include <boost/graph/adjacency_list.hpp>
+#include "procedural/probing/random/philox.hpp"
+#include "procedural/probing/topology/sampler.hpp"
+#include <bit>
 #include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <cstdint>
 #include <eigen3/Eigen/Core>
+#include <utility>
 #include <vector>
 
 namespace e8 {
@@ -33,11 +41,14 @@ BOOST_AUTO_TEST_CASE(WhenTopologyIsIslands_ThenCheckFlow) {
                       /*population_grid_200=*/1e3f),
       PopulationProbe(Eigen::Vector3f(1000, 0, 0),
                       /*population_grid_200=*/2e3f)};
-  TopologyFlow flow(2);
+  FlowNetwork network = CreateFlowNetwork(probes, /*connections=*/{});
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
 
-  TopologyFlow simulated_flow = SimulateFlow(flow, probes);
-  BOOST_CHECK_EQUAL(2, boost::num_vertices(simulated_flow));
-  BOOST_CHECK_EQUAL(0, boost::num_edges(simulated_flow));
+  std::vector<float> simulated_flow;
+  SimulateFlow(network, state, &simulated_flow);
+  BOOST_CHECK_EQUAL(2, network.VertexCount());
+  BOOST_CHECK(simulated_flow.empty());
 }
 
 BOOST_AUTO_TEST_CASE(WhenTopologyIsLine_ThenCheckFlow) {
@@ -47,35 +58,449 @@ BOOST_AUTO_TEST_CASE(WhenTopologyIsLine_ThenCheckFlow) {
                       /*population_grid_200=*/1e3f),
       PopulationProbe(Eigen::Vector3f(2000, 0, 0),
                       /*population_grid_200=*/1e4f)};
+  FlowNetwork network = CreateFlowNetwork(
+      probes, {std::make_pair(0, 1), std::make_pair(1, 2)});
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
 
-  TopologyFlow flow(3);
-  boost::add_edge(0, 1, FlowProperties(0, 1), flow);
-  boost::add_edge(1, 0, FlowProperties(0, 1), flow);
-
-  boost::add_edge(1, 2, FlowProperties(0, 1), flow);
-  boost::add_edge(2, 1, FlowProperties(0, 1), flow);
-
-  TopologyFlow simulated_flow = SimulateFlow(flow, probes);
-  BOOST_CHECK_EQUAL(3, boost::num_vertices(simulated_flow));
-  BOOST_CHECK_EQUAL(4, boost::num_edges(simulated_flow));
-
-  auto [edge_01, exists_01] = boost::edge(0, 1, simulated_flow);
-  auto [edge_10, exists_10] = boost::edge(1, 0, simulated_flow);
-  auto [edge_12, exists_12] = boost::edge(1, 2, simulated_flow);
-  auto [edge_21, exists_21] = boost::edge(2, 1, simulated_flow);
-  BOOST_CHECK(exists_01);
-  BOOST_CHECK(exists_10);
-  BOOST_CHECK(exists_12);
-  BOOST_CHECK(exists_21);
-
-  BOOST_CHECK_CLOSE(
-      99, boost::get(&FlowProperties::flow, simulated_flow, edge_01), 1.f);
-  BOOST_CHECK_CLOSE(
-      103, boost::get(&FlowProperties::flow, simulated_flow, edge_10), 1.f);
-  BOOST_CHECK_CLOSE(
-      993, boost::get(&FlowProperties::flow, simulated_flow, edge_12), 1.f);
-  BOOST_CHECK_CLOSE(
-      1011, boost::get(&FlowProperties::flow, simulated_flow, edge_21), 1.f);
+  std::vector<float> simulated_flow;
+  SimulateFlow(network, state, &simulated_flow);
+  BOOST_REQUIRE_EQUAL(4, simulated_flow.size());
+
+  BOOST_CHECK_CLOSE(99, simulated_flow[FindFlowEdge(0, 1, network.graph)],
+                    1.f);
+  BOOST_CHECK_CLOSE(103, simulated_flow[FindFlowEdge(1, 0, network.graph)],
+                    1.f);
+  BOOST_CHECK_CLOSE(993, simulated_flow[FindFlowEdge(1, 2, network.graph)],
+                    1.f);
+  BOOST_CHECK_CLOSE(1011, simulated_flow[FindFlowEdge(2, 1, network.graph)],
+                    1.f);
+}
+
+BOOST_AUTO_TEST_CASE(WhenDestinationIsBeyondHorizon_ThenCheckNoFlowToIt) {
+  // The last probe is more than an hour away at any speed.
+  std::vector<PopulationProbe> probes{
+      PopulationProbe(Eigen::Vector3f(0, 0, 0), /*population_grid_200=*/1e2f),
+      PopulationProbe(Eigen::Vector3f(1000, 0, 0),
+                      /*population_grid_200=*/1e3f),
+      PopulationProbe(Eigen::Vector3f(201000, 0, 0),
+                      /*population_grid_200=*/1e4f)};
+  FlowNetwork network = CreateFlowNetwork(
+      probes, {std::make_pair(0, 1), std::make_pair(1, 2)});
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
+
+  std::vector<float> simulated_flow;
+  SimulateFlow(network, state, &simulated_flow);
+
+  BOOST_CHECK_GT(simulated_flow[FindFlowEdge(0, 1, network.graph)], 0);
+  BOOST_CHECK_GT(simulated_flow[FindFlowEdge(1, 0, network.graph)], 0);
+  BOOST_CHECK_EQUAL(0, simulated_flow[FindFlowEdge(1, 2, network.graph)]);
+  BOOST_CHECK_EQUAL(0, simulated_flow[FindFlowEdge(2, 1, network.graph)]);
+}
+
+BOOST_AUTO_TEST_CASE(WhenMultithreaded_ThenCheckSameFlowAsSingleThreaded) {
+  unsigned const side = 12;
+  std::vector<PopulationProbe> probes;
+  std::vector<std::pair<unsigned, unsigned>> connections;
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      probes.push_back(PopulationProbe(Eigen::Vector3f(x * 500, y * 500, 0),
+                                       /*population_grid_200=*/1e2f * (x + 1)));
+
+      unsigned u = x + y * side;
+      if (x + 1 < side) {
+        connections.push_back(std::make_pair(u, u + 1));
+      }
+      if (y + 1 < side) {
+        connections.push_back(std::make_pair(u, u + side));
+      }
+    }
+  }
+  FlowNetwork network = CreateFlowNetwork(probes, connections);
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
+
+  std::vector<float> single_threaded;
+  SimulateFlow(network, state, &single_threaded, /*multithreaded=*/false);
+  std::vector<float> multithreaded;
+  SimulateFlow(network, state, &multithreaded, /*multithreaded=*/true);
+
+  // The flows are summed up in a different order, so they may differ in the
+  // last bits.
+  BOOST_REQUIRE_EQUAL(single_threaded.size(), multithreaded.size());
+  for (unsigned j = 0; j < single_threaded.size(); ++j) {
+    BOOST_CHECK_CLOSE(single_threaded[j], multithreaded[j], 1e-2f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenThreadCountChanges_ThenCheckFlowBitsAreKept) {
+  unsigned const side = 40;
+  std::vector<PopulationProbe> probes;
+  std::vector<std::pair<unsigned, unsigned>> connections;
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      probes.push_back(PopulationProbe(Eigen::Vector3f(x * 500, y * 500, 0),
+                                       /*population_grid_200=*/1e2f * (x + 1)));
+
+      unsigned u = x + y * side;
+      if (x + 1 < side) {
+        connections.push_back(std::make_pair(u, u + 1));
+      }
+      if (y + 1 < side) {
+        connections.push_back(std::make_pair(u, u + side));
+      }
+    }
+  }
+  FlowNetwork network = CreateFlowNetwork(probes, connections);
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
+
+  OriginClusters clusters = ClusterOrigins(network, /*radius=*/500);
+  ContractionHierarchy hierarchy = CreateContractionHierarchy(network);
+  std::vector<std::vector<float>> scenario_populations(2, network.population);
+  for (float &population : scenario_populations[1]) {
+    population *= 2;
+  }
+
+  // The flows of every simulation variant, concatenated.
+  auto simulate = [&network, &state, &clusters, &hierarchy,
+                   &scenario_populations](bool multithreaded) {
+    std::vector<float> flows;
+    std::vector<float> simulated_flow;
+    SimulateFlow(network, state, &simulated_flow, multithreaded);
+    flows.insert(flows.end(), simulated_flow.begin(), simulated_flow.end());
+    SimulateFlow(network, state, clusters, &simulated_flow, multithreaded);
+    flows.insert(flows.end(), simulated_flow.begin(), simulated_flow.end());
+    SimulateFlow(network, state, hierarchy, &simulated_flow, multithreaded);
+    flows.insert(flows.end(), simulated_flow.begin(), simulated_flow.end());
+    SimulateFlowBySourceBlocks(network, state, &simulated_flow, multithreaded);
+    flows.insert(flows.end(), simulated_flow.begin(), simulated_flow.end());
+    std::vector<std::vector<float>> scenario_flows;
+    SimulateFlow(network, state, scenario_populations, &scenario_flows,
+                 multithreaded);
+    for (auto const &scenario_flow : scenario_flows) {
+      flows.insert(flows.end(), scenario_flow.begin(), scenario_flow.end());
+    }
+    return flows;
+  };
+
+  SetParallelThreadCount(1);
+  std::vector<float> expected = simulate(/*multithreaded=*/true);
+  for (unsigned thread_count : {2U, 3U, 8U}) {
+    SetParallelThreadCount(thread_count);
+    std::vector<float> flows = simulate(/*multithreaded=*/true);
+
+    BOOST_REQUIRE_EQUAL(expected.size(), flows.size());
+    unsigned different_count = 0;
+    for (unsigned j = 0; j < expected.size(); ++j) {
+      different_count += std::bit_cast<std::uint32_t>(expected[j]) !=
+                         std::bit_cast<std::uint32_t>(flows[j]);
+    }
+    BOOST_CHECK_MESSAGE(different_count == 0,
+                        "thread_count=" << thread_count << ", "
+                                        << different_count
+                                        << " edge flows differ");
+  }
+  SetParallelThreadCount(0);
+}
+
+BOOST_AUTO_TEST_CASE(WhenOriginsAreSampled_ThenCheckFlowIsUnbiased) {
+  unsigned const side = 8;
+  std::vector<PopulationProbe> probes;
+  std::vector<std::pair<unsigned, unsigned>> connections;
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      probes.push_back(PopulationProbe(Eigen::Vector3f(x * 500, y * 500, 0),
+                                       /*population_grid_200=*/1e2f * (x + 1)));
+
+      unsigned u = x + y * side;
+      if (x + 1 < side) {
+        connections.push_back(std::make_pair(u, u + 1));
+      }
+      if (y + 1 < side) {
+        connections.push_back(std::make_pair(u, u + side));
+      }
+    }
+  }
+  FlowNetwork network = CreateFlowNetwork(probes, connections);
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
+
+  std::vector<float> exact;
+  SimulateFlow(network, state, &exact);
+
+  // Averages the flows of many independent sample sets.
+  unsigned const round_count = 400;
+  SourceImportanceSampler sampler(network.population, /*sample_count=*/8,
+                                  PhiloxEngine(13L));
+  std::vector<float> average(network.EdgeCount(), 0.0f);
+  std::vector<float> sampled;
+  for (unsigned i = 0; i < round_count; ++i) {
+    sampler.UpdateSamples();
+    SimulateFlow(network, state, sampler, &sampled);
+    for (unsigned j = 0; j < network.EdgeCount(); ++j) {
+      average[j] += sampled[j] / round_count;
+    }
+  }
+
+  float exact_total = 0;
+  float average_total = 0;
+  float absolute_error = 0;
+  for (unsigned j = 0; j < network.EdgeCount(); ++j) {
+    exact_total += exact[j];
+    average_total += average[j];
+    absolute_error += std::abs(average[j] - exact[j]);
+  }
+  BOOST_CHECK_CLOSE(exact_total, average_total, 5.f);
+  BOOST_CHECK_LT(absolute_error / exact_total, 0.1f);
+}
+
+BOOST_AUTO_TEST_CASE(WhenSearchesAreDeltaStepped_ThenCheckFlowBitsAreKept) {
+  // Large enough for the workers to share the search of each source.
+  unsigned const side = 130;
+  std::vector<PopulationProbe> probes;
+  std::vector<std::pair<unsigned, unsigned>> connections;
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      probes.push_back(PopulationProbe(Eigen::Vector3f(x * 500, y * 500, 0),
+                                       /*population_grid_200=*/1e2f));
+
+      unsigned u = x + y * side;
+      if (x + 1 < side) {
+        connections.push_back(std::make_pair(u, u + 1));
+      }
+      if (y + 1 < side) {
+        connections.push_back(std::make_pair(u, u + side));
+      }
+    }
+  }
+  FlowNetwork network = CreateFlowNetwork(probes, connections);
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
+
+  SourceImportanceSampler sampler(network.population, /*sample_count=*/1,
+                                  PhiloxEngine(13L));
+  sampler.UpdateSamples();
+  // A single worker searches each sample by Dijkstra's algorithm, while more
+  // workers than samples share each search.
+  SetParallelThreadCount(1);
+  std::vector<float> sequential;
+  SimulateFlow(network, state, sampler, &sequential);
+  SetParallelThreadCount(4);
+  std::vector<float> parallel;
+  SimulateFlow(network, state, sampler, &parallel);
+  SetParallelThreadCount(0);
+
+  // The grid is full of ties, which both break the same way.
+  BOOST_REQUIRE_EQUAL(sequential.size(), parallel.size());
+  unsigned different_count = 0;
+  float total_flow = 0;
+  for (unsigned j = 0; j < sequential.size(); ++j) {
+    different_count += std::bit_cast<std::uint32_t>(sequential[j]) !=
+                       std::bit_cast<std::uint32_t>(parallel[j]);
+    total_flow += sequential[j];
+  }
+  BOOST_CHECK_GT(total_flow, 0);
+  BOOST_CHECK_EQUAL(different_count, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(WhenSourcesAreBlocked_ThenCheckTotalTimeCostIsKept) {
+  unsigned const side = 12;
+  std::vector<PopulationProbe> probes;
+  std::vector<std::pair<unsigned, unsigned>> connections;
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      probes.push_back(PopulationProbe(Eigen::Vector3f(x * 500, y * 500, 0),
+                                       /*population_grid_200=*/1e2f * (x + 1)));
+
+      unsigned u = x + y * side;
+      if (x + 1 < side) {
+        connections.push_back(std::make_pair(u, u + 1));
+      }
+      if (y + 1 < side) {
+        connections.push_back(std::make_pair(u, u + side));
+      }
+    }
+  }
+  FlowNetwork network = CreateFlowNetwork(probes, connections);
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
+
+  std::vector<float> exact;
+  SimulateFlow(network, state, &exact);
+  std::vector<float> blocked;
+  SimulateFlowBySourceBlocks(network, state, &blocked);
+
+  // The paths of equal time cost may be taken differently, but every
+  // destination is reached at the same time cost.
+  double exact_time_cost = 0;
+  double blocked_time_cost = 0;
+  for (unsigned j = 0; j < network.EdgeCount(); ++j) {
+    exact_time_cost += exact[j] * state.cost[j];
+    blocked_time_cost += blocked[j] * state.cost[j];
+  }
+  BOOST_CHECK_GT(exact_time_cost, 0);
+  BOOST_CHECK_CLOSE(exact_time_cost, blocked_time_cost, 1e-2);
+
+  // So is each origin's departing flow.
+  for (unsigned v = 0; v < network.VertexCount(); ++v) {
+    float exact_departing = 0;
+    float blocked_departing = 0;
+    for (unsigned j = 0; j < network.EdgeCount(); ++j) {
+      if (network.sources[j] == v) {
+        exact_departing += exact[j] - exact[network.reverse_edges[j]];
+        blocked_departing += blocked[j] - blocked[network.reverse_edges[j]];
+      }
+    }
+    BOOST_CHECK_SMALL(exact_departing - blocked_departing, 1.0f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenOriginsAreClustered_ThenCheckFlowErrorIsBounded) {
+  unsigned const side = 12;
+  std::vector<PopulationProbe> probes;
+  std::vector<std::pair<unsigned, unsigned>> connections;
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      probes.push_back(PopulationProbe(Eigen::Vector3f(x * 500, y * 500, 0),
+                                       /*population_grid_200=*/1e2f * (x + 1)));
+
+      unsigned u = x + y * side;
+      if (x + 1 < side) {
+        connections.push_back(std::make_pair(u, u + 1));
+      }
+      if (y + 1 < side) {
+        connections.push_back(std::make_pair(u, u + side));
+      }
+    }
+  }
+  FlowNetwork network = CreateFlowNetwork(probes, connections);
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
+
+  std::vector<float> exact;
+  SimulateFlow(network, state, &exact);
+  float exact_total = 0;
+  for (float flow : exact) {
+    exact_total += flow;
+  }
+
+  // Without clustering, the result is exact.
+  std::vector<float> unclustered;
+  SimulateFlow(network, state, ClusterOrigins(network, /*radius=*/0),
+               &unclustered);
+  for (unsigned j = 0; j < network.EdgeCount(); ++j) {
+    BOOST_CHECK_CLOSE(exact[j], unclustered[j], 1e-2f);
+  }
+
+  // The error grows with the cluster radius. Neighbors sharing a tree are
+  // within a few tens of percent, while clusters spanning two blocks are
+  // already far off.
+  float previous_error = 0;
+  for (auto [radius, max_error] :
+       {std::make_pair(500.f, 0.25f), std::make_pair(1000.f, 0.75f)}) {
+    OriginClusters clusters = ClusterOrigins(network, radius);
+    std::vector<float> clustered;
+    SimulateFlow(network, state, clusters, &clustered);
+
+    float absolute_error = 0;
+    for (unsigned j = 0; j < network.EdgeCount(); ++j) {
+      absolute_error += std::abs(clustered[j] - exact[j]);
+    }
+    float relative_error = absolute_error / exact_total;
+    BOOST_TEST_MESSAGE("radius=" << radius << ", clusters="
+                                 << clusters.ClusterCount()
+                                 << ", relative_error=" << relative_error);
+
+    BOOST_CHECK_LT(clusters.ClusterCount(), side * side);
+    BOOST_CHECK_GT(relative_error, previous_error);
+    BOOST_CHECK_LT(relative_error, max_error);
+    previous_error = relative_error;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenMemberIsUnreachable_ThenCheckItTravelsOnItsOwn) {
+  // Two roads far apart, so that neither reaches the other.
+  std::vector<PopulationProbe> probes;
+  std::vector<std::pair<unsigned, unsigned>> connections;
+  for (unsigned road = 0; road < 2; ++road) {
+    for (unsigned x = 0; x < 4; ++x) {
+      probes.push_back(
+          PopulationProbe(Eigen::Vector3f(x * 500, road * 1e5f, 0),
+                          /*population_grid_200=*/1e2f * (x + 1)));
+      if (x > 0) {
+        connections.push_back(std::make_pair(road * 4 + x - 1, road * 4 + x));
+      }
+    }
+  }
+  FlowNetwork network = CreateFlowNetwork(probes, connections);
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
+
+  std::vector<float> exact;
+  SimulateFlow(network, state, &exact);
+
+  // Puts a vertex of the second road into the cluster of the first road's
+  // vertex. Its flows must not leak onto the first road.
+  OriginClusters clusters;
+  clusters.offsets = {0, 2, 3, 4, 5, 6, 7, 8};
+  clusters.members = {0, 5, 1, 2, 3, 4, 6, 7};
+  std::vector<float> clustered;
+  SimulateFlow(network, state, clusters, &clustered);
+
+  for (unsigned j = 0; j < network.EdgeCount(); ++j) {
+    BOOST_CHECK_CLOSE(exact[j], clustered[j], 1e-2f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenScenariosAreBatched_ThenCheckEachMatchesItsOwnFlow) {
+  unsigned const side = 8;
+  std::vector<PopulationProbe> probes;
+  std::vector<std::pair<unsigned, unsigned>> connections;
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      probes.push_back(PopulationProbe(Eigen::Vector3f(x * 500, y * 500, 0),
+                                       /*population_grid_200=*/1e3f));
+
+      unsigned u = x + y * side;
+      if (x + 1 < side) {
+        connections.push_back(std::make_pair(u, u + 1));
+      }
+      if (y + 1 < side) {
+        connections.push_back(std::make_pair(u, u + side));
+      }
+    }
+  }
+  FlowNetwork network = CreateFlowNetwork(probes, connections);
+  FlowState state(network);
+  UpdateFlowCosts(network, &state);
+
+  // A uniform scenario, a scaled one, and one with the population gathered
+  // along the left edge.
+  std::vector<std::vector<float>> scenario_populations(
+      3, std::vector<float>(network.VertexCount()));
+  for (unsigned v = 0; v < network.VertexCount(); ++v) {
+    scenario_populations[0][v] = 1e3f;
+    scenario_populations[1][v] = 2.5e3f;
+    scenario_populations[2][v] = v % side == 0 ? 1e4f : 1e2f;
+  }
+
+  std::vector<std::vector<float>> scenario_flows;
+  SimulateFlow(network, state, scenario_populations, &scenario_flows);
+
+  BOOST_CHECK_EQUAL(3, scenario_flows.size());
+  for (unsigned k = 0; k < scenario_populations.size(); ++k) {
+    FlowNetwork scenario_network = network;
+    scenario_network.population = scenario_populations[k];
+    std::vector<float> expected;
+    SimulateFlow(scenario_network, state, &expected);
+
+    BOOST_CHECK_EQUAL(expected.size(), scenario_flows[k].size());
+    for (unsigned j = 0; j < expected.size(); ++j) {
+      BOOST_CHECK_CLOSE(expected[j], scenario_flows[k][j], 1e-2f);
+    }
+  }
 }
 
 } // namespace
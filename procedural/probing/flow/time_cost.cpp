@@ -15,12 +15,10 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/flow/time_cost.hpp"
-#include "procedural/probing/flow/topology.hpp"
-#include "procedural/probing/probe/probe.hpp"
-#include <boost/graph/adjacency_list.hpp>
+#include "procedural/probing/flow/network.hpp"
+#include "procedural/probing/parallel/parallel.hpp"
 #include <cassert>
 #include <cmath>
-#include <eigen3/Eigen/Core>
 #include <vector>
 
 namespace e8 {
@@ -35,6 +33,8 @@ constexpr float const kLog9 = 2.197224577f;
 float const kFlowPerSecond = 1.f;
 float const kFlowFraction = .04f;
 
+unsigned const kMinVerticesPerChunk = 4096;
+
 float EstimateSpeed(float flow) {
   constexpr float scale = kLog9 / (kP10Flow - kP50Flow);
   float interpolant = 1.0f / (1.0 + std::exp(scale * (kP50Flow - flow)));
@@ -43,53 +43,57 @@ float EstimateSpeed(float flow) {
          interpolant * (kMaxSpeedMetersPerSecond - kMinSpeedMetersPerSecond);
 }
 
-float TravelTimeCost(unsigned u, unsigned v, TopologyFlow const &flow,
-                     std::vector<PopulationProbe> const &probes) {
-  assert(u != v);
-  auto [edge, existence] = boost::edge(u, v, flow);
-  assert(existence);
-
-  FlowProperties property = boost::get(boost::edge_bundle_t(), flow, edge);
-  float speed = EstimateSpeed(property.LaneFlow());
-
-  assert(probes[v].location != probes[u].location);
-  float distance = (probes[v].location - probes[u].location).norm();
-
-  return distance / speed;
-}
-
-float WaitTimeCost(unsigned v, TopologyFlow const &flow) {
-  if (boost::in_degree(v, flow) < 3) {
+float WaitTimeCost(unsigned in_degree, float incoming_flow) {
+  if (in_degree < 3) {
     return 0;
   }
-
-  float total_flow = 0.0f;
-  for (auto [current, end] = boost::in_edges(v, flow); current != end;
-       ++current) {
-    total_flow += boost::get(&FlowProperties::flow, flow, *current);
-  }
-  return total_flow * kFlowFraction / kFlowPerSecond;
+  return incoming_flow * kFlowFraction / kFlowPerSecond;
 }
 
 } // namespace
 
-FlowCostMap CreateFlowCostMapFrom(TopologyFlow const &flow,
-                                  std::vector<PopulationProbe> const &probes) {
-  assert(boost::num_vertices(flow) == probes.size());
-
-  FlowCostMap flow_cost(boost::num_vertices(flow));
-  for (auto [current, end] = boost::edges(flow); current != end; ++current) {
-    float travel_time_cost =
-        TravelTimeCost(current->m_source, current->m_target, flow, probes);
-    float wait_time_cost = WaitTimeCost(current->m_target, flow);
-
-    auto [edge, successful] =
-        boost::add_edge(current->m_source, current->m_target,
-                        travel_time_cost + wait_time_cost, flow_cost);
-    assert(successful);
-  }
-
-  return flow_cost;
+void UpdateFlowCosts(FlowNetwork const &network, FlowState *state) {
+  assert(state->flow.size() == network.EdgeCount());
+
+  // The edges entering a vertex are the reverses of those leaving it, so the
+  // incoming flows are gathered vertex by vertex, without any write conflict.
+  ParallelForChunks(
+      network.VertexCount(),
+      [&network, state](unsigned, unsigned begin, unsigned end) {
+        for (unsigned v = begin; v < end; ++v) {
+          float incoming_flow = 0.0f;
+          for (auto [current, edges_end] = boost::out_edges(v, network.graph);
+               current != edges_end; ++current) {
+            unsigned id =
+                boost::get(boost::edge_index, network.graph, *current);
+            incoming_flow += state->flow[network.reverse_edges[id]];
+          }
+          state->incoming_flow[v] = incoming_flow;
+        }
+      },
+      kMinVerticesPerChunk);
+
+  ParallelForChunks(
+      network.VertexCount(),
+      [&network, state](unsigned, unsigned begin, unsigned end) {
+        for (unsigned u = begin; u < end; ++u) {
+          for (auto [current, edges_end] = boost::out_edges(u, network.graph);
+               current != edges_end; ++current) {
+            unsigned id =
+                boost::get(boost::edge_index, network.graph, *current);
+            unsigned v = boost::target(*current, network.graph);
+
+            float lane_flow = state->flow[id] / state->lane_count[id];
+            float travel_time_cost =
+                network.distances[id] / EstimateSpeed(lane_flow);
+            float wait_time_cost =
+                WaitTimeCost(boost::out_degree(v, network.graph),
+                             state->incoming_flow[v]);
+            state->cost[id] = travel_time_cost + wait_time_cost;
+          }
+        }
+      },
+      kMinVerticesPerChunk);
 }
 
 } // namespace procedural
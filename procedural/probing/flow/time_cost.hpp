@@ -16,25 +16,14 @@
 
 #pragma once
 
-#include "procedural/probing/flow/topology.hpp"
-#include "procedural/probing/probe/probe.hpp"
-#include <boost/graph/adjacency_list.hpp>
+#include "procedural/probing/flow/network.hpp"
 
 namespace e8 {
 namespace procedural {
 
-// For storing the time cost required to go from one probe to the other.
-using FlowCost = boost::property<boost::edge_weight_t, float>;
-
-// For storing the time cost amongst the connections.
-using FlowCostMap = boost::adjacency_list<
-    /*OutEdgeListS=*/boost::vecS, /*VertexListS=*/boost::vecS,
-    /*DirectedS=*/boost::directedS, /*VertexProperty=*/boost::no_property,
-    /*EdgeProperty=*/FlowCost>;
-
-// Computes the time costs based on the specified flow measurement.
-FlowCostMap CreateFlowCostMapFrom(TopologyFlow const &flow,
-                                  std::vector<PopulationProbe> const &probes);
+// Recomputes the incoming flows and the edge costs of the flow state in place,
+// from its flows and lane counts. Each edge cost takes constant time.
+void UpdateFlowCosts(FlowNetwork const &network, FlowState *state);
 
 } // namespace procedural
 } // namespace e8
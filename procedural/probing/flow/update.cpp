@@ -15,9 +15,8 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/flow/update.hpp"
-#include "procedural/probing/flow/topology.hpp"
+#include "procedural/probing/flow/network.hpp"
 #include <algorithm>
-#include <boost/graph/adjacency_list.hpp>
 #include <cassert>
 #include <cmath>
 #include <limits>
@@ -34,9 +33,9 @@ unsigned SuitableLaneCount(float flow) {
   return std::max(1.f, std::round(std::sqrt(flow) / kSqrtFlowPerLane));
 }
 
-float UpdatedFlow(float simulated_flow, float current_flow) {
-  return kFlowUpdateRate * simulated_flow +
-         (1 - kFlowUpdateRate) * current_flow;
+float UpdatedFlow(float simulated_flow, float current_flow,
+                  float step = kFlowUpdateRate) {
+  return step * simulated_flow + (1 - step) * current_flow;
 }
 
 } // namespace
@@ -58,35 +57,56 @@ FlowStatistics::FlowStatistics(std::vector<float> const &flows)
   std = std::sqrt(sum_var / flows.size());
 }
 
-FlowStatistics UpdateFlow(TopologyFlow const &simulated_flow,
-                          TopologyFlow *current_flow) {
-  assert(boost::num_vertices(simulated_flow) ==
-         boost::num_vertices(*current_flow));
-  assert(boost::num_edges(simulated_flow) == boost::num_edges(*current_flow));
-
-  std::vector<float> edge_flow_values;
-  edge_flow_values.reserve(boost::num_edges(*current_flow));
-
-  for (auto [current, end] = boost::edges(*current_flow); current != end;
-       ++current) {
-    auto [simulated_edge, existence] =
-        boost::edge(current->m_source, current->m_target, simulated_flow);
-    assert(existence);
-    float simulated_flow_value =
-        boost::get(&FlowProperties::flow, simulated_flow, simulated_edge);
-    FlowProperties current_properties =
-        boost::get(boost::edge_bundle_t(), *current_flow, *current);
-
-    current_properties.flow =
-        UpdatedFlow(simulated_flow_value, current_properties.flow);
-    current_properties.lane_count = SuitableLaneCount(current_properties.flow);
-    boost::put(boost::edge_bundle_t(), *current_flow, *current,
-               current_properties);
-
-    edge_flow_values.push_back(current_properties.flow);
+FlowStatistics UpdateFlow(FlowState const &current, FlowState *next) {
+  return UpdateFlow(current, kFlowUpdateRate, next);
+}
+
+FlowStatistics UpdateFlow(FlowState const &current, float step,
+                          FlowState *next) {
+  assert(current.flow.size() == next->flow.size());
+  assert(step > 0 && step <= 1);
+
+  for (unsigned i = 0; i < next->flow.size(); ++i) {
+    next->flow[i] = UpdatedFlow(next->flow[i], current.flow[i], step);
+    next->lane_count[i] = SuitableLaneCount(next->flow[i]);
+  }
+
+  return FlowStatistics(next->flow);
+}
+
+float RelativeGap(FlowState const &current,
+                  std::vector<float> const &simulated_flow) {
+  assert(current.flow.size() == simulated_flow.size());
+  assert(current.cost.size() == simulated_flow.size());
+
+  double current_total_cost = 0;
+  double simulated_total_cost = 0;
+  for (unsigned i = 0; i < simulated_flow.size(); ++i) {
+    current_total_cost += current.cost[i] * current.flow[i];
+    simulated_total_cost += current.cost[i] * simulated_flow[i];
   }
 
-  return FlowStatistics(edge_flow_values);
+  if (current_total_cost <= 0) {
+    return 1;
+  }
+  return std::abs(current_total_cost - simulated_total_cost) /
+         current_total_cost;
+}
+
+float RelativeFlowChange(FlowState const &before, FlowState const &after) {
+  assert(before.flow.size() == after.flow.size());
+
+  double change = 0;
+  double total = 0;
+  for (unsigned i = 0; i < after.flow.size(); ++i) {
+    change += std::abs(after.flow[i] - before.flow[i]);
+    total += after.flow[i];
+  }
+
+  if (total <= 0) {
+    return 0;
+  }
+  return change / total;
 }
 
 } // namespace procedural
@@ -16,7 +16,7 @@
 
 #pragma once
 
-#include "procedural/probing/flow/topology.hpp"
+#include "procedural/probing/flow/network.hpp"
 #include <vector>
 
 namespace e8 {
@@ -39,11 +39,31 @@ struct FlowStatistics {
   float std;
 };
 
-// Updates the current topology flow using the simulated flow. It applies
-// exponential moving average on the current and simualted flows to prevent
-// oscillation of the shortest paths.
-FlowStatistics UpdateFlow(TopologyFlow const &simulated_flow,
-                          TopologyFlow *current_flow);
+// Updates the flows of the next state from the current state. On entry, the
+// flows of the next state hold the simulated flows. On return, they are an
+// exponential moving average of the current and simulated flows, which
+// prevents oscillation of the shortest paths, and the lane counts follow them.
+FlowStatistics UpdateFlow(FlowState const &current, FlowState *next);
+
+// Same as above, except that the simulated flows are blended in with the
+// specified step within (0, 1]. The method of successive averages takes the
+// step 1/k at the k-th iteration.
+FlowStatistics UpdateFlow(FlowState const &current, float step,
+                          FlowState *next);
+
+// Measures how far the current flow is from the equilibrium, with the relative
+// gap |sum_e c_e * (x_e - y_e)| / sum_e c_e * x_e, where x and y are the
+// current and the simulated flows, and c the costs of the current state. The
+// simulated flows take the shortest paths under these costs, so the gap
+// vanishes once no traveler can switch to a cheaper path. It's 1 when there is
+// no current flow.
+float RelativeGap(FlowState const &current,
+                  std::vector<float> const &simulated_flow);
+
+// Measures the change made by a flow update with
+// sum_e |x'_e - x_e| / sum_e x'_e, where x and x' are the flows before and
+// after the update. It's 0 when there is no flow after the update.
+float RelativeFlowChange(FlowState const &before, FlowState const &after);
 
 } // namespace procedural
 } // namespace e8
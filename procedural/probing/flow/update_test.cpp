@@ -15,153 +15,125 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define BOOST_TEST_MAIN
+#include "procedural/probing/flow/network.hpp"
 #include "procedural/probing/flow/topology.hpp"
 #include "procedural/probing/flow/update.hpp"
 #include "procedural/probing/probe/probe.hpp"
-#include <boost/graph/adjacency_list.hpp>
 #include <boost/test/unit_test.hpp>
 #include <eigen3/Eigen/Core>
+#include <utility>
 #include <vector>
 
 namespace e8 {
 namespace procedural {
 namespace {
 
+// The flow network of testing::CreateGridTopologyFlow(), with probes 1km apart.
+FlowNetwork CreateGridNetwork() {
+  std::vector<PopulationProbe> probes;
+  for (int y = 1; y >= -1; --y) {
+    for (int x = -1; x <= 1; ++x) {
+      probes.push_back(PopulationProbe(Eigen::Vector3f(x * 1e3f, y * 1e3f, 0),
+                                       /*population_grid_200=*/0));
+    }
+  }
+  return CreateFlowNetworkFrom(
+      testing::CreateGridTopologyFlow(/*flow_value=*/0), probes);
+}
+
 BOOST_AUTO_TEST_CASE(
     WhenSimulatedFlowIsCurrentFlow_ThenCheckUpdatedFlowIsInvariant) {
-  TopologyFlow current = testing::CreateGridTopologyFlow(/*flow_value=*/1.f);
-  TopologyFlow simulated = testing::CreateGridTopologyFlow(/*flow_value=*/1.f);
+  FlowNetwork network = CreateGridNetwork();
+  FlowState current(network);
+  current.flow.assign(network.EdgeCount(), 1.f);
+  FlowState next(network);
+  next.flow.assign(network.EdgeCount(), 1.f);
 
-  FlowStatistics stats = UpdateFlow(simulated, &current);
+  FlowStatistics stats = UpdateFlow(current, &next);
   BOOST_CHECK_EQUAL(1.f, stats.min);
   BOOST_CHECK_EQUAL(1.f, stats.max);
   BOOST_CHECK_EQUAL(1.f, stats.mean);
   BOOST_CHECK_EQUAL(0.f, stats.std);
 
-  BOOST_CHECK_EQUAL(9, boost::num_vertices(current));
-  BOOST_CHECK_EQUAL(8, boost::num_edges(current));
-
-  auto [edge_14, exists_14] = boost::edge(1, 4, current);
-  auto [edge_41, exists_41] = boost::edge(4, 1, current);
-  BOOST_CHECK(exists_14);
-  BOOST_CHECK(exists_41);
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_14),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_14));
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_41),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_41));
-
-  auto [edge_34, exists_34] = boost::edge(3, 4, current);
-  auto [edge_43, exists_43] = boost::edge(4, 3, current);
-  BOOST_CHECK(exists_34);
-  BOOST_CHECK(exists_43);
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_34),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_34));
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_43),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_43));
-
-  auto [edge_54, exists_54] = boost::edge(5, 4, current);
-  auto [edge_45, exists_45] = boost::edge(4, 5, current);
-  BOOST_CHECK(exists_54);
-  BOOST_CHECK(exists_45);
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_54),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_54));
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_45),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_45));
-
-  auto [edge_74, exists_74] = boost::edge(7, 4, current);
-  auto [edge_47, exists_47] = boost::edge(4, 7, current);
-  BOOST_CHECK(exists_74);
-  BOOST_CHECK(exists_47);
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_74),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_74));
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_47),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_47));
+  BOOST_REQUIRE_EQUAL(8, network.EdgeCount());
+  for (unsigned id = 0; id < network.EdgeCount(); ++id) {
+    BOOST_CHECK_CLOSE(1.f, next.flow[id], 1.f);
+    BOOST_CHECK_EQUAL(1, next.lane_count[id]);
+  }
 }
 
 BOOST_AUTO_TEST_CASE(WhenSimulatedFlowIsDifferent_ThenCheckFlowValueIsUpdated) {
-  TopologyFlow current = testing::CreateGridTopologyFlow(/*flow_value=*/1.f);
-
-  TopologyFlow simulated = current;
-  auto simulated_edge_14 = boost::edge(1, 4, simulated).first;
-  boost::put(boost::edge_bundle_t(), simulated, simulated_edge_14,
-             FlowProperties(/*flow=*/1e3f, /*lane_count=*/1));
-
-  FlowStatistics stats = UpdateFlow(simulated, &current);
+  FlowNetwork network = CreateGridNetwork();
+  FlowState current(network);
+  current.flow.assign(network.EdgeCount(), 1.f);
+  FlowState next(network);
+  next.flow.assign(network.EdgeCount(), 1.f);
+  unsigned edge_14 = FindFlowEdge(1, 4, network.graph);
+  next.flow[edge_14] = 1e3f;
+
+  FlowStatistics stats = UpdateFlow(current, &next);
   BOOST_CHECK_EQUAL(1.f, stats.min);
   BOOST_CHECK_CLOSE(1e2f, stats.max, 1.f);
   BOOST_CHECK_CLOSE(13.5f, stats.mean, 1.f);
   BOOST_CHECK_CLOSE(33.f, stats.std, 1.f);
 
-  BOOST_CHECK_EQUAL(9, boost::num_vertices(current));
-  BOOST_CHECK_EQUAL(8, boost::num_edges(current));
-
-  auto [edge_14, exists_14] = boost::edge(1, 4, current);
-  auto [edge_41, exists_41] = boost::edge(4, 1, current);
-  BOOST_CHECK(exists_14);
-  BOOST_CHECK(exists_41);
-  BOOST_CHECK_CLOSE(100.f, boost::get(&FlowProperties::flow, current, edge_14),
-                    1.f);
-  BOOST_CHECK_EQUAL(2,
-                    boost::get(&FlowProperties::lane_count, current, edge_14));
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_41),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_41));
-
-  auto [edge_34, exists_34] = boost::edge(3, 4, current);
-  auto [edge_43, exists_43] = boost::edge(4, 3, current);
-  BOOST_CHECK(exists_34);
-  BOOST_CHECK(exists_43);
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_34),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_34));
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_43),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_43));
-
-  auto [edge_54, exists_54] = boost::edge(5, 4, current);
-  auto [edge_45, exists_45] = boost::edge(4, 5, current);
-  BOOST_CHECK(exists_54);
-  BOOST_CHECK(exists_45);
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_54),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_54));
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_45),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_45));
-
-  auto [edge_74, exists_74] = boost::edge(7, 4, current);
-  auto [edge_47, exists_47] = boost::edge(4, 7, current);
-  BOOST_CHECK(exists_74);
-  BOOST_CHECK(exists_47);
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_74),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_74));
-  BOOST_CHECK_CLOSE(1.f, boost::get(&FlowProperties::flow, current, edge_47),
-                    1.f);
-  BOOST_CHECK_EQUAL(1,
-                    boost::get(&FlowProperties::lane_count, current, edge_47));
+  BOOST_REQUIRE_EQUAL(8, network.EdgeCount());
+  for (unsigned id = 0; id < network.EdgeCount(); ++id) {
+    if (id == edge_14) {
+      BOOST_CHECK_CLOSE(100.f, next.flow[id], 1.f);
+      BOOST_CHECK_EQUAL(2, next.lane_count[id]);
+    } else {
+      BOOST_CHECK_CLOSE(1.f, next.flow[id], 1.f);
+      BOOST_CHECK_EQUAL(1, next.lane_count[id]);
+    }
+  }
+}
+
+FlowNetwork CreateSingleConnectionNetwork() {
+  std::vector<PopulationProbe> probes{
+      PopulationProbe(Eigen::Vector3f(0, 0, 0), /*population_grid_200=*/1.f),
+      PopulationProbe(Eigen::Vector3f(1e3f, 0, 0), /*population_grid_200=*/1.f),
+  };
+  return CreateFlowNetwork(probes, {std::make_pair(0, 1)});
+}
+
+BOOST_AUTO_TEST_CASE(WhenUpdateWithStep_ThenCheckFlowIsBlended) {
+  FlowNetwork network = CreateSingleConnectionNetwork();
+
+  FlowState current(network);
+  current.flow = {10.f, 20.f};
+  FlowState next(network);
+  next.flow = {30.f, 20.f};
+
+  FlowStatistics stats = UpdateFlow(current, /*step=*/0.25f, &next);
+  BOOST_CHECK_CLOSE(15.f, next.flow[0], 1e-3f);
+  BOOST_CHECK_CLOSE(20.f, next.flow[1], 1e-3f);
+  BOOST_CHECK_CLOSE(15.f, stats.min, 1e-3f);
+  BOOST_CHECK_CLOSE(20.f, stats.max, 1e-3f);
+}
+
+BOOST_AUTO_TEST_CASE(WhenSimulatedFlowTakesCheaperPaths_ThenCheckRelativeGap) {
+  FlowNetwork network = CreateSingleConnectionNetwork();
+
+  FlowState current(network);
+  BOOST_CHECK_EQUAL(1.f, RelativeGap(current, {1.f, 1.f}));
+
+  current.flow = {10.f, 10.f};
+  current.cost = {2.f, 1.f};
+  BOOST_CHECK_SMALL(RelativeGap(current, {10.f, 10.f}), 1e-6f);
+  BOOST_CHECK_CLOSE(1.f / 3, RelativeGap(current, {0.f, 20.f}), 1e-3f);
+}
+
+BOOST_AUTO_TEST_CASE(WhenFlowIsUpdated_ThenCheckRelativeFlowChange) {
+  FlowNetwork network = CreateSingleConnectionNetwork();
+
+  FlowState before(network);
+  FlowState after(network);
+  BOOST_CHECK_EQUAL(0.f, RelativeFlowChange(before, after));
+
+  before.flow = {10.f, 10.f};
+  after.flow = {15.f, 5.f};
+  BOOST_CHECK_CLOSE(0.5f, RelativeFlowChange(before, after), 1e-3f);
 }
 
 } // namespace
@@ -0,0 +1,261 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/kernel/likelihood.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+constexpr float const kPi = std::numbers::pi_v<float>;
+constexpr float const kHalfPi = 0.5f * kPi;
+
+// Independent partial sums let the accumulation be vectorized without
+// reassociating a single running sum.
+unsigned const kLaneCount = 8;
+
+// Approximates cos(x) for x in [-pi, pi]. The argument is folded into
+// [0, pi/2], where the Taylor series truncated after the x^12 term is accurate
+// to within 1e-8, so the error is dominated by the float rounding.
+float PolynomialCos(float x) {
+  float a = std::abs(x);
+  bool reflected = a > kHalfPi;
+  float r = reflected ? kPi - a : a;
+  float r2 = r * r;
+  float c =
+      1.0f +
+      r2 * (-1.0f / 2 +
+            r2 * (1.0f / 24 +
+                  r2 * (-1.0f / 720 +
+                        r2 * (1.0f / 40320 +
+                              r2 * (-1.0f / 3628800 + r2 / 479001600)))));
+  return reflected ? -c : c;
+}
+
+struct PolynomialLikelihood {
+  float operator()(float time_cost) const {
+    float inside = time_cost <= max_time_seconds ? 1.0f : 0.0f;
+    float x = omega * std::min(time_cost, max_time_seconds) + phi;
+    return inside * 0.5f * (1.0f + PolynomialCos(x));
+  }
+
+  float phi;
+  float omega;
+  float max_time_seconds;
+};
+
+struct TableLikelihood {
+  float operator()(float time_cost) const {
+    float inside = time_cost <= max_time_seconds ? 1.0f : 0.0f;
+    float position = std::min(time_cost, max_time_seconds) * scale;
+    unsigned i = std::min(static_cast<unsigned>(position), last_interval);
+    float fraction = position - i;
+    return inside * (table[i] + fraction * (table[i + 1] - table[i]));
+  }
+
+  float const *table;
+  unsigned last_interval;
+  float scale;
+  float max_time_seconds;
+};
+
+template <typename LikelihoodFn>
+void EvaluateWith(LikelihoodFn const &likelihood,
+                  std::vector<float> const &time_costs,
+                  std::vector<float> *likelihoods) {
+  unsigned count = time_costs.size();
+  float const *t = time_costs.data();
+  float *result = likelihoods->data();
+  for (unsigned i = 0; i < count; ++i) {
+    result[i] = likelihood(t[i]);
+  }
+}
+
+template <bool kStoreTerms, typename LikelihoodFn>
+float MultiplyAccumulateWith(LikelihoodFn const &likelihood,
+                             std::vector<float> const &time_costs,
+                             std::vector<float> const &weights,
+                             std::vector<float> *weighted_likelihoods) {
+  unsigned count = time_costs.size();
+  float const *t = time_costs.data();
+  float const *w = weights.data();
+  float *terms = kStoreTerms ? weighted_likelihoods->data() : nullptr;
+
+  float partial_sums[kLaneCount] = {};
+  unsigned i = 0;
+  for (; i + kLaneCount <= count; i += kLaneCount) {
+    for (unsigned lane = 0; lane < kLaneCount; ++lane) {
+      float term = likelihood(t[i + lane]) * w[i + lane];
+      if constexpr (kStoreTerms) {
+        terms[i + lane] = term;
+      }
+      partial_sums[lane] += term;
+    }
+  }
+  for (unsigned lane = 0; i < count; ++i, ++lane) {
+    float term = likelihood(t[i]) * w[i];
+    if constexpr (kStoreTerms) {
+      terms[i] = term;
+    }
+    partial_sums[lane] += term;
+  }
+
+  float sum = 0;
+  for (float partial_sum : partial_sums) {
+    sum += partial_sum;
+  }
+  return sum;
+}
+
+template <typename LikelihoodFn>
+void MultiplyAccumulateEachWith(LikelihoodFn const &likelihood,
+                                std::vector<float> const &time_costs,
+                                std::vector<std::vector<float>> const &weights,
+                                std::vector<float> *sums) {
+  unsigned count = time_costs.size();
+  unsigned weighting_count = weights.size();
+  float const *t = time_costs.data();
+
+  // The lanes of every weighting follow each other.
+  std::vector<float> partial_sums(weighting_count * kLaneCount, 0.0f);
+  float likelihoods[kLaneCount];
+  unsigned i = 0;
+  for (; i + kLaneCount <= count; i += kLaneCount) {
+    for (unsigned lane = 0; lane < kLaneCount; ++lane) {
+      likelihoods[lane] = likelihood(t[i + lane]);
+    }
+    for (unsigned m = 0; m < weighting_count; ++m) {
+      float const *w = weights[m].data() + i;
+      float *partial = partial_sums.data() + m * kLaneCount;
+      for (unsigned lane = 0; lane < kLaneCount; ++lane) {
+        partial[lane] += likelihoods[lane] * w[lane];
+      }
+    }
+  }
+  for (unsigned lane = 0; i < count; ++i, ++lane) {
+    float l = likelihood(t[i]);
+    for (unsigned m = 0; m < weighting_count; ++m) {
+      partial_sums[m * kLaneCount + lane] += l * weights[m][i];
+    }
+  }
+
+  sums->assign(weighting_count, 0.0f);
+  for (unsigned m = 0; m < weighting_count; ++m) {
+    for (unsigned lane = 0; lane < kLaneCount; ++lane) {
+      (*sums)[m] += partial_sums[m * kLaneCount + lane];
+    }
+  }
+}
+
+} // namespace
+
+TravelLikelihoodKernel::TravelLikelihoodKernel(float phi,
+                                               float max_time_seconds,
+                                               unsigned table_size)
+    : phi_(phi), omega_((kPi - phi) / max_time_seconds),
+      max_time_seconds_(max_time_seconds),
+      table_scale_(table_size / max_time_seconds) {
+  assert(phi >= -kPi && phi <= kPi);
+  assert(max_time_seconds > 0);
+
+  if (table_size == 0) {
+    return;
+  }
+
+  table_.resize(table_size + 1);
+  for (unsigned i = 0; i <= table_size; ++i) {
+    table_[i] = Evaluate(i / table_scale_);
+  }
+}
+
+float TravelLikelihoodKernel::Evaluate(float time_cost) const {
+  assert(time_cost >= 0.0);
+
+  if (time_cost > max_time_seconds_) {
+    return 0;
+  }
+  return 0.5 * (1 + std::cos(omega_ * time_cost + phi_));
+}
+
+void TravelLikelihoodKernel::Evaluate(std::vector<float> const &time_costs,
+                                      std::vector<float> *likelihoods) const {
+  likelihoods->resize(time_costs.size());
+
+  if (table_.empty()) {
+    EvaluateWith(PolynomialLikelihood{phi_, omega_, max_time_seconds_},
+                 time_costs, likelihoods);
+  } else {
+    EvaluateWith(TableLikelihood{table_.data(), LastTableInterval(),
+                                 table_scale_, max_time_seconds_},
+                 time_costs, likelihoods);
+  }
+}
+
+float TravelLikelihoodKernel::MultiplyAccumulate(
+    std::vector<float> const &time_costs, std::vector<float> const &weights,
+    std::vector<float> *weighted_likelihoods) const {
+  assert(time_costs.size() == weights.size());
+
+  PolynomialLikelihood polynomial{phi_, omega_, max_time_seconds_};
+  TableLikelihood table{table_.data(), LastTableInterval(), table_scale_,
+                        max_time_seconds_};
+
+  if (weighted_likelihoods == nullptr) {
+    return table_.empty()
+               ? MultiplyAccumulateWith</*kStoreTerms=*/false>(
+                     polynomial, time_costs, weights, weighted_likelihoods)
+               : MultiplyAccumulateWith</*kStoreTerms=*/false>(
+                     table, time_costs, weights, weighted_likelihoods);
+  }
+
+  weighted_likelihoods->resize(time_costs.size());
+  return table_.empty()
+             ? MultiplyAccumulateWith</*kStoreTerms=*/true>(
+                   polynomial, time_costs, weights, weighted_likelihoods)
+             : MultiplyAccumulateWith</*kStoreTerms=*/true>(
+                   table, time_costs, weights, weighted_likelihoods);
+}
+
+void TravelLikelihoodKernel::MultiplyAccumulate(
+    std::vector<float> const &time_costs,
+    std::vector<std::vector<float>> const &weights,
+    std::vector<float> *sums) const {
+  for (auto const &weighting : weights) {
+    assert(weighting.size() == time_costs.size());
+  }
+
+  PolynomialLikelihood polynomial{phi_, omega_, max_time_seconds_};
+  TableLikelihood table{table_.data(), LastTableInterval(), table_scale_,
+                        max_time_seconds_};
+
+  if (table_.empty()) {
+    MultiplyAccumulateEachWith(polynomial, time_costs, weights, sums);
+  } else {
+    MultiplyAccumulateEachWith(table, time_costs, weights, sums);
+  }
+}
+
+unsigned TravelLikelihoodKernel::LastTableInterval() const {
+  return table_.empty() ? 0 : table_.size() - 2;
+}
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,84 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// The maximum absolute error of the batch evaluations below, with respect to
+// the exact raised cosine. The lookup table has an interpolation error which
+// decreases quadratically with its size. It stays within the bound from
+// kMinAccurateTravelLikelihoodTableSize intervals onward.
+constexpr float const kTravelLikelihoodMaxError = 2e-6f;
+constexpr unsigned const kMinAccurateTravelLikelihoodTableSize = 1024;
+
+// Estimates the proportion of the population willing to spend a given amount
+// of time in commute, with the raised cosine,
+// P(travel|t) = 0.5 * (1 + cos(omega * t + phi)), for t <= max_time_seconds,
+// P(travel|t) = 0,                                 otherwise,
+// where omega = (pi - phi) / max_time_seconds. So the likelihood reaches zero
+// at max_time_seconds.
+//
+// The batch evaluations are branchless and loop over contiguous arrays so they
+// are vectorized by the compiler. The cosine is either approximated by a
+// polynomial, or, when table_size is non-zero, linearly interpolated from a
+// precomputed lookup table of that many intervals.
+class TravelLikelihoodKernel {
+public:
+  // phi must be within [-pi, pi].
+  TravelLikelihoodKernel(float phi, float max_time_seconds,
+                         unsigned table_size = 0);
+
+  // Evaluates the likelihood with the exact cosine. It serves as a reference.
+  float Evaluate(float time_cost) const;
+
+  // Evaluates the likelihood for every time cost.
+  void Evaluate(std::vector<float> const &time_costs,
+                std::vector<float> *likelihoods) const;
+
+  // Computes \sum_i P(travel|time_costs[i]) * weights[i] in one pass. When
+  // weighted_likelihoods is specified, the individual terms are stored into it
+  // as well.
+  float
+  MultiplyAccumulate(std::vector<float> const &time_costs,
+                     std::vector<float> const &weights,
+                     std::vector<float> *weighted_likelihoods = nullptr) const;
+
+  // Computes \sum_i P(travel|time_costs[i]) * weights[m][i] for every
+  // weighting m into (*sums)[m], in one pass where each likelihood is
+  // evaluated once and shared amongst the weightings.
+  void MultiplyAccumulate(std::vector<float> const &time_costs,
+                          std::vector<std::vector<float>> const &weights,
+                          std::vector<float> *sums) const;
+
+private:
+  unsigned LastTableInterval() const;
+
+  float phi_;
+  float omega_;
+  float max_time_seconds_;
+
+  // Samples of the likelihood at every interval boundary over
+  // [0, max_time_seconds]. It's empty when the polynomial is used.
+  std::vector<float> table_;
+  float table_scale_;
+};
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,135 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/kernel/likelihood.hpp"
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+float const kMaxTimeSeconds = 3600.0f;
+float const kPhis[] = {0.0f, -1.159279481f};
+
+std::vector<float> CreateTimeCosts() {
+  // Covers the full domain, beyond the maximum, and unreachable targets.
+  std::vector<float> time_costs;
+  for (float t = 0; t < 4000.0f; t += 0.37f) {
+    time_costs.push_back(t);
+  }
+  time_costs.push_back(kMaxTimeSeconds);
+  time_costs.push_back(std::numeric_limits<float>::max());
+  return time_costs;
+}
+
+float MaxErrorOf(TravelLikelihoodKernel const &kernel,
+                 std::vector<float> const &time_costs) {
+  std::vector<float> likelihoods;
+  kernel.Evaluate(time_costs, &likelihoods);
+  BOOST_REQUIRE_EQUAL(time_costs.size(), likelihoods.size());
+
+  float max_error = 0;
+  for (unsigned i = 0; i < time_costs.size(); ++i) {
+    max_error = std::max(
+        max_error, std::abs(likelihoods[i] - kernel.Evaluate(time_costs[i])));
+  }
+  return max_error;
+}
+
+BOOST_AUTO_TEST_CASE(WhenEvaluateWithPolynomial_ThenCheckErrorBound) {
+  std::vector<float> time_costs = CreateTimeCosts();
+  for (float phi : kPhis) {
+    TravelLikelihoodKernel kernel(phi, kMaxTimeSeconds);
+    BOOST_CHECK_LE(MaxErrorOf(kernel, time_costs), kTravelLikelihoodMaxError);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenEvaluateWithTable_ThenCheckErrorBound) {
+  std::vector<float> time_costs = CreateTimeCosts();
+  for (float phi : kPhis) {
+    TravelLikelihoodKernel kernel(phi, kMaxTimeSeconds,
+                                  kMinAccurateTravelLikelihoodTableSize);
+    BOOST_CHECK_LE(MaxErrorOf(kernel, time_costs), kTravelLikelihoodMaxError);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenOutOfRange_ThenCheckZeroLikelihood) {
+  TravelLikelihoodKernel kernel(/*phi=*/0, kMaxTimeSeconds);
+  std::vector<float> likelihoods;
+  kernel.Evaluate({kMaxTimeSeconds + 1, std::numeric_limits<float>::max()},
+                  &likelihoods);
+
+  BOOST_CHECK_EQUAL(0, likelihoods[0]);
+  BOOST_CHECK_EQUAL(0, likelihoods[1]);
+  BOOST_CHECK_CLOSE(1.0f, kernel.Evaluate(0.0f), 1e-4f);
+}
+
+BOOST_AUTO_TEST_CASE(WhenMultiplyAccumulate_ThenCheckWeightedSum) {
+  std::vector<float> time_costs = CreateTimeCosts();
+  std::vector<float> weights(time_costs.size());
+  for (unsigned i = 0; i < weights.size(); ++i) {
+    weights[i] = 1.0f + i % 7;
+  }
+
+  TravelLikelihoodKernel kernel(/*phi=*/-1.159279481f, kMaxTimeSeconds);
+  std::vector<float> likelihoods;
+  kernel.Evaluate(time_costs, &likelihoods);
+
+  std::vector<float> weighted_likelihoods;
+  float sum =
+      kernel.MultiplyAccumulate(time_costs, weights, &weighted_likelihoods);
+  BOOST_REQUIRE_EQUAL(time_costs.size(), weighted_likelihoods.size());
+
+  double expected_sum = 0;
+  for (unsigned i = 0; i < time_costs.size(); ++i) {
+    BOOST_CHECK_CLOSE(likelihoods[i] * weights[i], weighted_likelihoods[i],
+                      1e-4f);
+    expected_sum += likelihoods[i] * weights[i];
+  }
+  BOOST_CHECK_CLOSE(expected_sum, sum, 1e-3f);
+  BOOST_CHECK_EQUAL(sum, kernel.MultiplyAccumulate(time_costs, weights));
+}
+
+BOOST_AUTO_TEST_CASE(WhenWeightingsAreMany_ThenCheckEachWeightedSum) {
+  std::vector<float> time_costs = CreateTimeCosts();
+  std::vector<std::vector<float>> weights(
+      3, std::vector<float>(time_costs.size()));
+  for (unsigned i = 0; i < time_costs.size(); ++i) {
+    weights[0][i] = 1.0f + i % 7;
+    weights[1][i] = 1.0f / (1 + i % 5);
+    weights[2][i] = i % 2;
+  }
+
+  for (unsigned table_size : {0U, kMinAccurateTravelLikelihoodTableSize}) {
+    TravelLikelihoodKernel kernel(/*phi=*/-1.159279481f, kMaxTimeSeconds,
+                                  table_size);
+    std::vector<float> sums;
+    kernel.MultiplyAccumulate(time_costs, weights, &sums);
+    BOOST_REQUIRE_EQUAL(weights.size(), sums.size());
+    for (unsigned m = 0; m < weights.size(); ++m) {
+      BOOST_CHECK_CLOSE(kernel.MultiplyAccumulate(time_costs, weights[m]),
+                        sums[m], 1e-4f);
+    }
+  }
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
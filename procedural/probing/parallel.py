@@ -0,0 +1,41 @@
+"""
+ e8City
+ Copyright (C) 2023 e8yes
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ """
+
+import e8citydll
+
+
+def SetThreadCount(thread_count: int) -> None:
+    """Sets the number of threads the probing computations, e.g.
+        ComputePopulationProbeTopology() and EstimateProbeTopologyFlow(), may
+        run on at once, including the calling thread. It shouldn't be called
+        while any of them is running.
+
+    Args:
+        thread_count (int): The thread budget. Zero restores the default, which
+            is the number of hardware threads.
+    """
+    e8citydll.SetThreadCount(thread_count)
+
+
+def ThreadCount() -> int:
+    """Returns the thread budget set by SetThreadCount().
+
+    Returns:
+        int: The number of threads the probing computations may run on.
+    """
+    return e8citydll.ThreadCount()
@@ -0,0 +1,422 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/parallel/parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+struct Task {
+  // It doesn't throw, see TaskGroup::Run().
+  std::function<void()> fn;
+
+  // The number of unfinished tasks of the group the task belongs to.
+  std::atomic<unsigned> *pending_count;
+};
+
+// A fixed set of threads, each of which owns a deque of tasks. A thread pushes
+// and pops the tasks it spawns at the back of its own deque, so nested work
+// stays depth first and cache warm, while idle threads steal the oldest tasks
+// from the front of the others' deques. The threads outside the pool share
+// deque 0.
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(unsigned thread_count);
+  ~WorkStealingPool();
+
+  void Push(Task task);
+
+  // Waits for the pending count to reach zero, executing the pending tasks
+  // meanwhile.
+  void WaitFor(std::atomic<unsigned> const &pending_count);
+
+private:
+  struct TaskDeque {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  unsigned OwnDequeIndex() const;
+  std::optional<Task> Pop(unsigned deque_index);
+  std::optional<Task> Steal(unsigned deque_index);
+  bool TryRunOne();
+  void Execute(Task task);
+  void WorkerLoop(unsigned deque_index);
+
+  std::vector<std::unique_ptr<TaskDeque>> deques_;
+  std::vector<std::thread> threads_;
+
+  // The number of tasks in the deques. Sleeping threads are woken up on
+  // changes of it, of a pending count reaching zero, and of stopping_.
+  std::atomic<unsigned> queued_count_;
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_up_;
+  bool stopping_;
+};
+
+// The pool the current thread belongs to, and the deque it owns there.
+thread_local WorkStealingPool const *gCurrentPool = nullptr;
+thread_local unsigned gCurrentDequeIndex = 0;
+
+// The number of tasks the current thread is running, nested in each other.
+thread_local unsigned gTaskDepth = 0;
+
+// Counts the current thread as running a task for the scope.
+class TaskDepthScope {
+public:
+  TaskDepthScope() { ++gTaskDepth; }
+  ~TaskDepthScope() { --gTaskDepth; }
+};
+
+WorkStealingPool::WorkStealingPool(unsigned thread_count)
+    : queued_count_(0), stopping_(false) {
+  assert(thread_count >= 1);
+
+  deques_.reserve(thread_count);
+  for (unsigned i = 0; i < thread_count; ++i) {
+    deques_.push_back(std::make_unique<TaskDeque>());
+  }
+  // The calling thread is the last worker.
+  threads_.reserve(thread_count - 1);
+  for (unsigned i = 1; i < thread_count; ++i) {
+    threads_.emplace_back([this, i] { this->WorkerLoop(i); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  wake_up_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+  assert(queued_count_ == 0);
+}
+
+void WorkStealingPool::Push(Task task) {
+  TaskDeque &deque = *deques_[OwnDequeIndex()];
+  {
+    std::lock_guard<std::mutex> lock(deque.mutex);
+    deque.tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    ++queued_count_;
+  }
+  wake_up_.notify_one();
+}
+
+void WorkStealingPool::WaitFor(std::atomic<unsigned> const &pending_count) {
+  while (pending_count != 0) {
+    if (this->TryRunOne()) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_up_.wait(lock, [this, &pending_count] {
+      return pending_count == 0 || queued_count_ > 0;
+    });
+  }
+}
+
+unsigned WorkStealingPool::OwnDequeIndex() const {
+  return gCurrentPool == this ? gCurrentDequeIndex : 0;
+}
+
+std::optional<Task> WorkStealingPool::Pop(unsigned deque_index) {
+  TaskDeque &deque = *deques_[deque_index];
+  std::lock_guard<std::mutex> lock(deque.mutex);
+  if (deque.tasks.empty()) {
+    return std::nullopt;
+  }
+  Task task = std::move(deque.tasks.back());
+  deque.tasks.pop_back();
+  --queued_count_;
+  return task;
+}
+
+std::optional<Task> WorkStealingPool::Steal(unsigned deque_index) {
+  TaskDeque &deque = *deques_[deque_index];
+  std::lock_guard<std::mutex> lock(deque.mutex);
+  if (deque.tasks.empty()) {
+    return std::nullopt;
+  }
+  Task task = std::move(deque.tasks.front());
+  deque.tasks.pop_front();
+  --queued_count_;
+  return task;
+}
+
+bool WorkStealingPool::TryRunOne() {
+  if (queued_count_ == 0) {
+    return false;
+  }
+
+  unsigned own = this->OwnDequeIndex();
+  std::optional<Task> task = this->Pop(own);
+  for (unsigned i = 1; !task.has_value() && i < deques_.size(); ++i) {
+    task = this->Steal((own + i) % deques_.size());
+  }
+  if (!task.has_value()) {
+    return false;
+  }
+
+  this->Execute(std::move(*task));
+  return true;
+}
+
+void WorkStealingPool::Execute(Task task) {
+  // Finishes the task on the way out of the scope, however the task returns.
+  class PendingTaskScope {
+  public:
+    PendingTaskScope(WorkStealingPool *pool,
+                     std::atomic<unsigned> *pending_count)
+        : pool_(pool), pending_count_(pending_count) {}
+
+    ~PendingTaskScope() {
+      if (--*pending_count_ == 0) {
+        // Holding the lock orders the wake up after the waiter's last check.
+        std::lock_guard<std::mutex> lock(pool_->sleep_mutex_);
+        pool_->wake_up_.notify_all();
+      }
+    }
+
+  private:
+    WorkStealingPool *pool_;
+    std::atomic<unsigned> *pending_count_;
+  };
+
+  PendingTaskScope pending(this, task.pending_count);
+  TaskDepthScope depth;
+  task.fn();
+}
+
+void WorkStealingPool::WorkerLoop(unsigned deque_index) {
+  gCurrentPool = this;
+  gCurrentDequeIndex = deque_index;
+
+  while (true) {
+    if (this->TryRunOne()) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    wake_up_.wait(lock, [this] { return stopping_ || queued_count_ > 0; });
+    if (stopping_ && queued_count_ == 0) {
+      return;
+    }
+  }
+}
+
+// The pool is created under the mutex and owned by gPoolOwner, while gPool
+// publishes it, so the spawns look it up without taking the mutex.
+std::mutex gPoolMutex;
+std::unique_ptr<WorkStealingPool> gPoolOwner;
+std::atomic<WorkStealingPool *> gPool(nullptr);
+std::atomic<unsigned> gThreadCount(0);
+
+// Held by the ParallelForWorkers() call which has reserved the pool threads.
+std::mutex gReservationMutex;
+
+WorkStealingPool &Pool() {
+  WorkStealingPool *pool = gPool.load(std::memory_order_acquire);
+  if (pool != nullptr) {
+    return *pool;
+  }
+
+  std::lock_guard<std::mutex> lock(gPoolMutex);
+  if (gPoolOwner == nullptr) {
+    gPoolOwner = std::make_unique<WorkStealingPool>(ParallelWorkerCount());
+    gPool.store(gPoolOwner.get(), std::memory_order_release);
+  }
+  return *gPoolOwner;
+}
+
+void RunOnWorkers(unsigned worker_count,
+                  std::function<void(unsigned worker_index)> const &fn) {
+  if (worker_count <= 1) {
+    fn(/*worker_index=*/0);
+    return;
+  }
+
+  TaskGroup group;
+  for (unsigned i = 1; i < worker_count; ++i) {
+    group.Run([i, &fn] { fn(i); });
+  }
+  {
+    // The calling thread's share is a task of the group as well. Should it
+    // throw, the group waits for the other shares on destruction.
+    TaskDepthScope depth;
+    fn(/*worker_index=*/0);
+  }
+  group.Wait();
+}
+
+} // namespace
+
+void SetParallelThreadCount(unsigned thread_count) {
+  std::lock_guard<std::mutex> lock(gPoolMutex);
+  // The pool is recreated on its next use.
+  gPool.store(nullptr, std::memory_order_release);
+  gPoolOwner.reset();
+  gThreadCount = thread_count;
+}
+
+unsigned ParallelWorkerCount() {
+  unsigned thread_count = gThreadCount;
+  if (thread_count != 0) {
+    return thread_count;
+  }
+  return std::max(1U, std::thread::hardware_concurrency());
+}
+
+TaskGroup::TaskGroup() : pending_count_(0) {}
+
+TaskGroup::~TaskGroup() { this->WaitForPendingTasks(); }
+
+void TaskGroup::Run(std::function<void()> task) {
+  ++pending_count_;
+  // The exception is kept for Wait() rather than let out onto the pool thread.
+  Pool().Push(Task{.fn =
+                       [this, task = std::move(task)] {
+                         try {
+                           task();
+                         } catch (...) {
+                           std::lock_guard<std::mutex> lock(exception_mutex_);
+                           if (exception_ == nullptr) {
+                             exception_ = std::current_exception();
+                           }
+                         }
+                       },
+                   .pending_count = &pending_count_});
+}
+
+void TaskGroup::Wait() {
+  this->WaitForPendingTasks();
+
+  std::exception_ptr exception;
+  {
+    std::lock_guard<std::mutex> lock(exception_mutex_);
+    std::swap(exception, exception_);
+  }
+  if (exception != nullptr) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void TaskGroup::WaitForPendingTasks() {
+  if (pending_count_ != 0) {
+    Pool().WaitFor(pending_count_);
+  }
+}
+
+void ParallelForChunks(unsigned count,
+                       std::function<void(unsigned worker_index, unsigned begin,
+                                          unsigned end)> const &chunk_fn,
+                       unsigned min_chunk_size) {
+  if (count == 0) {
+    return;
+  }
+
+  unsigned max_chunk_count =
+      std::max(1U, count / std::max(1U, min_chunk_size));
+  unsigned worker_count = std::min(max_chunk_count, ParallelWorkerCount());
+  unsigned chunk_size = (count + worker_count - 1) / worker_count;
+  RunOnWorkers(worker_count, [count, chunk_size, &chunk_fn](unsigned worker) {
+    unsigned begin = std::min(count, worker * chunk_size);
+    unsigned end = std::min(count, begin + chunk_size);
+    if (begin < end) {
+      chunk_fn(worker, begin, end);
+    }
+  });
+}
+
+void ParallelForFixedChunks(
+    unsigned count, unsigned chunk_size,
+    std::function<void(unsigned chunk_index, unsigned begin,
+                       unsigned end)> const &chunk_fn) {
+  assert(chunk_size > 0);
+
+  unsigned chunk_count = (count + chunk_size - 1) / chunk_size;
+  ParallelFor(chunk_count, [count, chunk_size, &chunk_fn](unsigned chunk) {
+    unsigned begin = chunk * chunk_size;
+    chunk_fn(chunk, begin, std::min(count, begin + chunk_size));
+  });
+}
+
+void ParallelFor(unsigned count, std::function<void(unsigned i)> const &fn) {
+  if (count == 0) {
+    return;
+  }
+
+  std::atomic<unsigned> next(0);
+  unsigned worker_count = std::min(count, ParallelWorkerCount());
+  RunOnWorkers(worker_count, [count, &next, &fn](unsigned) {
+    for (unsigned i = next++; i < count; i = next++) {
+      fn(i);
+    }
+  });
+}
+
+void ParallelForWorkers(
+    std::function<void(unsigned worker_index, unsigned worker_count,
+                       std::barrier<> &sync)> const &fn) {
+  std::unique_lock<std::mutex> reservation(gReservationMutex,
+                                           std::try_to_lock);
+  if (gTaskDepth > 0 || !reservation.owns_lock()) {
+    // The pool threads may all be blocked in the tasks around this call, so
+    // none of them can be promised to the workers.
+    std::barrier<> sync(1);
+    fn(/*worker_index=*/0, /*worker_count=*/1, sync);
+    return;
+  }
+
+  // Nothing else reserves the pool threads meanwhile, and none of them waits
+  // on the calling thread, so each of them picks up a worker in the end.
+  unsigned worker_count = ParallelWorkerCount();
+  std::barrier<> sync(worker_count);
+  RunOnWorkers(worker_count, [worker_count, &sync, &fn](unsigned worker) {
+    try {
+      fn(worker, worker_count, sync);
+    } catch (...) {
+      // The others would wait for the worker at the barrier forever.
+      sync.arrive_and_drop();
+      throw;
+    }
+  });
+}
+
+void ParallelInvoke(std::vector<std::function<void()>> const &tasks) {
+  ParallelFor(tasks.size(), [&tasks](unsigned i) { tasks[i](); });
+}
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,120 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <barrier>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// The primitives below run on a process wide work stealing pool. The pool is
+// made of ParallelWorkerCount() - 1 threads, and the calling thread makes up
+// the last worker: it executes pending tasks while it waits for its own, so the
+// primitives may nest within each other's tasks without adding threads. When
+// the work throws, the primitives still wait for all of it to return, then
+// rethrow the first exception.
+
+// Sets the number of threads the process may run the parallel work on,
+// including the calling thread. Zero restores the default, which is the number
+// of hardware threads. It must not be called while any parallel work is in
+// progress.
+void SetParallelThreadCount(unsigned thread_count);
+
+// The number of workers the parallel primitives below spread the work onto.
+// It's the thread budget set by SetParallelThreadCount().
+unsigned ParallelWorkerCount();
+
+// Runs a group of tasks on the pool. Tasks may be added from any thread,
+// including from within the tasks of the group.
+class TaskGroup {
+public:
+  TaskGroup();
+  TaskGroup(TaskGroup const &) = delete;
+  TaskGroup &operator=(TaskGroup const &) = delete;
+
+  // Waits for the remaining tasks. Unlike Wait(), it drops the exception thrown
+  // by any of them.
+  ~TaskGroup();
+
+  // Schedules the task to run concurrently.
+  void Run(std::function<void()> task);
+
+  // Blocks until every task run so far returns. Meanwhile, the calling thread
+  // executes the pending tasks of the pool. If any of the tasks threw, the
+  // first exception is rethrown once all of them have returned.
+  void Wait();
+
+private:
+  void WaitForPendingTasks();
+
+  std::atomic<unsigned> pending_count_;
+
+  // The first exception thrown by the tasks since the last Wait().
+  std::mutex exception_mutex_;
+  std::exception_ptr exception_;
+};
+
+// Splits the index range [0, count) into contiguous chunks, at most one per
+// worker, then runs chunk_fn(worker_index, begin, end) on every chunk
+// concurrently. Chunks are assigned to worker indices in ascending order of
+// begin. No chunk is made smaller than min_chunk_size unless the range itself
+// is, so small ranges run on the calling thread. It blocks until all the
+// chunks are processed.
+void ParallelForChunks(unsigned count,
+                       std::function<void(unsigned worker_index, unsigned begin,
+                                          unsigned end)> const &chunk_fn,
+                       unsigned min_chunk_size = 1);
+
+// Splits the index range [0, count) into contiguous chunks of chunk_size, the
+// last of which may be shorter, then runs chunk_fn(chunk_index, begin, end) on
+// every chunk concurrently. Unlike the above, the chunks depend on neither the
+// thread budget nor the scheduling, so per chunk results which are combined in
+// the order of the chunk indices are reproducible. There are
+// ceil(count / chunk_size) chunks. It blocks until all the chunks are
+// processed.
+void ParallelForFixedChunks(
+    unsigned count, unsigned chunk_size,
+    std::function<void(unsigned chunk_index, unsigned begin,
+                       unsigned end)> const &chunk_fn);
+
+// Runs fn(i) for every i in [0, count) concurrently. Indices are handed out to
+// the workers one at a time, so it suits items of uneven cost. It blocks until
+// all the items are processed.
+void ParallelFor(unsigned count, std::function<void(unsigned i)> const &fn);
+
+// Runs fn(worker_index, worker_count, sync) once on each of the worker_count
+// workers concurrently. Unlike the above, all the workers are running at the
+// same time, so they may synchronize with each other through sync, a barrier
+// of all of them. The workers are the pool threads, which the call reserves
+// for itself. When the calling thread is running a pool task, or another call
+// holds the reservation, no idle thread can be promised, so fn(0, 1, sync)
+// runs on the calling thread alone. A worker which throws drops out of sync, so
+// the others don't wait for it. It blocks until every worker returns.
+void ParallelForWorkers(
+    std::function<void(unsigned worker_index, unsigned worker_count,
+                       std::barrier<> &sync)> const &fn);
+
+// Runs the independent tasks concurrently and blocks until all of them return.
+void ParallelInvoke(std::vector<std::function<void()>> const &tasks);
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,288 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/parallel/parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+BOOST_AUTO_TEST_CASE(WhenRunParallelFor_ThenCheckEveryIndexIsVisitedOnce) {
+  std::vector<unsigned> visits(1000, 0);
+  ParallelFor(visits.size(), [&visits](unsigned i) { ++visits[i]; });
+
+  for (unsigned visit_count : visits) {
+    BOOST_CHECK_EQUAL(1, visit_count);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenRunParallelForChunks_ThenCheckChunksCoverRange) {
+  std::vector<unsigned> visits(1000, 0);
+  std::vector<unsigned> chunk_begins(ParallelWorkerCount(), 1000);
+  ParallelForChunks(visits.size(), [&visits, &chunk_begins](
+                                       unsigned worker, unsigned begin,
+                                       unsigned end) {
+    chunk_begins[worker] = begin;
+    for (unsigned i = begin; i < end; ++i) {
+      ++visits[i];
+    }
+  });
+
+  for (unsigned visit_count : visits) {
+    BOOST_CHECK_EQUAL(1, visit_count);
+  }
+  BOOST_CHECK_EQUAL(0, chunk_begins[0]);
+  for (unsigned i = 1; i < chunk_begins.size(); ++i) {
+    BOOST_CHECK_LE(chunk_begins[i - 1], chunk_begins[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenRangeIsBelowMinChunkSize_ThenCheckSingleChunk) {
+  unsigned chunk_count = 0;
+  ParallelForChunks(
+      /*count=*/100,
+      [&chunk_count](unsigned worker, unsigned begin, unsigned end) {
+        BOOST_CHECK_EQUAL(0, worker);
+        BOOST_CHECK_EQUAL(0, begin);
+        BOOST_CHECK_EQUAL(100, end);
+        ++chunk_count;
+      },
+      /*min_chunk_size=*/1000);
+  BOOST_CHECK_EQUAL(1, chunk_count);
+}
+
+BOOST_AUTO_TEST_CASE(WhenRunParallelForWorkers_ThenCheckWorkersMeet) {
+  SetParallelThreadCount(4);
+  std::vector<unsigned> visits(ParallelWorkerCount(), 0);
+  std::vector<unsigned> worker_counts(ParallelWorkerCount(), 0);
+  ParallelForWorkers([&visits, &worker_counts](unsigned worker,
+                                               unsigned worker_count,
+                                               std::barrier<> &sync) {
+    ++visits[worker];
+    worker_counts[worker] = worker_count;
+    // Every worker has to arrive for any of them to pass.
+    sync.arrive_and_wait();
+  });
+
+  for (unsigned i = 0; i < visits.size(); ++i) {
+    BOOST_CHECK_EQUAL(1, visits[i]);
+    BOOST_CHECK_EQUAL(4, worker_counts[i]);
+  }
+  SetParallelThreadCount(0);
+}
+
+BOOST_AUTO_TEST_CASE(WhenRunParallelForWorkersInTasks_ThenCheckTheyRunAlone) {
+  SetParallelThreadCount(4);
+  unsigned const task_count = 8;
+  std::vector<unsigned> visits(task_count, 0);
+  std::vector<unsigned> worker_counts(task_count, 0);
+  ParallelFor(task_count, [&visits, &worker_counts](unsigned i) {
+    ParallelForWorkers([&visits, &worker_counts, i](unsigned worker,
+                                                    unsigned worker_count,
+                                                    std::barrier<> &sync) {
+      visits[i] += worker + 1;
+      worker_counts[i] = worker_count;
+      sync.arrive_and_wait();
+    });
+  });
+
+  for (unsigned i = 0; i < task_count; ++i) {
+    BOOST_CHECK_EQUAL(1, visits[i]);
+    BOOST_CHECK_EQUAL(1, worker_counts[i]);
+  }
+  SetParallelThreadCount(0);
+}
+
+BOOST_AUTO_TEST_CASE(WhenInvokeTasks_ThenCheckEveryTaskRuns) {
+  unsigned a = 0;
+  unsigned b = 0;
+  ParallelInvoke({[&a] { a = 1; }, [&b] { b = 2; }});
+  BOOST_CHECK_EQUAL(1, a);
+  BOOST_CHECK_EQUAL(2, b);
+}
+
+BOOST_AUTO_TEST_CASE(WhenRangeIsEmpty_ThenCheckNothingRuns) {
+  unsigned call_count = 0;
+  ParallelFor(0, [&call_count](unsigned) { ++call_count; });
+  ParallelForChunks(0, [&call_count](unsigned, unsigned, unsigned) {
+    ++call_count;
+  });
+  BOOST_CHECK_EQUAL(0, call_count);
+}
+
+BOOST_AUTO_TEST_CASE(WhenRunTaskGroup_ThenCheckNestedTasksFinish) {
+  std::atomic<unsigned> run_count(0);
+  TaskGroup group;
+  for (unsigned i = 0; i < 8; ++i) {
+    group.Run([&run_count] {
+      TaskGroup nested;
+      for (unsigned j = 0; j < 8; ++j) {
+        nested.Run([&run_count] { ++run_count; });
+      }
+      nested.Wait();
+      ++run_count;
+    });
+  }
+  group.Wait();
+  BOOST_CHECK_EQUAL(8 * 8 + 8, run_count);
+}
+
+BOOST_AUTO_TEST_CASE(WhenTaskThrows_ThenCheckWaitRethrowsAfterEveryTask) {
+  SetParallelThreadCount(4);
+  std::atomic<unsigned> run_count(0);
+  TaskGroup group;
+  for (unsigned i = 0; i < 16; ++i) {
+    group.Run([i, &run_count] {
+      ++run_count;
+      if (i % 4 == 0) {
+        throw std::runtime_error("task");
+      }
+    });
+  }
+  BOOST_CHECK_THROW(group.Wait(), std::runtime_error);
+  BOOST_CHECK_EQUAL(16, run_count);
+
+  // The exception has been consumed, and the pool is still usable.
+  group.Run([&run_count] { ++run_count; });
+  group.Wait();
+  BOOST_CHECK_EQUAL(17, run_count);
+  SetParallelThreadCount(0);
+}
+
+BOOST_AUTO_TEST_CASE(WhenLoopBodyThrows_ThenCheckTheLoopRethrows) {
+  SetParallelThreadCount(4);
+  std::atomic<unsigned> visit_count(0);
+  BOOST_CHECK_THROW(ParallelFor(100,
+                                [&visit_count](unsigned i) {
+                                  ++visit_count;
+                                  if (i == 37) {
+                                    throw std::runtime_error("item");
+                                  }
+                                }),
+                    std::runtime_error);
+  // Only the worker which threw stops early.
+  BOOST_CHECK_LE(100 - ParallelWorkerCount() + 1, visit_count);
+
+  BOOST_CHECK_THROW(ParallelForChunks(1000,
+                                      [](unsigned worker, unsigned, unsigned) {
+                                        if (worker == 0) {
+                                          throw std::runtime_error("chunk");
+                                        }
+                                      }),
+                    std::runtime_error);
+
+  std::vector<unsigned> visits(1000, 0);
+  ParallelFor(visits.size(), [&visits](unsigned i) { ++visits[i]; });
+  for (unsigned visit_count : visits) {
+    BOOST_CHECK_EQUAL(1, visit_count);
+  }
+  SetParallelThreadCount(0);
+}
+
+BOOST_AUTO_TEST_CASE(WhenWorkerThrows_ThenCheckTheOthersPassTheBarrier) {
+  SetParallelThreadCount(4);
+  std::atomic<unsigned> passed_count(0);
+  BOOST_CHECK_THROW(
+      ParallelForWorkers([&passed_count](unsigned worker, unsigned,
+                                         std::barrier<> &sync) {
+        if (worker == 1) {
+          throw std::runtime_error("worker");
+        }
+        sync.arrive_and_wait();
+        sync.arrive_and_wait();
+        ++passed_count;
+      }),
+      std::runtime_error);
+  BOOST_CHECK_EQUAL(3, passed_count);
+  SetParallelThreadCount(0);
+}
+
+BOOST_AUTO_TEST_CASE(WhenNestParallelFor_ThenCheckNoWorkerIsStarved) {
+  // The outer loop occupies both workers, which then have to execute the
+  // inner loops' tasks while waiting for them.
+  SetParallelThreadCount(2);
+  std::vector<unsigned> visits(16 * 16, 0);
+  ParallelFor(16, [&visits](unsigned i) {
+    ParallelFor(16, [i, &visits](unsigned j) { ++visits[16 * i + j]; });
+  });
+  SetParallelThreadCount(0);
+
+  for (unsigned visit_count : visits) {
+    BOOST_CHECK_EQUAL(1, visit_count);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenSetThreadCount_ThenCheckTheBudgetIsKept) {
+  SetParallelThreadCount(1);
+  BOOST_CHECK_EQUAL(1, ParallelWorkerCount());
+
+  // With a single thread, everything runs on the calling one.
+  std::thread::id caller = std::this_thread::get_id();
+  unsigned foreign_count = 0;
+  ParallelFor(100, [caller, &foreign_count](unsigned) {
+    foreign_count += std::this_thread::get_id() != caller;
+  });
+  BOOST_CHECK_EQUAL(0, foreign_count);
+
+  SetParallelThreadCount(3);
+  BOOST_CHECK_EQUAL(3, ParallelWorkerCount());
+  std::vector<unsigned> visits(1000, 0);
+  ParallelForChunks(visits.size(),
+                    [&visits](unsigned worker, unsigned begin, unsigned end) {
+                      for (unsigned i = begin; i < end; ++i) {
+                        visits[i] = worker;
+                      }
+                    });
+  BOOST_CHECK_EQUAL(2, *std::max_element(visits.begin(), visits.end()));
+
+  SetParallelThreadCount(0);
+  BOOST_CHECK_EQUAL(std::max(1U, std::thread::hardware_concurrency()),
+                    ParallelWorkerCount());
+}
+
+BOOST_AUTO_TEST_CASE(WhenRunFixedChunks_ThenCheckChunksIgnoreThreadCount) {
+  std::vector<std::vector<std::pair<unsigned, unsigned>>> runs;
+  for (unsigned thread_count : {1U, 2U, 5U}) {
+    SetParallelThreadCount(thread_count);
+    std::vector<std::pair<unsigned, unsigned>> chunks(4);
+    ParallelForFixedChunks(
+        /*count=*/100, /*chunk_size=*/30,
+        [&chunks](unsigned chunk, unsigned begin, unsigned end) {
+          chunks[chunk] = std::make_pair(begin, end);
+        });
+    runs.push_back(chunks);
+  }
+  SetParallelThreadCount(0);
+
+  std::vector<std::pair<unsigned, unsigned>> expected = {
+      {0, 30}, {30, 60}, {60, 90}, {90, 100}};
+  for (auto const &chunks : runs) {
+    BOOST_CHECK(expected == chunks);
+  }
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
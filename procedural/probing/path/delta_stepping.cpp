@@ -0,0 +1,267 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/path/delta_stepping.hpp"
+#include "procedural/probing/parallel/parallel.hpp"
+#include "procedural/probing/path/graph.hpp"
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cassert>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+// Lowers the target to the value unless it's already lower. Returns whether
+// it's lowered.
+bool AtomicMin(float value, std::atomic<float> *target) {
+  float current = target->load(std::memory_order_relaxed);
+  while (value < current) {
+    if (target->compare_exchange_weak(current, value,
+                                      std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+struct BucketEntry {
+  float time_cost;
+  unsigned vertex;
+};
+
+// The search state shared by the workers. The relaxations are done
+// concurrently, while the bucket bookkeeping is done by worker 0 alone in
+// between the barriers.
+class DeltaSteppingSearch {
+public:
+  DeltaSteppingSearch(PathGraph const &graph, unsigned source,
+                      float bucket_width, float horizon)
+      : graph_(graph), bucket_width_(bucket_width), horizon_(horizon),
+        time_costs_(graph.VertexCount()),
+        frontier_marks_(graph.VertexCount(), 0),
+        member_marks_(graph.VertexCount(), 0), buckets_(1),
+        worker_requests_(ParallelWorkerCount()) {
+    for (auto &time_cost : time_costs_) {
+      time_cost.store(kUnreachedTimeCost, std::memory_order_relaxed);
+    }
+    time_costs_[source].store(0, std::memory_order_relaxed);
+    buckets_[0].push_back(BucketEntry{.time_cost = 0, .vertex = source});
+  }
+
+  void Run() {
+    ParallelForWorkers([this](unsigned worker, unsigned worker_count,
+                              std::barrier<> &sync) {
+      while (true) {
+        if (worker == 0) {
+          SelectNextBucket();
+        }
+        sync.arrive_and_wait();
+        if (frontier_.empty()) {
+          // Every bucket is empty.
+          break;
+        }
+
+        // Settles the bucket through the light arcs. The vertices they lower
+        // into the bucket are relaxed again on the next round.
+        while (true) {
+          Relax(worker, worker_count, frontier_, /*light=*/true);
+          sync.arrive_and_wait();
+          if (worker == 0) {
+            MergeLightRequests();
+          }
+          sync.arrive_and_wait();
+          if (frontier_.empty()) {
+            break;
+          }
+        }
+
+        // The heavy arcs always lead to later buckets.
+        Relax(worker, worker_count, bucket_members_, /*light=*/false);
+        sync.arrive_and_wait();
+        if (worker == 0) {
+          MergeHeavyRequests();
+        }
+      }
+    });
+  }
+
+  void CopyTimeCosts(std::vector<float> *time_costs) const {
+    time_costs->resize(time_costs_.size());
+    for (unsigned v = 0; v < time_costs_.size(); ++v) {
+      (*time_costs)[v] = time_costs_[v].load(std::memory_order_relaxed);
+    }
+  }
+
+private:
+  // Relaxes the light or heavy arcs of the worker's share of the vertices.
+  // The heads whose time costs are lowered are requested for a bucket.
+  void Relax(unsigned worker, unsigned worker_count,
+             std::vector<unsigned> const &vertices, bool light) {
+    unsigned begin = vertices.size() * worker / worker_count;
+    unsigned end = vertices.size() * (worker + 1) / worker_count;
+    std::vector<unsigned> &requests = worker_requests_[worker];
+    for (unsigned i = begin; i < end; ++i) {
+      unsigned u = vertices[i];
+      float u_time_cost = time_costs_[u].load(std::memory_order_relaxed);
+      for (unsigned arc = graph_.first_arcs[u]; arc < graph_.first_arcs[u + 1];
+           ++arc) {
+        float cost = graph_.costs[arc];
+        if ((cost <= bucket_width_) != light) {
+          continue;
+        }
+        float v_time_cost = u_time_cost + cost;
+        unsigned v = graph_.heads[arc];
+        if (v_time_cost <= horizon_ &&
+            AtomicMin(v_time_cost, &time_costs_[v])) {
+          requests.push_back(v);
+        }
+      }
+    }
+  }
+
+  void AddToFrontier(unsigned v) {
+    if (frontier_marks_[v] != round_) {
+      frontier_marks_[v] = round_;
+      frontier_.push_back(v);
+    }
+  }
+
+  // Puts the lowered vertex into the bucket of its time cost, or into the
+  // frontier when it's the current bucket. Heavy relaxations always go to a
+  // later bucket, even if the rounding says otherwise.
+  void Enqueue(unsigned v, bool light) {
+    float time_cost = time_costs_[v].load(std::memory_order_relaxed);
+    unsigned bucket = time_cost / bucket_width_;
+    if (light && bucket <= current_bucket_) {
+      AddToFrontier(v);
+      return;
+    }
+    bucket = std::max(bucket, current_bucket_ + 1);
+    if (bucket >= buckets_.size()) {
+      buckets_.resize(bucket + 1);
+    }
+    buckets_[bucket].push_back(
+        BucketEntry{.time_cost = time_cost, .vertex = v});
+  }
+
+  void MergeRequests(bool light) {
+    for (auto &requests : worker_requests_) {
+      for (unsigned v : requests) {
+        Enqueue(v, light);
+      }
+      requests.clear();
+    }
+  }
+
+  void MergeLightRequests() {
+    for (unsigned v : frontier_) {
+      if (!member_marks_[v]) {
+        member_marks_[v] = 1;
+        bucket_members_.push_back(v);
+      }
+    }
+    frontier_.clear();
+    ++round_;
+    MergeRequests(/*light=*/true);
+  }
+
+  void MergeHeavyRequests() {
+    for (unsigned v : bucket_members_) {
+      member_marks_[v] = 0;
+    }
+    bucket_members_.clear();
+    MergeRequests(/*light=*/false);
+  }
+
+  // Takes the entries out of the next non-empty bucket. A vertex which has
+  // been lowered since its entry was made has a newer entry, so the older one
+  // is dropped.
+  void SelectNextBucket() {
+    ++round_;
+    for (; next_bucket_ < buckets_.size(); ++next_bucket_) {
+      current_bucket_ = next_bucket_;
+      for (auto const &entry : buckets_[current_bucket_]) {
+        if (entry.time_cost ==
+            time_costs_[entry.vertex].load(std::memory_order_relaxed)) {
+          AddToFrontier(entry.vertex);
+        }
+      }
+      buckets_[current_bucket_].clear();
+      buckets_[current_bucket_].shrink_to_fit();
+      if (!frontier_.empty()) {
+        ++next_bucket_;
+        return;
+      }
+    }
+  }
+
+  PathGraph const &graph_;
+  float bucket_width_;
+  float horizon_;
+
+  std::vector<std::atomic<float>> time_costs_;
+
+  // The vertices to relax on the current round, and the round on which each
+  // vertex has been added last.
+  std::vector<unsigned> frontier_;
+  std::vector<unsigned> frontier_marks_;
+  unsigned round_ = 0;
+
+  // The vertices relaxed in the current bucket so far.
+  std::vector<unsigned> bucket_members_;
+  std::vector<unsigned char> member_marks_;
+
+  // The vertices waiting in each bucket, along with their time cost at the
+  // time they were put in.
+  std::vector<std::vector<BucketEntry>> buckets_;
+  unsigned current_bucket_ = 0;
+  unsigned next_bucket_ = 0;
+
+  std::vector<std::vector<unsigned>> worker_requests_;
+};
+
+} // namespace
+
+float SuitableBucketWidth(PathGraph const &graph) {
+  if (graph.ArcCount() == 0) {
+    return 1;
+  }
+
+  double total_cost = 0;
+  for (float cost : graph.costs) {
+    total_cost += cost;
+  }
+  return total_cost / graph.ArcCount();
+}
+
+void DeltaSteppingShortestPaths(PathGraph const &graph, unsigned source,
+                                float bucket_width, float horizon,
+                                std::vector<float> *time_costs) {
+  assert(source < graph.VertexCount());
+  assert(bucket_width > 0);
+  // The buckets are allocated up to the horizon.
+  assert(horizon / bucket_width < 1e8f);
+
+  DeltaSteppingSearch search(graph, source, bucket_width, horizon);
+  search.Run();
+  search.CopyTimeCosts(time_costs);
+}
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,45 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "procedural/probing/path/graph.hpp"
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// Picks the bucket width of the delta stepping search. It's the mean arc
+// cost, so that a typical arc is light and gets relaxed within its bucket,
+// while the number of buckets to go through stays around the path length in
+// arcs.
+float SuitableBucketWidth(PathGraph const &graph);
+
+// Computes the time cost of the shortest paths from the source to every vertex
+// within the horizon. The others are left at kUnreachedTimeCost. The vertices
+// are processed in buckets of bucket_width seconds. Within a bucket, the arcs
+// no longer than the width are relaxed repeatedly until the bucket settles,
+// then the longer arcs are relaxed once. Every relaxation round is shared
+// amongst the workers, so it's meant for a single large search when there
+// aren't enough sources to keep the workers busy. Within a pool task, it runs
+// on the calling thread alone, see ParallelForWorkers(). The arc costs must
+// be positive, and the horizon must be finite.
+void DeltaSteppingShortestPaths(PathGraph const &graph, unsigned source,
+                                float bucket_width, float horizon,
+                                std::vector<float> *time_costs);
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,97 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/path/delta_stepping.hpp"
+#include "procedural/probing/path/graph.hpp"
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+// A grid with random arc costs in both directions, plus a few long range arcs
+// which are heavy under any reasonable bucket width.
+PathGraph CreateRandomGraph(unsigned side) {
+  std::default_random_engine random_engine(5);
+  std::uniform_real_distribution<float> cost(1, 100);
+  return testing::CreateGridPathGraph(
+      side, [&random_engine, &cost]() { return cost(random_engine); },
+      /*long_arc_count=*/side);
+}
+
+BOOST_AUTO_TEST_CASE(WhenGraphIsRandom_ThenCheckTimeCostsMatchDijkstra) {
+  PathGraph graph = CreateRandomGraph(/*side=*/30);
+  float mean_cost = SuitableBucketWidth(graph);
+
+  for (unsigned source : {0U, 451U, 899U}) {
+    std::vector<float> expected = testing::DijkstraTimeCosts(graph, source);
+    for (float bucket_width : {0.1f * mean_cost, mean_cost, 10 * mean_cost}) {
+      std::vector<float> time_costs;
+      DeltaSteppingShortestPaths(graph, source, bucket_width,
+                                 /*horizon=*/1e6f, &time_costs);
+
+      BOOST_CHECK_EQUAL(graph.VertexCount(), time_costs.size());
+      for (unsigned v = 0; v < graph.VertexCount(); ++v) {
+        BOOST_CHECK_CLOSE(expected[v], time_costs[v], 1e-3f);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenHorizonIsShort_ThenCheckFarVerticesAreUnreached) {
+  PathGraph graph = CreateRandomGraph(/*side=*/30);
+  std::vector<float> expected = testing::DijkstraTimeCosts(graph, /*source=*/0);
+
+  std::vector<float> time_costs;
+  DeltaSteppingShortestPaths(graph, /*source=*/0, SuitableBucketWidth(graph),
+                             /*horizon=*/300, &time_costs);
+
+  unsigned reached_count = 0;
+  for (unsigned v = 0; v < graph.VertexCount(); ++v) {
+    if (expected[v] <= 300) {
+      BOOST_CHECK_CLOSE(expected[v], time_costs[v], 1e-3f);
+      ++reached_count;
+    } else {
+      BOOST_CHECK_EQUAL(kUnreachedTimeCost, time_costs[v]);
+    }
+  }
+  BOOST_CHECK_GT(reached_count, 1);
+  BOOST_CHECK_LT(reached_count, graph.VertexCount());
+}
+
+BOOST_AUTO_TEST_CASE(WhenVertexIsIsolated_ThenCheckItIsUnreached) {
+  PathGraph graph{
+      .first_arcs = {0, 1, 2, 2},
+      .heads = {1, 0},
+      .costs = {5, 7},
+  };
+
+  std::vector<float> time_costs;
+  DeltaSteppingShortestPaths(graph, /*source=*/1, SuitableBucketWidth(graph),
+                             /*horizon=*/1e3f, &time_costs);
+
+  BOOST_CHECK_EQUAL(7, time_costs[0]);
+  BOOST_CHECK_EQUAL(0, time_costs[1]);
+  BOOST_CHECK_EQUAL(kUnreachedTimeCost, time_costs[2]);
+  BOOST_CHECK_EQUAL(6, SuitableBucketWidth(graph));
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,97 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/path/graph.hpp"
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+unsigned PathGraph::VertexCount() const {
+  return first_arcs.empty() ? 0 : first_arcs.size() - 1;
+}
+
+unsigned PathGraph::ArcCount() const { return heads.size(); }
+
+namespace testing {
+
+PathGraph CreateGridPathGraph(unsigned side,
+                              std::function<float()> const &arc_cost,
+                              unsigned long_arc_count) {
+  std::vector<std::vector<std::pair<unsigned, float>>> arcs(side * side);
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      unsigned u = x + y * side;
+      if (x + 1 < side) {
+        arcs[u].push_back(std::make_pair(u + 1, arc_cost()));
+        arcs[u + 1].push_back(std::make_pair(u, arc_cost()));
+      }
+      if (y + 1 < side) {
+        arcs[u].push_back(std::make_pair(u + side, arc_cost()));
+        arcs[u + side].push_back(std::make_pair(u, arc_cost()));
+      }
+    }
+  }
+
+  std::default_random_engine random_engine(5);
+  std::uniform_int_distribution<unsigned> vertex(0, side * side - 1);
+  for (unsigned i = 0; i < long_arc_count; ++i) {
+    unsigned tail = vertex(random_engine);
+    unsigned head = vertex(random_engine);
+    arcs[tail].push_back(std::make_pair(head, 10 * arc_cost()));
+  }
+
+  PathGraph graph;
+  graph.first_arcs.push_back(0);
+  for (auto const &vertex_arcs : arcs) {
+    for (auto [head, cost] : vertex_arcs) {
+      graph.heads.push_back(head);
+      graph.costs.push_back(cost);
+    }
+    graph.first_arcs.push_back(graph.heads.size());
+  }
+  return graph;
+}
+
+std::vector<float> DijkstraTimeCosts(PathGraph const &graph, unsigned source) {
+  using ReferenceGraph = boost::adjacency_list<
+      /*OutEdgeListS=*/boost::vecS, /*VertexListS=*/boost::vecS,
+      /*DirectedS=*/boost::directedS, /*VertexProperty=*/boost::no_property,
+      /*EdgeProperty=*/boost::property<boost::edge_weight_t, float>>;
+
+  ReferenceGraph reference(graph.VertexCount());
+  for (unsigned u = 0; u < graph.VertexCount(); ++u) {
+    for (unsigned arc = graph.first_arcs[u]; arc < graph.first_arcs[u + 1];
+         ++arc) {
+      boost::add_edge(u, graph.heads[arc], graph.costs[arc], reference);
+    }
+  }
+
+  std::vector<float> time_costs(graph.VertexCount());
+  boost::dijkstra_shortest_paths(reference, boost::vertex(source, reference),
+                                 boost::distance_map(&time_costs[0]));
+  return time_costs;
+}
+
+} // namespace testing
+
+} // namespace procedural
+} // namespace e8
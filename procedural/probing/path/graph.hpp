@@ -0,0 +1,61 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// The time cost of the vertices which aren't reached. It's the same as the
+// default of boost::dijkstra_shortest_paths().
+constexpr float const kUnreachedTimeCost = std::numeric_limits<float>::max();
+
+// A directed graph in compressed sparse row form, with a time cost on every
+// arc. It's the common input of the shortest path searches under path/, which
+// are fed from either the efficiency cost map or the flow network.
+struct PathGraph {
+  unsigned VertexCount() const;
+  unsigned ArcCount() const;
+
+  // The arcs leaving vertex v are first_arcs[v] to first_arcs[v + 1] - 1.
+  std::vector<unsigned> first_arcs;
+
+  // The head and the time cost of each arc.
+  std::vector<unsigned> heads;
+  std::vector<float> costs;
+};
+
+namespace testing {
+
+// Creates a side by side grid with an arc in both directions between
+// neighbors, plus long_arc_count arcs between random vertices. The cost of
+// every arc is drawn from arc_cost, and a long arc costs ten times as much.
+PathGraph CreateGridPathGraph(unsigned side,
+                              std::function<float()> const &arc_cost,
+                              unsigned long_arc_count = 0);
+
+// Computes the time costs from the source to every vertex by
+// boost::dijkstra_shortest_paths(), as a reference for the searches.
+std::vector<float> DijkstraTimeCosts(PathGraph const &graph, unsigned source);
+
+} // namespace testing
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,91 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/path/multi_source.hpp"
+#include "procedural/probing/path/graph.hpp"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+using CostAndVertex = std::pair<float, unsigned>;
+
+} // namespace
+
+void MultiSourceShortestPaths(PathGraph const &graph,
+                              std::vector<unsigned> const &sources,
+                              float horizon, std::vector<float> *time_costs) {
+  unsigned const K = sources.size();
+  assert(K > 0 && K <= kMaxSourceBlockSize);
+
+  unsigned vertex_count = graph.VertexCount();
+  time_costs->assign(vertex_count * K, kUnreachedTimeCost);
+
+  // The key each vertex is queued by, if it's queued.
+  std::vector<float> queued_keys(vertex_count, kUnreachedTimeCost);
+  std::priority_queue<CostAndVertex, std::vector<CostAndVertex>,
+                      std::greater<CostAndVertex>>
+      queue;
+  for (unsigned k = 0; k < K; ++k) {
+    assert(sources[k] < vertex_count);
+    (*time_costs)[sources[k] * K + k] = 0;
+    if (queued_keys[sources[k]] > 0) {
+      queued_keys[sources[k]] = 0;
+      queue.push(std::make_pair(0.0f, sources[k]));
+    }
+  }
+
+  while (!queue.empty()) {
+    auto [key, u] = queue.top();
+    queue.pop();
+    if (key != queued_keys[u]) {
+      // Outdated entry.
+      continue;
+    }
+    queued_keys[u] = kUnreachedTimeCost;
+
+    float const *u_time_costs = time_costs->data() + u * K;
+    for (unsigned arc = graph.first_arcs[u]; arc < graph.first_arcs[u + 1];
+         ++arc) {
+      float cost = graph.costs[arc];
+      unsigned v = graph.heads[arc];
+      float *v_time_costs = time_costs->data() + v * K;
+
+      // The unreached lanes stay unreached, as kUnreachedTimeCost absorbs
+      // the arc cost in rounding.
+      float min_lowered = kUnreachedTimeCost;
+      for (unsigned k = 0; k < K; ++k) {
+        float time_cost = u_time_costs[k] + cost;
+        bool lowered = time_cost < v_time_costs[k] && time_cost <= horizon;
+        v_time_costs[k] = lowered ? time_cost : v_time_costs[k];
+        min_lowered = lowered ? std::min(min_lowered, time_cost) : min_lowered;
+      }
+      if (min_lowered < queued_keys[v]) {
+        queued_keys[v] = min_lowered;
+        queue.push(std::make_pair(min_lowered, v));
+      }
+    }
+  }
+}
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,44 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "procedural/probing/path/graph.hpp"
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// The number of sources a caller searches together by default, and the most
+// MultiSourceShortestPaths() accepts.
+constexpr unsigned const kSourceBlockSize = 8;
+constexpr unsigned const kMaxSourceBlockSize = 16;
+
+// Computes the time cost of the shortest paths from each of the K sources to
+// every vertex within the horizon, in a single search over a shared queue. The
+// others are left at kUnreachedTimeCost. The result is a vertex major block,
+// where (*time_costs)[v * K + k] is the time cost from the k-th source to v,
+// so every arc is relaxed for all the sources at once over contiguous lanes,
+// which the compiler vectorizes. A vertex is queued by the least time cost
+// lowered among its lanes, and requeued whenever any lane is lowered again,
+// so nearby sources, whose search fronts move together, share the most work.
+// The arc costs must be non-negative.
+void MultiSourceShortestPaths(PathGraph const &graph,
+                              std::vector<unsigned> const &sources,
+                              float horizon, std::vector<float> *time_costs);
+
+} // namespace procedural
+} // namespace e8
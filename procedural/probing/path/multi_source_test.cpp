@@ -0,0 +1,80 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/path/graph.hpp"
+#include "procedural/probing/path/multi_source.hpp"
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+// A grid with random arc costs in both directions.
+PathGraph CreateRandomGrid(unsigned side) {
+  std::default_random_engine random_engine(3);
+  std::uniform_real_distribution<float> cost(1, 100);
+  return testing::CreateGridPathGraph(
+      side, [&random_engine, &cost]() { return cost(random_engine); });
+}
+
+BOOST_AUTO_TEST_CASE(WhenSourcesAreBlocked_ThenCheckEachLaneMatchesDijkstra) {
+  PathGraph graph = CreateRandomGrid(/*side=*/20);
+
+  // Nearby and scattered sources, with a duplicate.
+  for (std::vector<unsigned> sources :
+       {std::vector<unsigned>{7}, std::vector<unsigned>{0, 1, 2, 20, 21, 22},
+        std::vector<unsigned>{5, 399, 120, 5, 250, 77, 300, 18, 1, 2, 3, 4,
+                              390, 210, 211, 60}}) {
+    std::vector<float> time_costs;
+    MultiSourceShortestPaths(graph, sources, /*horizon=*/1e6f, &time_costs);
+
+    unsigned const K = sources.size();
+    BOOST_CHECK_EQUAL(graph.VertexCount() * K, time_costs.size());
+    for (unsigned k = 0; k < K; ++k) {
+      std::vector<float> expected =
+          testing::DijkstraTimeCosts(graph, sources[k]);
+      for (unsigned v = 0; v < graph.VertexCount(); ++v) {
+        BOOST_CHECK_CLOSE(expected[v], time_costs[v * K + k], 1e-3f);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenHorizonIsShort_ThenCheckFarVerticesAreUnreached) {
+  PathGraph graph = CreateRandomGrid(/*side=*/20);
+  std::vector<unsigned> sources{0, 210};
+
+  std::vector<float> time_costs;
+  MultiSourceShortestPaths(graph, sources, /*horizon=*/300, &time_costs);
+
+  for (unsigned k = 0; k < sources.size(); ++k) {
+    std::vector<float> expected = testing::DijkstraTimeCosts(graph, sources[k]);
+    for (unsigned v = 0; v < graph.VertexCount(); ++v) {
+      if (expected[v] <= 300) {
+        BOOST_CHECK_CLOSE(expected[v], time_costs[v * 2 + k], 1e-3f);
+      } else {
+        BOOST_CHECK_EQUAL(kUnreachedTimeCost, time_costs[v * 2 + k]);
+      }
+    }
+  }
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,162 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/path/quantized.hpp"
+#include "procedural/probing/path/graph.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+// Counts the quanta in double, which represents every 32-bit tick exactly.
+double RoundedTicks(float time_cost) {
+  assert(time_cost >= 0);
+  return std::round(static_cast<double>(time_cost) / kTimeCostQuantumSeconds);
+}
+
+} // namespace
+
+template <typename Tick>
+unsigned QuantizedPathGraph<Tick>::VertexCount() const {
+  return first_arcs.empty() ? 0 : first_arcs.size() - 1;
+}
+
+template <typename Tick> unsigned QuantizedPathGraph<Tick>::ArcCount() const {
+  return heads.size();
+}
+
+template <typename Tick> Tick QuantizeTimeCost(float time_cost) {
+  double ticks = RoundedTicks(time_cost);
+  assert(ticks < kUnreachedTicks<Tick>);
+  return static_cast<Tick>(ticks);
+}
+
+template <typename Tick> Tick QuantizeArcCost(float arc_cost) {
+  double max_ticks = kUnreachedTicks<Tick> - 1;
+  return static_cast<Tick>(std::min(RoundedTicks(arc_cost), max_ticks));
+}
+
+template <typename Tick>
+QuantizedPathGraph<Tick> QuantizePathGraph(PathGraph const &graph) {
+  QuantizedPathGraph<Tick> quantized{
+      .first_arcs = graph.first_arcs,
+      .heads = graph.heads,
+      .costs = std::vector<Tick>(graph.ArcCount()),
+  };
+  for (unsigned arc = 0; arc < graph.ArcCount(); ++arc) {
+    quantized.costs[arc] = QuantizeArcCost<Tick>(graph.costs[arc]);
+  }
+  return quantized;
+}
+
+template <typename Tick>
+void BucketQueueShortestPaths(QuantizedPathGraph<Tick> const &graph,
+                              unsigned source, Tick horizon,
+                              std::vector<Tick> *ticks) {
+  assert(source < graph.VertexCount());
+  assert(horizon < kUnreachedTicks<Tick>);
+
+  ticks->assign(graph.VertexCount(), kUnreachedTicks<Tick>);
+  Tick *t = ticks->data();
+
+  // The queued time costs lie within the longest useful arc of the one being
+  // settled, so each bucket of the ring is reused once the search has gone
+  // round. The arcs beyond the horizon are never relaxed.
+  Tick longest_arc = 0;
+  for (Tick cost : graph.costs) {
+    longest_arc = std::max(longest_arc, std::min(cost, horizon));
+  }
+  std::vector<std::vector<unsigned>> buckets(longest_arc + 1);
+
+  t[source] = 0;
+  buckets[0].push_back(source);
+  unsigned queued = 1;
+  for (unsigned d = 0; queued > 0 && d <= horizon; ++d) {
+    std::vector<unsigned> &bucket = buckets[d % buckets.size()];
+
+    // Zero cost arcs append to the bucket being scanned, so its size is read
+    // on every iteration.
+    for (unsigned i = 0; i < bucket.size(); ++i) {
+      unsigned u = bucket[i];
+      if (t[u] != d) {
+        // It was lowered into an earlier bucket after being queued here.
+        continue;
+      }
+      for (unsigned arc = graph.first_arcs[u]; arc < graph.first_arcs[u + 1];
+           ++arc) {
+        unsigned v = graph.heads[arc];
+        // Summed in 64 bits, as a 32-bit tick could wrap around.
+        std::uint64_t candidate =
+            static_cast<std::uint64_t>(d) + graph.costs[arc];
+        if (candidate <= horizon && candidate < t[v]) {
+          t[v] = static_cast<Tick>(candidate);
+          buckets[candidate % buckets.size()].push_back(v);
+          ++queued;
+        }
+      }
+    }
+
+    queued -= bucket.size();
+    bucket.clear();
+  }
+}
+
+template <typename Tick>
+void DequantizeTimeCosts(std::vector<Tick> const &ticks,
+                         std::vector<float> *time_costs) {
+  time_costs->resize(ticks.size());
+  for (unsigned v = 0; v < ticks.size(); ++v) {
+    (*time_costs)[v] = ticks[v] == kUnreachedTicks<Tick>
+                           ? kUnreachedTimeCost
+                           : ticks[v] * kTimeCostQuantumSeconds;
+  }
+}
+
+template struct QuantizedPathGraph<std::uint16_t>;
+template struct QuantizedPathGraph<std::uint32_t>;
+
+template std::uint16_t QuantizeTimeCost(float time_cost);
+template std::uint32_t QuantizeTimeCost(float time_cost);
+
+template std::uint16_t QuantizeArcCost(float arc_cost);
+template std::uint32_t QuantizeArcCost(float arc_cost);
+
+template QuantizedPathGraph<std::uint16_t>
+QuantizePathGraph(PathGraph const &graph);
+template QuantizedPathGraph<std::uint32_t>
+QuantizePathGraph(PathGraph const &graph);
+
+template void
+BucketQueueShortestPaths(QuantizedPathGraph<std::uint16_t> const &graph,
+                         unsigned source, std::uint16_t horizon,
+                         std::vector<std::uint16_t> *ticks);
+template void
+BucketQueueShortestPaths(QuantizedPathGraph<std::uint32_t> const &graph,
+                         unsigned source, std::uint32_t horizon,
+                         std::vector<std::uint32_t> *ticks);
+
+template void DequantizeTimeCosts(std::vector<std::uint16_t> const &ticks,
+                                  std::vector<float> *time_costs);
+template void DequantizeTimeCosts(std::vector<std::uint32_t> const &ticks,
+                                  std::vector<float> *time_costs);
+
+} // namespace procedural
+} // namespace e8
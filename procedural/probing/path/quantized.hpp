@@ -0,0 +1,102 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "procedural/probing/path/graph.hpp"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// The resolution of the quantized time costs. Anything finer has no meaning in
+// planning.
+constexpr float const kTimeCostQuantumSeconds = 0.1f;
+
+// Selects how the time costs are represented in the shortest path searches.
+enum class TimeCostPrecision {
+  // Seconds in float, searched with a binary heap.
+  kFloat,
+  // Deciseconds in 16-bit integers, searched with a bucket queue. Time costs
+  // up to 6553.4 seconds can be represented.
+  kDecisecond16,
+  // Deciseconds in 32-bit integers, searched with a bucket queue.
+  kDecisecond32,
+};
+
+// The precision used when the caller doesn't pick one. Defining
+// E8_QUANTIZED_TIME_COSTS at build time makes the searches quantized by
+// default.
+#ifdef E8_QUANTIZED_TIME_COSTS
+constexpr TimeCostPrecision const kDefaultTimeCostPrecision =
+    TimeCostPrecision::kDecisecond16;
+#else
+constexpr TimeCostPrecision const kDefaultTimeCostPrecision =
+    TimeCostPrecision::kFloat;
+#endif
+
+// The quantized time cost of the vertices which aren't reached.
+template <typename Tick>
+constexpr Tick const kUnreachedTicks = std::numeric_limits<Tick>::max();
+
+// Same as PathGraph, but the arc costs are counted in quanta. Tick is either
+// std::uint16_t or std::uint32_t.
+template <typename Tick> struct QuantizedPathGraph {
+  unsigned VertexCount() const;
+  unsigned ArcCount() const;
+
+  // The arcs leaving vertex v are first_arcs[v] to first_arcs[v + 1] - 1.
+  std::vector<unsigned> first_arcs;
+
+  // The head and the quantized time cost of each arc.
+  std::vector<unsigned> heads;
+  std::vector<Tick> costs;
+};
+
+// Rounds the time cost to the nearest quantum. The result must stay below
+// kUnreachedTicks<Tick>.
+template <typename Tick> Tick QuantizeTimeCost(float time_cost);
+
+// Rounds an arc cost to the nearest quantum. The costs which can't be
+// represented are capped a quantum below kUnreachedTicks<Tick>, as no horizon
+// reaches past them.
+template <typename Tick> Tick QuantizeArcCost(float arc_cost);
+
+// Rounds every arc cost of the graph by QuantizeArcCost(), so the quantized
+// cost of a path is off by at most half a quantum per arc.
+template <typename Tick>
+QuantizedPathGraph<Tick> QuantizePathGraph(PathGraph const &graph);
+
+// Computes the quantized time cost of the shortest paths from the source to
+// every vertex within the horizon, with Dial's algorithm. The others are left
+// at kUnreachedTicks<Tick>. The queue is a ring of buckets, one for each
+// quantum up to the longest arc, so pushing and popping a vertex take
+// constant time rather than the logarithmic time of a binary heap.
+template <typename Tick>
+void BucketQueueShortestPaths(QuantizedPathGraph<Tick> const &graph,
+                              unsigned source, Tick horizon,
+                              std::vector<Tick> *ticks);
+
+// Converts the quantized time costs back into seconds, where
+// kUnreachedTicks<Tick> becomes kUnreachedTimeCost.
+template <typename Tick>
+void DequantizeTimeCosts(std::vector<Tick> const &ticks,
+                         std::vector<float> *time_costs);
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,112 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/path/graph.hpp"
+#include "procedural/probing/path/quantized.hpp"
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+float const kMinArcCost = 1;
+
+// A grid with random arc costs in both directions. The costs are rounded to
+// whole quanta when specified.
+PathGraph CreateRandomGrid(unsigned side, bool whole_quanta) {
+  std::default_random_engine random_engine(7);
+  std::uniform_real_distribution<float> cost_distribution(kMinArcCost, 100);
+  return testing::CreateGridPathGraph(
+      side, [&random_engine, &cost_distribution, whole_quanta]() {
+        float cost = cost_distribution(random_engine);
+        return whole_quanta ? std::round(cost / kTimeCostQuantumSeconds) *
+                                  kTimeCostQuantumSeconds
+                            : cost;
+      });
+}
+
+template <typename Tick>
+std::vector<float> BucketQueueTimeCosts(PathGraph const &graph,
+                                        unsigned source, float horizon) {
+  QuantizedPathGraph<Tick> quantized = QuantizePathGraph<Tick>(graph);
+  std::vector<Tick> ticks;
+  BucketQueueShortestPaths(quantized, source,
+                           QuantizeTimeCost<Tick>(horizon), &ticks);
+
+  std::vector<float> time_costs;
+  DequantizeTimeCosts(ticks, &time_costs);
+  return time_costs;
+}
+
+BOOST_AUTO_TEST_CASE(WhenCostsAreWholeQuanta_ThenCheckTimeCostsMatchDijkstra) {
+  PathGraph graph = CreateRandomGrid(/*side=*/20, /*whole_quanta=*/true);
+
+  for (unsigned source : {0, 7, 210, 399}) {
+    std::vector<float> expected = testing::DijkstraTimeCosts(graph, source);
+    std::vector<float> time_costs_16 = BucketQueueTimeCosts<std::uint16_t>(
+        graph, source, /*horizon=*/6000);
+    std::vector<float> time_costs_32 = BucketQueueTimeCosts<std::uint32_t>(
+        graph, source, /*horizon=*/1e6f);
+    for (unsigned v = 0; v < graph.VertexCount(); ++v) {
+      BOOST_CHECK_CLOSE(expected[v], time_costs_16[v], 1e-3f);
+      BOOST_CHECK_CLOSE(expected[v], time_costs_32[v], 1e-3f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenCostsAreArbitrary_ThenCheckErrorIsBounded) {
+  PathGraph graph = CreateRandomGrid(/*side=*/20, /*whole_quanta=*/false);
+
+  for (unsigned source : {0, 7, 210, 399}) {
+    std::vector<float> expected = testing::DijkstraTimeCosts(graph, source);
+    std::vector<float> time_costs = BucketQueueTimeCosts<std::uint16_t>(
+        graph, source, /*horizon=*/6000);
+    for (unsigned v = 0; v < graph.VertexCount(); ++v) {
+      // Either shortest path is off by at most half a quantum per arc, and
+      // neither has more arcs than its cost over the cheapest arc.
+      float arc_count = std::max(expected[v], time_costs[v]) / kMinArcCost;
+      BOOST_CHECK_LE(std::abs(expected[v] - time_costs[v]),
+                     0.5f * kTimeCostQuantumSeconds * arc_count + 1e-3f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenHorizonIsShort_ThenCheckFarVerticesAreUnreached) {
+  PathGraph graph = CreateRandomGrid(/*side=*/20, /*whole_quanta=*/true);
+
+  std::vector<float> expected =
+      testing::DijkstraTimeCosts(graph, /*source=*/210);
+  std::vector<float> time_costs =
+      BucketQueueTimeCosts<std::uint16_t>(graph, /*source=*/210,
+                                          /*horizon=*/300);
+  for (unsigned v = 0; v < graph.VertexCount(); ++v) {
+    if (expected[v] <= 299.9f) {
+      BOOST_CHECK_CLOSE(expected[v], time_costs[v], 1e-3f);
+    } else if (expected[v] >= 300.1f) {
+      BOOST_CHECK_EQUAL(kUnreachedTimeCost, time_costs[v]);
+    }
+  }
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,127 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/probe/ordering.hpp"
+#include "procedural/probing/probe/probe.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <eigen3/Eigen/Core>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+unsigned const kHilbertCurveOrder = 16;
+float const kMaxGridCoordinate = (1 << kHilbertCurveOrder) - 1;
+
+std::vector<uint32_t>
+HilbertCurveIndices(std::vector<PopulationProbe> const &probes) {
+  Eigen::Vector2f min = probes[0].location.head<2>();
+  Eigen::Vector2f max = min;
+  for (auto const &probe : probes) {
+    min = min.cwiseMin(probe.location.head<2>());
+    max = max.cwiseMax(probe.location.head<2>());
+  }
+
+  // Uses the same scale on both axes to preserve the proximity.
+  float extent = std::max((max - min).maxCoeff(), 1e-3f);
+  float scale = kMaxGridCoordinate / extent;
+
+  std::vector<uint32_t> indices(probes.size());
+  std::transform(
+      probes.begin(), probes.end(), indices.begin(),
+      [&min, scale](PopulationProbe const &probe) {
+        Eigen::Vector2f grid = ((probe.location.head<2>() - min) * scale)
+                                   .cwiseMax(0.f)
+                                   .cwiseMin(kMaxGridCoordinate);
+        return HilbertCurveIndex(static_cast<uint16_t>(grid.x()),
+                                 static_cast<uint16_t>(grid.y()));
+      });
+  return indices;
+}
+
+} // namespace
+
+uint32_t HilbertCurveIndex(uint16_t x, uint16_t y) {
+  uint32_t rx, ry;
+  uint32_t d = 0;
+  uint32_t cx = x;
+  uint32_t cy = y;
+  for (uint32_t s = 1U << (kHilbertCurveOrder - 1); s > 0; s /= 2) {
+    rx = (cx & s) > 0;
+    ry = (cy & s) > 0;
+    d += s * s * ((3 * rx) ^ ry);
+
+    // Rotates the quadrant so the sub-curve keeps the canonical orientation.
+    if (ry == 0) {
+      if (rx == 1) {
+        cx = s - 1 - (cx & (s - 1));
+        cy = s - 1 - (cy & (s - 1));
+      }
+      std::swap(cx, cy);
+    }
+  }
+  return d;
+}
+
+ProbeOrdering HilbertCurveOrdering(std::vector<PopulationProbe> const &probes) {
+  if (probes.empty()) {
+    return IdentityOrdering(0);
+  }
+
+  std::vector<uint32_t> curve_indices = HilbertCurveIndices(probes);
+
+  ProbeOrdering ordering = IdentityOrdering(probes.size());
+  std::stable_sort(ordering.to_original.begin(), ordering.to_original.end(),
+                   [&curve_indices](unsigned a, unsigned b) {
+                     return curve_indices[a] < curve_indices[b];
+                   });
+  for (unsigned i = 0; i < ordering.to_original.size(); ++i) {
+    ordering.to_reordered[ordering.to_original[i]] = i;
+  }
+  return ordering;
+}
+
+ProbeOrdering IdentityOrdering(unsigned probe_count) {
+  ProbeOrdering ordering;
+  ordering.to_original.resize(probe_count);
+  ordering.to_reordered.resize(probe_count);
+  for (unsigned i = 0; i < probe_count; ++i) {
+    ordering.to_original[i] = i;
+    ordering.to_reordered[i] = i;
+  }
+  return ordering;
+}
+
+std::vector<PopulationProbe>
+ReorderProbes(std::vector<PopulationProbe> const &probes,
+              ProbeOrdering const &ordering) {
+  assert(ordering.to_original.size() == probes.size());
+
+  std::vector<PopulationProbe> result;
+  result.reserve(probes.size());
+  for (unsigned original_index : ordering.to_original) {
+    result.push_back(probes[original_index]);
+  }
+  return result;
+}
+
+} // namespace procedural
+} // namespace e8
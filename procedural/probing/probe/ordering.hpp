@@ -0,0 +1,54 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "procedural/probing/probe/probe.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// A permutation of the probe array. Probes which are close in space are
+// expected to be close in the reordered array, so the graph structures built
+// upon the reordered probes have their neighbors close in memory.
+struct ProbeOrdering {
+  // Maps a reordered index to the index in the caller's probe array.
+  std::vector<unsigned> to_original;
+
+  // Maps an index in the caller's probe array to the reordered index.
+  std::vector<unsigned> to_reordered;
+};
+
+// Computes the position of (x, y) along a Hilbert curve filling the
+// 2^16*2^16 grid.
+uint32_t HilbertCurveIndex(uint16_t x, uint16_t y);
+
+// Orders the probes by their position along a Hilbert curve spanning the
+// bounding box of the probes. Ties are broken by the original index.
+ProbeOrdering HilbertCurveOrdering(std::vector<PopulationProbe> const &probes);
+
+// Leaves the probes in the caller's order.
+ProbeOrdering IdentityOrdering(unsigned probe_count);
+
+// Permutes the probes into the specified order.
+std::vector<PopulationProbe>
+ReorderProbes(std::vector<PopulationProbe> const &probes,
+              ProbeOrdering const &ordering);
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,101 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/probe/ordering.hpp"
+#include "procedural/probing/probe/probe.hpp"
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <eigen3/Eigen/Core>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+float MeanStepDistance(std::vector<PopulationProbe> const &probes) {
+  float sum = 0;
+  for (unsigned i = 1; i < probes.size(); ++i) {
+    sum += (probes[i].location - probes[i - 1].location).norm();
+  }
+  return sum / (probes.size() - 1);
+}
+
+BOOST_AUTO_TEST_CASE(WhenWalkHilbertCurve_ThenCheckStepsAreGridNeighbors) {
+  // Any aligned 2^k*2^k block at the origin is covered by the first 4^k
+  // positions of the curve.
+  unsigned const side = 8;
+  std::vector<Eigen::Vector2i> cells(side * side, Eigen::Vector2i(-1, -1));
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      uint32_t d = HilbertCurveIndex(x, y);
+      BOOST_REQUIRE_LT(d, cells.size());
+      BOOST_CHECK_EQUAL(-1, cells[d].x());
+      cells[d] = Eigen::Vector2i(x, y);
+    }
+  }
+
+  for (unsigned d = 1; d < cells.size(); ++d) {
+    Eigen::Vector2i step = cells[d] - cells[d - 1];
+    BOOST_CHECK_EQUAL(1, std::abs(step.x()) + std::abs(step.y()));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenOrderProbes_ThenCheckPermutationsAreInverse) {
+  std::vector<PopulationProbe> probes;
+  for (unsigned y = 0; y < 10; ++y) {
+    for (unsigned x = 0; x < 10; ++x) {
+      // Scrambles the caller's order.
+      unsigned i = (x * 7 + y * 3) % 10;
+      probes.push_back(PopulationProbe(
+          Eigen::Vector3f(i * 200.f, y * 200.f, 0), /*population_grid_200=*/1));
+    }
+  }
+
+  ProbeOrdering ordering = HilbertCurveOrdering(probes);
+
+  BOOST_REQUIRE_EQUAL(probes.size(), ordering.to_original.size());
+  BOOST_REQUIRE_EQUAL(probes.size(), ordering.to_reordered.size());
+  for (unsigned i = 0; i < probes.size(); ++i) {
+    BOOST_CHECK_EQUAL(i, ordering.to_original[ordering.to_reordered[i]]);
+    BOOST_CHECK_EQUAL(i, ordering.to_reordered[ordering.to_original[i]]);
+  }
+
+  // Consecutive probes along the curve stay close, unlike in the scrambled
+  // order.
+  std::vector<PopulationProbe> reordered = ReorderProbes(probes, ordering);
+  BOOST_CHECK_LT(MeanStepDistance(reordered), 250.f);
+  BOOST_CHECK_GT(MeanStepDistance(probes), 500.f);
+}
+
+BOOST_AUTO_TEST_CASE(WhenOrderIdentity_ThenCheckProbesAreUnchanged) {
+  std::vector<PopulationProbe> probes{
+      PopulationProbe(Eigen::Vector3f(300, 0, 0), /*population_grid_200=*/1),
+      PopulationProbe(Eigen::Vector3f(0, 0, 0), /*population_grid_200=*/2),
+  };
+
+  std::vector<PopulationProbe> reordered =
+      ReorderProbes(probes, IdentityOrdering(probes.size()));
+
+  BOOST_REQUIRE_EQUAL(2, reordered.size());
+  BOOST_CHECK_EQUAL(1, reordered[0].population_grid_200);
+  BOOST_CHECK_EQUAL(2, reordered[1].population_grid_200);
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
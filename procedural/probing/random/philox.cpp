@@ -0,0 +1,92 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "procedural/probing/random/philox.hpp"
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+constexpr std::uint32_t const kMultiplier0 = 0xD2511F53;
+constexpr std::uint32_t const kMultiplier1 = 0xCD9E8D57;
+constexpr std::uint32_t const kWeyl0 = 0x9E3779B9;
+constexpr std::uint32_t const kWeyl1 = 0xBB67AE85;
+constexpr unsigned const kRoundCount = 10;
+
+void MultiplyHighLow(std::uint32_t a, std::uint32_t b, std::uint32_t *high,
+                     std::uint32_t *low) {
+  std::uint64_t product = static_cast<std::uint64_t>(a) * b;
+  *high = product >> 32;
+  *low = static_cast<std::uint32_t>(product);
+}
+
+} // namespace
+
+PhiloxBlock Philox4x32(std::uint64_t seed, std::uint64_t stream,
+                       std::uint64_t counter) {
+  PhiloxBlock x = {
+      static_cast<std::uint32_t>(counter),
+      static_cast<std::uint32_t>(counter >> 32),
+      static_cast<std::uint32_t>(stream),
+      static_cast<std::uint32_t>(stream >> 32),
+  };
+  std::uint32_t key0 = static_cast<std::uint32_t>(seed);
+  std::uint32_t key1 = static_cast<std::uint32_t>(seed >> 32);
+
+  for (unsigned round = 0; round < kRoundCount; ++round) {
+    std::uint32_t high0, low0, high1, low1;
+    MultiplyHighLow(kMultiplier0, x[0], &high0, &low0);
+    MultiplyHighLow(kMultiplier1, x[2], &high1, &low1);
+    x = {high1 ^ x[1] ^ key0, low1, high0 ^ x[3] ^ key1, low0};
+    key0 += kWeyl0;
+    key1 += kWeyl1;
+  }
+  return x;
+}
+
+PhiloxEngine::PhiloxEngine(std::uint64_t seed, std::uint64_t stream)
+    : PhiloxEngine(seed, stream, /*counter=*/0) {}
+
+PhiloxEngine::PhiloxEngine(std::uint64_t seed, std::uint64_t stream,
+                           std::uint64_t counter)
+    : seed_(seed), stream_(stream), counter_(counter), position_(4) {}
+
+PhiloxEngine::result_type PhiloxEngine::operator()() {
+  if (position_ == block_.size()) {
+    block_ = Philox4x32(seed_, stream_, counter_++);
+    position_ = 0;
+  }
+  return block_[position_++];
+}
+
+PhiloxEngine PhiloxEngine::Fork(std::uint64_t stream) const {
+  return PhiloxEngine(seed_, stream);
+}
+
+PhiloxEngine PhiloxEngine::Substream(std::uint32_t index) const {
+  // The stream draws its own blocks from the first span, and a substream
+  // doesn't own any span to split.
+  assert(counter_ >> 32 == 0);
+  assert(index < std::numeric_limits<std::uint32_t>::max());
+  std::uint64_t span = static_cast<std::uint64_t>(index) + 1;
+  return PhiloxEngine(seed_, stream_, /*counter=*/span << 32);
+}
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,76 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace e8 {
+namespace procedural {
+
+// A block of outputs of the Philox4x32-10 generator.
+using PhiloxBlock = std::array<std::uint32_t, 4>;
+
+// Computes the block at the counter of a stream. Every block is a pure
+// function of (seed, stream, counter), so the streams derived for different
+// workers, replicas or iterations are independent of each other, and of the
+// order in which they are drawn.
+PhiloxBlock Philox4x32(std::uint64_t seed, std::uint64_t stream,
+                       std::uint64_t counter);
+
+// Draws the blocks of a stream in the order of their counters, see
+// Philox4x32(). It's a counter based generator after Salmon et al., "Parallel
+// Random Numbers: As Easy as 1, 2, 3", which meets the requirements of
+// UniformRandomBitGenerator, so it plugs into the <random> distributions.
+class PhiloxEngine {
+public:
+  using result_type = std::uint32_t;
+
+  explicit PhiloxEngine(std::uint64_t seed = 0, std::uint64_t stream = 0);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()();
+
+  // Starts another stream of the same seed, e.g. for a stage.
+  PhiloxEngine Fork(std::uint64_t stream) const;
+
+  // Starts the index-th substream of this stream, e.g. for an iteration or a
+  // task, so that what the unit of work draws only depends on its index. A
+  // substream spans 2^32 blocks of the counters from (index + 1) * 2^32, and
+  // the stream keeps the first span to itself, so a stream may be split
+  // before or after it draws. Only a stream from the constructor or Fork()
+  // may be split: a substream can't be split again, since its substreams
+  // would alias the ones of its parent.
+  PhiloxEngine Substream(std::uint32_t index) const;
+
+private:
+  PhiloxEngine(std::uint64_t seed, std::uint64_t stream, std::uint64_t counter);
+
+  std::uint64_t seed_;
+  std::uint64_t stream_;
+  std::uint64_t counter_;
+  PhiloxBlock block_;
+  unsigned position_;
+};
+
+} // namespace procedural
+} // namespace e8
@@ -0,0 +1,156 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/random/philox.hpp"
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+std::vector<std::uint32_t> Draw(PhiloxEngine *engine, unsigned count) {
+  std::vector<std::uint32_t> values(count);
+  for (auto &value : values) {
+    value = (*engine)();
+  }
+  return values;
+}
+
+BOOST_AUTO_TEST_CASE(WhenComputeBlocks_ThenCheckKnownAnswers) {
+  // The known answers of Philox4x32-10 from Random123. The counter is
+  // (counter, stream) and the key is the seed, each split into 32-bit words
+  // with the low word first.
+  PhiloxBlock zeros = Philox4x32(/*seed=*/0, /*stream=*/0, /*counter=*/0);
+  BOOST_CHECK_EQUAL(0x6627e8d5u, zeros[0]);
+  BOOST_CHECK_EQUAL(0xe169c58du, zeros[1]);
+  BOOST_CHECK_EQUAL(0xbc57ac4cu, zeros[2]);
+  BOOST_CHECK_EQUAL(0x9b00dbd8u, zeros[3]);
+
+  PhiloxBlock ones = Philox4x32(/*seed=*/~0ull, /*stream=*/~0ull,
+                                /*counter=*/~0ull);
+  BOOST_CHECK_EQUAL(0x408f276du, ones[0]);
+  BOOST_CHECK_EQUAL(0x41c83b0eu, ones[1]);
+  BOOST_CHECK_EQUAL(0xa20bc7c6u, ones[2]);
+  BOOST_CHECK_EQUAL(0x6d5451fdu, ones[3]);
+
+  PhiloxBlock pi = Philox4x32(/*seed=*/0x299f31d0a4093822ull,
+                              /*stream=*/0x0370734413198a2eull,
+                              /*counter=*/0x85a308d3243f6a88ull);
+  BOOST_CHECK_EQUAL(0xd16cfe09u, pi[0]);
+  BOOST_CHECK_EQUAL(0x94fdccebu, pi[1]);
+  BOOST_CHECK_EQUAL(0x5001e420u, pi[2]);
+  BOOST_CHECK_EQUAL(0x24126ea1u, pi[3]);
+}
+
+BOOST_AUTO_TEST_CASE(WhenDrawStream_ThenCheckItFollowsTheCounters) {
+  PhiloxEngine engine(/*seed=*/42, /*stream=*/7);
+  std::vector<std::uint32_t> values = Draw(&engine, /*count=*/12);
+
+  for (unsigned counter = 0; counter < 3; ++counter) {
+    PhiloxBlock block = Philox4x32(/*seed=*/42, /*stream=*/7, counter);
+    for (unsigned i = 0; i < block.size(); ++i) {
+      BOOST_CHECK_EQUAL(block[i], values[4 * counter + i]);
+    }
+  }
+
+  PhiloxEngine replay(/*seed=*/42, /*stream=*/7);
+  BOOST_CHECK(values == Draw(&replay, /*count=*/12));
+}
+
+BOOST_AUTO_TEST_CASE(WhenForkStreams_ThenCheckTheyDiffer) {
+  PhiloxEngine engine(/*seed=*/42, /*stream=*/0);
+  Draw(&engine, /*count=*/5);
+
+  // A fork starts its stream from the beginning, regardless of how far the
+  // parent has gone.
+  PhiloxEngine fork = engine.Fork(/*stream=*/1);
+  PhiloxEngine fresh(/*seed=*/42, /*stream=*/1);
+  BOOST_CHECK(Draw(&fresh, /*count=*/8) == Draw(&fork, /*count=*/8));
+
+  std::set<std::vector<std::uint32_t>> streams;
+  for (unsigned stream = 0; stream < 16; ++stream) {
+    PhiloxEngine forked = engine.Fork(stream);
+    streams.insert(Draw(&forked, /*count=*/8));
+  }
+  PhiloxEngine reseeded(/*seed=*/43, /*stream=*/0);
+  streams.insert(Draw(&reseeded, /*count=*/8));
+  BOOST_CHECK_EQUAL(17, streams.size());
+}
+
+BOOST_AUTO_TEST_CASE(WhenDrawSubstreams_ThenCheckTheyFollowTheirCounters) {
+  PhiloxEngine engine(/*seed=*/42, /*stream=*/7);
+  Draw(&engine, /*count=*/5);
+
+  // A substream only depends on its index, whichever is drawn first.
+  PhiloxEngine third = engine.Substream(/*index=*/3);
+  PhiloxEngine second = engine.Substream(/*index=*/2);
+  std::vector<std::uint32_t> third_values = Draw(&third, /*count=*/8);
+  std::vector<std::uint32_t> second_values = Draw(&second, /*count=*/8);
+
+  PhiloxBlock block = Philox4x32(/*seed=*/42, /*stream=*/7,
+                                 /*counter=*/std::uint64_t{4} << 32);
+  for (unsigned i = 0; i < block.size(); ++i) {
+    BOOST_CHECK_EQUAL(block[i], third_values[i]);
+  }
+  PhiloxEngine replay = PhiloxEngine(/*seed=*/42, /*stream=*/7).Substream(2);
+  BOOST_CHECK(second_values == Draw(&replay, /*count=*/8));
+  BOOST_CHECK(second_values != third_values);
+}
+
+BOOST_AUTO_TEST_CASE(WhenDrawStreamAndFirstSubstream_ThenCheckTheyDiffer) {
+  PhiloxEngine engine(/*seed=*/42, /*stream=*/7);
+  PhiloxEngine first = engine.Substream(/*index=*/0);
+
+  // The stream keeps its own span, so it doesn't replay its substreams.
+  std::vector<std::uint32_t> stream_values = Draw(&engine, /*count=*/8);
+  std::vector<std::uint32_t> first_values = Draw(&first, /*count=*/8);
+  BOOST_CHECK(stream_values != first_values);
+
+  PhiloxEngine drawn = PhiloxEngine(/*seed=*/42, /*stream=*/7);
+  Draw(&drawn, /*count=*/8);
+  PhiloxEngine replay = drawn.Substream(/*index=*/0);
+  BOOST_CHECK(first_values == Draw(&replay, /*count=*/8));
+}
+
+BOOST_AUTO_TEST_CASE(WhenSampleDistributions_ThenCheckTheMeans) {
+  PhiloxEngine engine(/*seed=*/1);
+  std::uniform_real_distribution<float> real(0.0f, 1.0f);
+  std::uniform_int_distribution<unsigned> integer(0, 9);
+
+  unsigned const count = 100000;
+  double real_sum = 0;
+  double integer_sum = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    float x = real(engine);
+    BOOST_REQUIRE(x >= 0.0f && x < 1.0f);
+    real_sum += x;
+
+    unsigned k = integer(engine);
+    BOOST_REQUIRE_LE(k, 9);
+    integer_sum += k;
+  }
+  BOOST_CHECK_CLOSE(0.5, real_sum / count, /*percent=*/1);
+  BOOST_CHECK_CLOSE(4.5, integer_sum / count, /*percent=*/1);
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
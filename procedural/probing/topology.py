@@ -68,7 +68,11 @@ def _ToProbeTopology(
 def ComputePopulationProbeTopology(
         probes: List[PopulationProbe],
         regularity_optimization_steps: int = 20000000,
-        efficiency_optimization_steps: int = 0) -> ProbeTopology:
+        efficiency_optimization_steps: int = 0,
+        lattice_grid_size: float = 0,
+        reorder_probes: bool = False,
+        efficiency_speculation_count: int = 1,
+        delaunay_tile_size: float = 0) -> ProbeTopology:
     """It computes the connections amongst the specified population probes
         such that the transportation between any two probes is reasonably
         efficient.
@@ -81,6 +85,25 @@ def ComputePopulationProbeTopology(
         efficiency_optimization_steps (int, optional): The number of
             optimization steps to take to optimize the transportation
             efficiency. Defaults to 0.
+        lattice_grid_size (float, optional): When positive, the probes are
+            assumed to be snapped to a square lattice of this size (e.g. the
+            200m probe grid), and the initial connections are built from the
+            lattice neighbors instead of a Delaunay triangulation. Defaults to
+            0.
+        reorder_probes (bool, optional): Whether to internally permute the
+            probes along a Hilbert curve for memory locality. The connections
+            still refer to the order of the specified probes. Defaults to
+            False.
+        efficiency_speculation_count (int, optional): The number of
+            mutations evaluated concurrently by every efficiency optimization
+            step, of which the best one is kept. Defaults to 1.
+        delaunay_tile_size (float, optional): When positive, the Delaunay
+            triangulation is approximated by triangulating square tiles of
+            this size in meters one batch at a time, which bounds its memory
+            on large regions. Connections longer than the 2km tile margin
+            which cross a tile border may be replaced by other bridges
+            between the probes, but the topology stays connected. Defaults
+            to 0.
 
     Returns:
         ProbeTopology: See the above data class.
@@ -89,7 +112,11 @@ def ComputePopulationProbeTopology(
     internal_result = e8citydll.ComputeProbeTopology(
         internal_probes,
         regularity_optimization_steps,
-        efficiency_optimization_steps)
+        efficiency_optimization_steps,
+        lattice_grid_size,
+        reorder_probes,
+        efficiency_speculation_count,
+        delaunay_tile_size)
     return _ToProbeTopology(internal_result)
 
 
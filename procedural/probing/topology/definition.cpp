@@ -20,6 +20,24 @@
 
 namespace e8 {
 namespace procedural {
+
+VertexStore CreateVertexStoreFor(Topology const &topology) {
+  unsigned vertex_count = boost::num_vertices(topology);
+
+  VertexStore store;
+  store.x.resize(vertex_count);
+  store.y.resize(vertex_count);
+  store.local_population.resize(vertex_count);
+  store.importance.resize(vertex_count);
+  for (unsigned i = 0; i < vertex_count; ++i) {
+    store.x[i] = topology[i].location.x();
+    store.y[i] = topology[i].location.y();
+    store.local_population[i] = topology[i].local_population;
+    store.importance[i] = topology[i].importance;
+  }
+  return store;
+}
+
 namespace testing {
 
 Topology CreateGridTopology(unsigned side, float scale, float population) {
@@ -19,6 +19,7 @@
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/property_map/property_map.hpp>
 #include <eigen3/Eigen/Core>
+#include <vector>
 
 namespace e8 {
 namespace procedural {
@@ -45,6 +46,19 @@ struct VertexProperties {
   float importance;
 };
 
+// A struct-of-arrays copy of the vertex properties of a topology, indexed by
+// vertex. The hot loops of the objectives scan one or two properties over all
+// the vertices, so each property is kept contiguous. The vertices are assumed
+// to lie on the ground plane, so only the planar location is kept.
+struct VertexStore {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> local_population;
+  std::vector<float> importance;
+
+  unsigned size() const { return x.size(); }
+};
+
 // For storing the part of edge cost which is invariant to topological change.
 using StaticEdgeCost = boost::property<boost::edge_weight_t, float>;
 
@@ -54,6 +68,11 @@ using Topology = boost::adjacency_list<
     /*DirectedS=*/boost::undirectedS, /*VertexProperty=*/VertexProperties,
     /*EdgeProperty=*/StaticEdgeCost>;
 
+// Copies the vertex properties of the topology into a vertex store. The vertex
+// properties stay unchanged throughout the optimization, so the store can be
+// created once and shared.
+VertexStore CreateVertexStoreFor(Topology const &topology);
+
 namespace testing {
 
 // Grid with the structure:
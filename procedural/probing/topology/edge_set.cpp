@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/topology/edge_set.hpp"
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include <algorithm>
 #include <cassert>
@@ -52,7 +53,7 @@ void DeleteEdge(unsigned edge_to_delete, std::vector<Edge> *edges,
 
 bool ChooseAddEdgeOperation(std::vector<Edge> const &edges, unsigned separator,
                             float prob_add,
-                            std::default_random_engine *random_engine) {
+                            PhiloxEngine *random_engine) {
   if (separator == edges.size()) {
     // There is no deleted edge to add. At this state, only delete-edge
     // operation is possible.
@@ -70,14 +71,14 @@ bool ChooseAddEdgeOperation(std::vector<Edge> const &edges, unsigned separator,
 }
 
 unsigned SampleActiveEdge(std::vector<Edge> const &edges, unsigned separator,
-                          std::default_random_engine *random_engine) {
+                          PhiloxEngine *random_engine) {
   assert(separator > 0 && separator <= edges.size());
   return std::uniform_int_distribution<unsigned>(0,
                                                  separator - 1)(*random_engine);
 }
 
 unsigned SampleDeletedEdge(std::vector<Edge> const &edges, unsigned separator,
-                           std::default_random_engine *random_engine) {
+                           PhiloxEngine *random_engine) {
   assert(separator < edges.size());
   return std::uniform_int_distribution<unsigned>(separator, edges.size() - 1)(
       *random_engine);
@@ -117,8 +118,10 @@ void Mutation::PushDeletion(Edge const &edge) {
   deletions.insert(edge);
 }
 
-EdgeSetState::EdgeSetState(std::default_random_engine *random_engine)
-    : separator_(0), random_engine_(random_engine) {}
+EdgeSetState::EdgeSetState() : separator_(0) {}
+
+EdgeSetState::EdgeSetState(std::vector<Edge> &&active_edges)
+    : edges_(std::move(active_edges)), separator_(edges_.size()) {}
 
 void EdgeSetState::Add(Edge const &edge) {
   edges_.push_back(edge);
@@ -126,20 +129,21 @@ void EdgeSetState::Add(Edge const &edge) {
   ++separator_;
 }
 
-Mutation EdgeSetState::Mutate(unsigned operation_count, float prob_add) {
+Mutation EdgeSetState::Mutate(unsigned operation_count,
+                              PhiloxEngine random_engine, float prob_add) {
   Mutation result(/*num_additions=*/operation_count,
                   /*num_deletions=*/operation_count);
 
   log_ = internal::MutationLog(operation_count, separator_);
   for (unsigned i = 0; i < operation_count; ++i) {
-    if (ChooseAddEdgeOperation(edges_, separator_, prob_add, random_engine_)) {
+    if (ChooseAddEdgeOperation(edges_, separator_, prob_add, &random_engine)) {
       unsigned edge_to_add =
-          SampleDeletedEdge(edges_, separator_, random_engine_);
+          SampleDeletedEdge(edges_, separator_, &random_engine);
       result.PushAddition(edges_[edge_to_add]);
       AddEdge(edge_to_add, &edges_, &separator_, &log_);
     } else {
       unsigned edge_to_delete =
-          SampleActiveEdge(edges_, separator_, random_engine_);
+          SampleActiveEdge(edges_, separator_, &random_engine);
       result.PushDeletion(edges_[edge_to_delete]);
       DeleteEdge(edge_to_delete, &edges_, &separator_, &log_);
     }
@@ -162,6 +166,28 @@ void EdgeSetState::Revert() {
   separator_ = log_.separator_before;
 }
 
+MutationProposal EdgeSetState::Propose(unsigned operation_count,
+                                       PhiloxEngine random_engine,
+                                       float prob_add) {
+  MutationProposal proposal{
+      .mutation = Mutate(operation_count, random_engine, prob_add),
+      .log = log_,
+      .separator_after = separator_,
+  };
+  Revert();
+  return proposal;
+}
+
+void EdgeSetState::Commit(MutationProposal const &proposal) {
+  assert(proposal.log.separator_before == separator_);
+
+  log_ = proposal.log;
+  for (auto const &[edge_index0, edge_index1] : log_.swaps) {
+    std::swap(edges_[edge_index0], edges_[edge_index1]);
+  }
+  separator_ = proposal.separator_after;
+}
+
 std::vector<Edge> EdgeSetState::ActiveEdges() const {
   std::vector<Edge> result(separator_);
   std::copy(edges_.begin(), edges_.begin() + separator_, result.begin());
@@ -174,14 +200,18 @@ std::vector<Edge> EdgeSetState::DeletedEdges() const {
   return result;
 }
 
-EdgeSetState CreateEdgeSetStateFor(Topology const &topology,
-                                   std::default_random_engine *random_engine) {
-  EdgeSetState edge_set(random_engine);
-  auto [current, end] = boost::edges(topology);
-  for (; current != end; ++current) {
-    edge_set.Add(Edge(current->m_source, current->m_target));
+std::vector<Edge> EdgesOf(Topology const &topology) {
+  std::vector<Edge> edges;
+  edges.reserve(boost::num_edges(topology));
+  for (auto [current, end] = boost::edges(topology); current != end;
+       ++current) {
+    edges.push_back(Edge(current->m_source, current->m_target));
   }
-  return edge_set;
+  return edges;
+}
+
+EdgeSetState CreateEdgeSetStateFor(Topology const &topology) {
+  return EdgeSetState(EdgesOf(topology));
 }
 
 } // namespace procedural
@@ -16,9 +16,9 @@
 
 #pragma once
 
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include <functional>
-#include <random>
 #include <tuple>
 #include <unordered_set>
 #include <utility>
@@ -74,11 +74,28 @@ struct Mutation {
   std::unordered_set<Edge, EdgeHash> deletions;
 };
 
+// A mutation made on the edge set without being applied, see
+// EdgeSetState::Propose().
+struct MutationProposal {
+  // The mutation to apply.
+  Mutation mutation;
+
+  // Replays the mutation onto the edge set.
+  internal::MutationLog log;
+  unsigned separator_after;
+};
+
 // Keeps track of the state of each edge in the edge set. The state of an edge
-// can either be active or deleted.
+// can either be active or deleted. The random operations draw from the stream
+// passed along with each mutation, e.g. a substream of the iteration, so a
+// mutation only depends on the edge states and its own stream.
 class EdgeSetState {
 public:
-  EdgeSetState(std::default_random_engine *random_engine);
+  EdgeSetState();
+
+  // Creates the state with all the specified edges being active. The client of
+  // this call must guarantee their uniqueness.
+  EdgeSetState(std::vector<Edge> &&active_edges);
   ~EdgeSetState() = default;
 
   // Adds an active edge to the set. The client of this call must guarantee
@@ -89,13 +106,24 @@ public:
   // either turn a deleted edge into an active one or vice versa. It's possible
   // that it eventually yields an empty mutation through the process. The
   // mutation is applied to the actual edge states.
-  Mutation Mutate(unsigned operation_count, float prob_add = 0.5f);
+  Mutation Mutate(unsigned operation_count, PhiloxEngine random_engine,
+                  float prob_add = 0.5f);
 
   // Reverts the application of the last mutation performed by
   // EdgeSetState::Mutate(). Note, it can't revert more than 1 mutation. Namely,
   // subsequent calls to this function does nothing.
   void Revert();
 
+  // Same as EdgeSetState::Mutate(), but the edge states are left unchanged, so
+  // the proposals made in a row are independent of each other. Like
+  // EdgeSetState::Revert(), it forgets about the last mutation.
+  MutationProposal Propose(unsigned operation_count,
+                           PhiloxEngine random_engine, float prob_add = 0.5f);
+
+  // Applies a proposal made on the current edge states. It can be reverted
+  // by EdgeSetState::Revert() afterwards.
+  void Commit(MutationProposal const &proposal);
+
   // For testing purposes.
   std::vector<Edge> ActiveEdges() const;
   std::vector<Edge> DeletedEdges() const;
@@ -104,13 +132,14 @@ private:
   std::vector<Edge> edges_;
   unsigned separator_;
   internal::MutationLog log_;
-  std::default_random_engine *const random_engine_;
 };
 
+// Lists the edges of the topology in the order of boost::edges().
+std::vector<Edge> EdgesOf(Topology const &topology);
+
 // Copies the edge set of the topology to the EdgeSetState object and sets the
 // state of the edges to active.
-EdgeSetState CreateEdgeSetStateFor(Topology const &topology,
-                                   std::default_random_engine *random_engine);
+EdgeSetState CreateEdgeSetStateFor(Topology const &topology);
 
 } // namespace procedural
 } // namespace e8
@@ -15,11 +15,11 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define BOOST_TEST_MAIN
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/edge_set.hpp"
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/test/unit_test.hpp>
-#include <random>
 #include <unordered_set>
 #include <vector>
 
@@ -52,8 +52,7 @@ bool ContainsAllEdges(std::vector<Edge> const &edges,
 BOOST_AUTO_TEST_CASE(WhenAtOriginalState_ThenCheckActiveAndDeletedEdges) {
   Topology topology = testing::CreateGridTopology(/*side=*/5, /*scale=*/1e3f,
                                                   /*population=*/4e3);
-  std::default_random_engine random_engine;
-  EdgeSetState edge_set_state = CreateEdgeSetStateFor(topology, &random_engine);
+  EdgeSetState edge_set_state = CreateEdgeSetStateFor(topology);
 
   std::vector<Edge> active_edges = edge_set_state.ActiveEdges();
   std::vector<Edge> deleted_edges = edge_set_state.DeletedEdges();
@@ -65,10 +64,10 @@ BOOST_AUTO_TEST_CASE(WhenAtOriginalState_ThenCheckActiveAndDeletedEdges) {
 BOOST_AUTO_TEST_CASE(WhenFollowsOneMutation_ThenCheckActiveAndDeletedEdges) {
   Topology topology = testing::CreateGridTopology(/*side=*/5, /*scale=*/1e3f,
                                                   /*population=*/4e3);
-  std::default_random_engine random_engine;
-  EdgeSetState edge_set_state = CreateEdgeSetStateFor(topology, &random_engine);
+  EdgeSetState edge_set_state = CreateEdgeSetStateFor(topology);
 
-  Mutation mutation = edge_set_state.Mutate(/*operation_count=*/1);
+  Mutation mutation =
+      edge_set_state.Mutate(/*operation_count=*/1, PhiloxEngine());
   BOOST_CHECK(mutation.additions.empty() && !mutation.deletions.empty());
 
   std::vector<Edge> active_edges = edge_set_state.ActiveEdges();
@@ -77,15 +76,63 @@ BOOST_AUTO_TEST_CASE(WhenFollowsOneMutation_ThenCheckActiveAndDeletedEdges) {
   BOOST_CHECK_EQUAL(deleted_edges.size(), 1);
 }
 
+BOOST_AUTO_TEST_CASE(WhenProposalIsCommitted_ThenCheckItMatchesMutation) {
+  Topology topology = testing::CreateGridTopology(/*side=*/5, /*scale=*/1e3f,
+                                                  /*population=*/4e3);
+  PhiloxEngine random_engine(7);
+  EdgeSetState proposing = CreateEdgeSetStateFor(topology);
+  EdgeSetState mutating = CreateEdgeSetStateFor(topology);
+
+  for (unsigned i = 0; i < 50; ++i) {
+    std::vector<Edge> active_edges = proposing.ActiveEdges();
+    MutationProposal proposal =
+        proposing.Propose(/*operation_count=*/3, random_engine.Substream(i));
+    BOOST_CHECK(active_edges == proposing.ActiveEdges());
+
+    proposing.Commit(proposal);
+    Mutation mutation =
+        mutating.Mutate(/*operation_count=*/3, random_engine.Substream(i));
+    BOOST_CHECK(proposal.mutation.additions == mutation.additions);
+    BOOST_CHECK(proposal.mutation.deletions == mutation.deletions);
+    BOOST_CHECK(proposing.ActiveEdges() == mutating.ActiveEdges());
+    BOOST_CHECK(proposing.DeletedEdges() == mutating.DeletedEdges());
+  }
+
+  proposing.Revert();
+  mutating.Revert();
+  BOOST_CHECK(proposing.ActiveEdges() == mutating.ActiveEdges());
+}
+
+BOOST_AUTO_TEST_CASE(WhenProposalsAreReordered_ThenCheckTheyAreKept) {
+  Topology topology = testing::CreateGridTopology(/*side=*/5, /*scale=*/1e3f,
+                                                  /*population=*/4e3);
+  PhiloxEngine random_engine(7);
+  EdgeSetState edge_set_state = CreateEdgeSetStateFor(topology);
+
+  std::vector<MutationProposal> forward;
+  for (unsigned k = 0; k < 8; ++k) {
+    forward.push_back(edge_set_state.Propose(/*operation_count=*/3,
+                                             random_engine.Substream(k)));
+  }
+  for (unsigned k = 8; k-- > 0;) {
+    MutationProposal backward = edge_set_state.Propose(
+        /*operation_count=*/3, random_engine.Substream(k));
+    BOOST_CHECK(forward[k].mutation.additions == backward.mutation.additions);
+    BOOST_CHECK(forward[k].mutation.deletions == backward.mutation.deletions);
+  }
+}
+
 BOOST_AUTO_TEST_CASE(WhenMutateAndRevertToGoal_ThenCheckActiveAndDeletedEdges) {
   Topology topology = testing::CreateGridTopology(/*side=*/5, /*scale=*/1e3f,
                                                   /*population=*/4e3);
-  std::default_random_engine random_engine;
-  EdgeSetState edge_set_state = CreateEdgeSetStateFor(topology, &random_engine);
+  EdgeSetState edge_set_state = CreateEdgeSetStateFor(topology);
 
   // Mutate to empty.
+  PhiloxEngine random_engine;
+  unsigned mutation_count = 0;
   while (!edge_set_state.ActiveEdges().empty()) {
-    Mutation mutation = edge_set_state.Mutate(/*operation_count=*/2);
+    Mutation mutation = edge_set_state.Mutate(
+        /*operation_count=*/2, random_engine.Substream(mutation_count++));
     if (mutation.deletions.empty()) {
       edge_set_state.Revert();
     }
@@ -99,7 +146,8 @@ BOOST_AUTO_TEST_CASE(WhenMutateAndRevertToGoal_ThenCheckActiveAndDeletedEdges) {
 
   // Mutate to full.
   while (!edge_set_state.DeletedEdges().empty()) {
-    Mutation mutation = edge_set_state.Mutate(/*operation_count=*/2);
+    Mutation mutation = edge_set_state.Mutate(
+        /*operation_count=*/2, random_engine.Substream(mutation_count++));
     if (mutation.additions.empty()) {
       edge_set_state.Revert();
     }
@@ -0,0 +1,164 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "procedural/probing/parallel/parallel.hpp"
+#include "procedural/probing/random/philox.hpp"
+#include "procedural/probing/topology/edge_set.hpp"
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+
+// Proposes mutations made of a fixed number of random operations on the edge
+// set. It's the mutation policy of HillClimb() and HillClimbInBatches() shared
+// by the optimizers. The i-th mutation draws from the i-th substream of the
+// random engine, counting the proposals of the batches in order.
+class EdgeSetMutationPolicy {
+public:
+  EdgeSetMutationPolicy(unsigned operation_count, PhiloxEngine random_engine,
+                        EdgeSetState *edge_set_state)
+      : operation_count_(operation_count), random_engine_(random_engine),
+        mutation_count_(0), edge_set_state_(edge_set_state) {}
+
+  Mutation Propose() {
+    return edge_set_state_->Mutate(
+        operation_count_, random_engine_.Substream(mutation_count_++));
+  }
+  void Revert() { edge_set_state_->Revert(); }
+
+  std::vector<MutationProposal> ProposeBatch(unsigned batch_size) {
+    std::vector<MutationProposal> proposals;
+    proposals.reserve(batch_size);
+    for (unsigned k = 0; k < batch_size; ++k) {
+      proposals.push_back(edge_set_state_->Propose(
+          operation_count_, random_engine_.Substream(mutation_count_++)));
+    }
+    return proposals;
+  }
+  void Commit(MutationProposal const &proposal) {
+    edge_set_state_->Commit(proposal);
+  }
+
+private:
+  unsigned const operation_count_;
+  PhiloxEngine const random_engine_;
+  unsigned mutation_count_;
+  EdgeSetState *const edge_set_state_;
+};
+
+// Keeps any mutation which doesn't lower the score.
+struct NonDecreasingAcceptancePolicy {
+  bool operator()(float new_score, float current_score) const {
+    return new_score >= current_score;
+  }
+};
+
+// Climbs the objective from the current score for iteration_count steps and
+// returns the final score. Every step proposes a mutation, applies it onto the
+// objective's state, then either accepts it or reverts both. The policies are
+// plain types whose calls are resolved at compile time:
+//
+// ObjectivePolicy:
+//   float Apply(M &&mutation): Applies the mutation drawn by the mutation
+//       policy onto the state and returns the new score.
+//   void Revert(): Reverts the last mutation applied.
+//   void ReportProgress(unsigned i, unsigned iteration_count, float score):
+//       Called at the beginning of every step.
+//
+// MutationPolicy:
+//   M Propose(): Draws the next mutation, e.g. a Mutation of the edge set.
+//   void Revert(): Reverts the last mutation drawn.
+//
+// AcceptancePolicy:
+//   bool operator()(float new_score, float current_score): Whether to keep
+//       the mutation.
+template <typename ObjectivePolicy, typename MutationPolicy,
+          typename AcceptancePolicy = NonDecreasingAcceptancePolicy>
+float HillClimb(unsigned iteration_count, float score,
+                ObjectivePolicy *objective, MutationPolicy *mutation,
+                AcceptancePolicy const &acceptance = AcceptancePolicy()) {
+  for (unsigned i = 0; i < iteration_count; ++i) {
+    objective->ReportProgress(i, iteration_count, score);
+
+    float new_score = objective->Apply(mutation->Propose());
+    if (acceptance(new_score, score)) {
+      score = new_score;
+      continue;
+    }
+
+    objective->Revert();
+    mutation->Revert();
+  }
+  return score;
+}
+
+// Same as above, except that every step draws batch_size independent
+// proposals from the current state and scores them concurrently, without
+// applying any. The best proposal, the first of them on ties, is then committed
+// onto both the mutation and the objective's state if the acceptance policy
+// keeps it. The scores are gathered by proposal index, so the climb doesn't
+// depend on the thread count. The policies are:
+//
+// ObjectivePolicy:
+//   float Score(P const &proposal) const: The score the proposal would lead
+//       to. It's called concurrently.
+//   void Commit(P &&proposal): Applies the proposal onto the state.
+//   void ReportProgress(unsigned i, unsigned iteration_count, float score):
+//       Called at the beginning of every step.
+//
+// MutationPolicy:
+//   std::vector<P> ProposeBatch(unsigned batch_size): Draws the proposals,
+//       e.g. MutationProposals of the edge set, leaving the state unchanged.
+//   void Commit(P const &proposal): Applies the proposal onto the state.
+//
+// AcceptancePolicy: Same as above.
+template <typename ObjectivePolicy, typename MutationPolicy,
+          typename AcceptancePolicy = NonDecreasingAcceptancePolicy>
+float HillClimbInBatches(
+    unsigned iteration_count, unsigned batch_size, float score,
+    ObjectivePolicy *objective, MutationPolicy *mutation,
+    AcceptancePolicy const &acceptance = AcceptancePolicy()) {
+  assert(batch_size > 0);
+
+  std::vector<float> scores(batch_size);
+  for (unsigned i = 0; i < iteration_count; ++i) {
+    objective->ReportProgress(i, iteration_count, score);
+
+    auto proposals = mutation->ProposeBatch(batch_size);
+    ParallelFor(batch_size, [objective, &proposals, &scores](unsigned k) {
+      scores[k] = objective->Score(proposals[k]);
+    });
+
+    unsigned best =
+        std::max_element(scores.begin(), scores.end()) - scores.begin();
+    if (!acceptance(scores[best], score)) {
+      continue;
+    }
+
+    mutation->Commit(proposals[best]);
+    objective->Commit(std::move(proposals[best]));
+    score = scores[best];
+  }
+  return score;
+}
+
+} // namespace procedural
+} // namespace e8
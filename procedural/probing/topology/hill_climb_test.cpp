@@ -0,0 +1,144 @@
+// e8City
+// Copyright (C) 2023 e8yes
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#define BOOST_TEST_MAIN
+#include "procedural/probing/topology/hill_climb.hpp"
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <vector>
+
+namespace e8 {
+namespace procedural {
+namespace {
+
+int const kPeak = 10;
+
+// Scores an integer by its distance to the peak.
+class ParabolaObjectivePolicy {
+public:
+  float Apply(int step) {
+    x += step;
+    last_step = step;
+    return Score();
+  }
+
+  void Revert() { x -= last_step; }
+
+  void ReportProgress(unsigned, unsigned, float) { ++report_count; }
+
+  float Score() const { return -(x - kPeak) * (x - kPeak); }
+
+  int x = 0;
+  int last_step = 0;
+  unsigned report_count = 0;
+};
+
+// Steps the integer by one in a random direction.
+class RandomStepPolicy {
+public:
+  int Propose() {
+    return std::bernoulli_distribution()(random_engine) ? 1 : -1;
+  }
+
+  void Revert() { ++revert_count; }
+
+  std::default_random_engine random_engine;
+  unsigned revert_count = 0;
+};
+
+// Scores the steps of a batch without taking them.
+class BatchParabolaObjectivePolicy : public ParabolaObjectivePolicy {
+public:
+  using ParabolaObjectivePolicy::Score;
+
+  float Score(int const &step) const {
+    return -(x + step - kPeak) * (x + step - kPeak);
+  }
+
+  void Commit(int &&step) { x += step; }
+};
+
+// Draws batches of steps from one to three in either direction.
+class RandomBatchPolicy {
+public:
+  std::vector<int> ProposeBatch(unsigned batch_size) {
+    std::vector<int> steps(batch_size);
+    for (int &step : steps) {
+      step = std::uniform_int_distribution<int>(-3, 3)(random_engine);
+    }
+    return steps;
+  }
+
+  void Commit(int const &) { ++commit_count; }
+
+  std::default_random_engine random_engine;
+  unsigned commit_count = 0;
+};
+
+struct RejectionPolicy {
+  bool operator()(float, float) const { return false; }
+};
+
+BOOST_AUTO_TEST_CASE(WhenObjectiveIsUnimodal_ThenCheckPeakIsReached) {
+  ParabolaObjectivePolicy objective;
+  RandomStepPolicy mutation;
+  float score = HillClimb(/*iteration_count=*/200, objective.Score(),
+                          &objective, &mutation);
+
+  BOOST_CHECK_EQUAL(kPeak, objective.x);
+  BOOST_CHECK_EQUAL(0, score);
+  BOOST_CHECK_EQUAL(200, objective.report_count);
+  BOOST_CHECK_GT(mutation.revert_count, 0);
+}
+
+BOOST_AUTO_TEST_CASE(WhenEveryMutationIsRejected_ThenCheckStateIsKept) {
+  ParabolaObjectivePolicy objective;
+  RandomStepPolicy mutation;
+  float score = HillClimb(/*iteration_count=*/50, objective.Score(),
+                          &objective, &mutation, RejectionPolicy());
+
+  BOOST_CHECK_EQUAL(0, objective.x);
+  BOOST_CHECK_EQUAL(objective.Score(), score);
+  BOOST_CHECK_EQUAL(50, mutation.revert_count);
+}
+
+BOOST_AUTO_TEST_CASE(WhenClimbInBatches_ThenCheckPeakIsReached) {
+  BatchParabolaObjectivePolicy objective;
+  RandomBatchPolicy mutation;
+  float score = HillClimbInBatches(/*iteration_count=*/50, /*batch_size=*/4,
+                                   objective.Score(), &objective, &mutation);
+
+  BOOST_CHECK_EQUAL(kPeak, objective.x);
+  BOOST_CHECK_EQUAL(0, score);
+  BOOST_CHECK_EQUAL(50, objective.report_count);
+  BOOST_CHECK_GT(mutation.commit_count, 0);
+}
+
+BOOST_AUTO_TEST_CASE(WhenEveryBatchIsRejected_ThenCheckStateIsKept) {
+  BatchParabolaObjectivePolicy objective;
+  RandomBatchPolicy mutation;
+  float score = HillClimbInBatches(/*iteration_count=*/50, /*batch_size=*/4,
+                                   objective.Score(), &objective, &mutation,
+                                   RejectionPolicy());
+
+  BOOST_CHECK_EQUAL(0, objective.x);
+  BOOST_CHECK_EQUAL(objective.Score(), score);
+  BOOST_CHECK_EQUAL(0, mutation.commit_count);
+}
+
+} // namespace
+} // namespace procedural
+} // namespace e8
@@ -15,47 +15,112 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/topology/init.hpp"
+#include "procedural/probing/parallel/parallel.hpp"
 #include "procedural/probing/probe/probe.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/objective_efficiency.hpp"
 #include <CGAL/Delaunay_triangulation_2.h>
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Triangulation_data_structure_2.h>
+#include <CGAL/Triangulation_vertex_base_with_info_2.h>
+#include <algorithm>
 #include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/connected_components.hpp>
+#include <boost/pending/disjoint_sets.hpp>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <eigen3/Eigen/Core>
+#include <tuple>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace e8 {
 namespace procedural {
 namespace {
 
+unsigned const kMinEdgesPerChunk = 4096;
+
 using ConstructionKernel = CGAL::Exact_predicates_inexact_constructions_kernel;
+using VertexBase =
+    CGAL::Triangulation_vertex_base_with_info_2<unsigned, ConstructionKernel>;
+using TriangulationDataStructure =
+    CGAL::Triangulation_data_structure_2<VertexBase>;
 using DelaunayTriangulation =
-    CGAL::Delaunay_triangulation_2<ConstructionKernel>;
-using VertexHandle = DelaunayTriangulation::Vertex_handle;
-using FiniteVertexHandles = DelaunayTriangulation::Finite_vertex_handles;
+    CGAL::Delaunay_triangulation_2<ConstructionKernel,
+                                   TriangulationDataStructure>;
 using Point = DelaunayTriangulation::Point;
 
-std::vector<Point> ToVerticecs(std::vector<PopulationProbe> const &probes) {
-  std::vector<Point> points(probes.size());
-  std::transform(probes.begin(), probes.end(), points.begin(),
-                 [](PopulationProbe const &probe) {
-                   return Point(probe.location.x(), probe.location.y());
-                 });
+// A CGAL point tagged with the index of the probe it comes from.
+using IndexedPoint = std::pair<Point, unsigned>;
 
+// An undirected connection between two probes.
+using Connection = std::pair<unsigned, unsigned>;
+
+std::vector<IndexedPoint>
+ToIndexedPoints(std::vector<PopulationProbe> const &probes,
+                std::vector<unsigned> const &probe_indices) {
+  std::vector<IndexedPoint> points(probe_indices.size());
+  std::transform(probe_indices.begin(), probe_indices.end(), points.begin(),
+                 [&probes](unsigned probe_index) {
+                   Eigen::Vector3f const &location =
+                       probes[probe_index].location;
+                   return IndexedPoint(Point(location.x(), location.y()),
+                                       probe_index);
+                 });
   return points;
 }
 
-std::unordered_map<Point, unsigned>
-CreateVertexToIndexMapping(std::vector<Point> const &vertices) {
-  std::unordered_map<Point, unsigned> result;
-  for (unsigned i = 0; i < vertices.size(); ++i) {
-    result[vertices[i]] = i;
+std::vector<unsigned> AllProbeIndices(unsigned probe_count) {
+  std::vector<unsigned> result(probe_count);
+  for (unsigned i = 0; i < probe_count; ++i) {
+    result[i] = i;
   }
   return result;
 }
 
+// Triangulates the probes and reads the probe indices of the connections
+// directly off the vertex handles. The triangulation keeps a single vertex per
+// location, so every other probe at the same location is connected to the
+// first one instead, the way the lattice attaches probes to a cell.
+std::vector<Connection>
+DelaunayConnections(std::vector<PopulationProbe> const &probes,
+                    std::vector<unsigned> probe_indices) {
+  auto location_order = [&probes](unsigned a, unsigned b) {
+    Eigen::Vector3f const &a_location = probes[a].location;
+    Eigen::Vector3f const &b_location = probes[b].location;
+    return std::tie(a_location.x(), a_location.y(), a) <
+           std::tie(b_location.x(), b_location.y(), b);
+  };
+  std::sort(probe_indices.begin(), probe_indices.end(), location_order);
+
+  std::vector<Connection> connections;
+  connections.reserve(3 * probe_indices.size());
+  std::vector<unsigned> distinct_indices;
+  distinct_indices.reserve(probe_indices.size());
+  for (unsigned probe_index : probe_indices) {
+    if (!distinct_indices.empty() &&
+        probes[distinct_indices.back()].location.head<2>() ==
+            probes[probe_index].location.head<2>()) {
+      connections.push_back(Connection(distinct_indices.back(), probe_index));
+    } else {
+      distinct_indices.push_back(probe_index);
+    }
+  }
+
+  std::vector<IndexedPoint> points = ToIndexedPoints(probes, distinct_indices);
+  DelaunayTriangulation triangulation;
+  triangulation.insert(points.begin(), points.end());
+
+  for (auto const &[face, i] : triangulation.finite_edges()) {
+    unsigned start_index = face->vertex(DelaunayTriangulation::cw(i))->info();
+    unsigned end_index = face->vertex(DelaunayTriangulation::ccw(i))->info();
+    connections.push_back(Connection(start_index, end_index));
+  }
+  return connections;
+}
+
 void SetVertexProperties(std::vector<PopulationProbe> const &probes,
                          Topology *topology) {
   float total_population = 0;
@@ -72,33 +137,366 @@ void SetVertexProperties(std::vector<PopulationProbe> const &probes,
   }
 }
 
+void AddConnections(std::vector<Connection> const &connections,
+                    Topology *topology) {
+  for (auto const &[start_index, end_index] : connections) {
+    if (!boost::edge(start_index, end_index, *topology).second) {
+      boost::add_edge(start_index, end_index, *topology);
+    }
+  }
+}
+
 void CreateDelaunayConnections(std::vector<PopulationProbe> const &probes,
                                Topology *topology) {
-  std::vector<Point> vertices = ToVerticecs(probes);
-  std::unordered_map<Point, unsigned> vertex_to_index =
-      CreateVertexToIndexMapping(vertices);
-  DelaunayTriangulation triangulation(vertices.begin(), vertices.end());
+  AddConnections(DelaunayConnections(probes, AllProbeIndices(probes.size())),
+                 topology);
+}
 
-  for (auto const &edge : triangulation.finite_edges()) {
-    DelaunayTriangulation::Segment const &segment = triangulation.segment(edge);
-    unsigned start_index = vertex_to_index[segment.start()];
-    unsigned end_index = vertex_to_index[segment.end()];
+// Partitions the bounding box of the probes into square tiles.
+class TileGrid {
+public:
+  TileGrid(std::vector<PopulationProbe> const &probes, float tile_size)
+      : tile_size_(tile_size) {
+    assert(!probes.empty());
+    assert(tile_size > 0);
 
-    if (!boost::edge(start_index, end_index, *topology).second) {
-      boost::add_edge(start_index, end_index, *topology);
+    min_ = probes[0].location.head<2>();
+    Eigen::Vector2f max = min_;
+    for (auto const &probe : probes) {
+      min_ = min_.cwiseMin(probe.location.head<2>());
+      max = max.cwiseMax(probe.location.head<2>());
     }
+
+    column_count_ = static_cast<unsigned>((max.x() - min_.x()) / tile_size) + 1;
+    row_count_ = static_cast<unsigned>((max.y() - min_.y()) / tile_size) + 1;
+  }
+
+  unsigned TileCount() const { return column_count_ * row_count_; }
+  unsigned ColumnCount() const { return column_count_; }
+  unsigned RowCount() const { return row_count_; }
+
+  // Tile containing the location. Locations out of the bounding box are
+  // clamped to the closest tile.
+  unsigned TileOf(Eigen::Vector2f const &location) const {
+    return ColumnOf(location.x()) + RowOf(location.y()) * column_count_;
+  }
+
+  Eigen::Vector2f TileMin(unsigned tile) const {
+    return min_ + tile_size_ * Eigen::Vector2f(tile % column_count_,
+                                               tile / column_count_);
+  }
+
+  Eigen::Vector2f TileMax(unsigned tile) const {
+    return TileMin(tile) + Eigen::Vector2f(tile_size_, tile_size_);
   }
+
+private:
+  unsigned ColumnOf(float x) const {
+    float column = std::floor((x - min_.x()) / tile_size_);
+    return std::clamp(column, 0.0f, static_cast<float>(column_count_ - 1));
+  }
+
+  unsigned RowOf(float y) const {
+    float row = std::floor((y - min_.y()) / tile_size_);
+    return std::clamp(row, 0.0f, static_cast<float>(row_count_ - 1));
+  }
+
+  float const tile_size_;
+  Eigen::Vector2f min_;
+  unsigned column_count_;
+  unsigned row_count_;
+};
+
+std::vector<std::vector<unsigned>>
+BucketProbesByTile(std::vector<PopulationProbe> const &probes,
+                   TileGrid const &grid) {
+  std::vector<std::vector<unsigned>> buckets(grid.TileCount());
+  for (unsigned i = 0; i < probes.size(); ++i) {
+    buckets[grid.TileOf(probes[i].location.head<2>())].push_back(i);
+  }
+  return buckets;
 }
 
-void SetEdgeCost(Topology *topology) {
-  auto [current, end] = boost::edges(*topology);
-  for (; current != end; ++current) {
-    float edge_static_cost =
-        EstimateTravelTimeCost(current->m_source, current->m_target, *topology);
-    boost::put(boost::edge_weight_t(), *topology, *current, edge_static_cost);
+// Collects the probes that lie in the tile, extended by the margin on every
+// side. The margin must not exceed the tile size, so only the 3x3 block of
+// tiles around needs to be scanned.
+std::vector<unsigned>
+ExtendedTileProbes(unsigned tile, float margin,
+                   std::vector<PopulationProbe> const &probes,
+                   std::vector<std::vector<unsigned>> const &buckets,
+                   TileGrid const &grid) {
+  Eigen::Vector2f extended_min =
+      grid.TileMin(tile) - Eigen::Vector2f(margin, margin);
+  Eigen::Vector2f extended_max =
+      grid.TileMax(tile) + Eigen::Vector2f(margin, margin);
+
+  int column = tile % grid.ColumnCount();
+  int row = tile / grid.ColumnCount();
+
+  std::vector<unsigned> result;
+  for (int r = std::max(0, row - 1);
+       r <= std::min<int>(grid.RowCount() - 1, row + 1); ++r) {
+    for (int c = std::max(0, column - 1);
+         c <= std::min<int>(grid.ColumnCount() - 1, column + 1); ++c) {
+      for (unsigned probe_index : buckets[c + r * grid.ColumnCount()]) {
+        Eigen::Vector2f location = probes[probe_index].location.head<2>();
+        if ((location.array() >= extended_min.array()).all() &&
+            (location.array() <= extended_max.array()).all()) {
+          result.push_back(probe_index);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+// Triangulates the extended tile and keeps the connections owned by the tile.
+// A connection is owned by the tile containing its midpoint, so every
+// connection is reported by at most one tile. The margin keeps the artificial
+// hull edges of the extended tile away from the owned area.
+std::vector<Connection>
+TileConnections(unsigned tile, float margin,
+                std::vector<PopulationProbe> const &probes,
+                std::vector<std::vector<unsigned>> const &buckets,
+                TileGrid const &grid) {
+  if (buckets[tile].empty()) {
+    return std::vector<Connection>();
+  }
+
+  std::vector<Connection> connections = DelaunayConnections(
+      probes, ExtendedTileProbes(tile, margin, probes, buckets, grid));
+
+  std::erase_if(connections, [tile, &probes, &grid](
+                                 Connection const &connection) {
+    Eigen::Vector2f midpoint =
+        0.5f * (probes[connection.first].location.head<2>() +
+                probes[connection.second].location.head<2>());
+    return grid.TileOf(midpoint) != tile;
+  });
+  return connections;
+}
+
+// Connects the components of the topology, which the tiles may leave apart
+// when a connection of the global triangulation is longer than the margin,
+// e.g. around sparse rural probes or across water. In every tile, the probe of
+// each component closest to the tile center stands for the component. The
+// shortest connections of the triangulation of those representatives which
+// join different components are added until the topology is connected.
+void ConnectComponents(std::vector<PopulationProbe> const &probes,
+                       std::vector<std::vector<unsigned>> const &buckets,
+                       TileGrid const &grid, Topology *topology) {
+  std::vector<unsigned> components(probes.size());
+  unsigned component_count = boost::connected_components(
+      *topology, boost::make_iterator_property_map(
+                     components.begin(),
+                     boost::get(boost::vertex_index, *topology)));
+  if (component_count <= 1) {
+    return;
+  }
+
+  std::vector<unsigned> representatives;
+  for (unsigned tile = 0; tile < grid.TileCount(); ++tile) {
+    Eigen::Vector2f center = 0.5f * (grid.TileMin(tile) + grid.TileMax(tile));
+    std::unordered_map<unsigned, unsigned> closest;
+    for (unsigned probe_index : buckets[tile]) {
+      auto [it, inserted] =
+          closest.insert({components[probe_index], probe_index});
+      if (!inserted &&
+          (probes[probe_index].location.head<2>() - center).squaredNorm() <
+              (probes[it->second].location.head<2>() - center).squaredNorm()) {
+        it->second = probe_index;
+      }
+    }
+    for (auto const &[_, probe_index] : closest) {
+      representatives.push_back(probe_index);
+    }
+  }
+  // Hash map iteration order is unspecified, but the triangulation sorts its
+  // input, which keeps it deterministic.
+  std::vector<Connection> bridges =
+      DelaunayConnections(probes, std::move(representatives));
+  std::erase_if(bridges, [&components](Connection const &bridge) {
+    return components[bridge.first] == components[bridge.second];
+  });
+  auto length = [&probes](Connection const &connection) {
+    return (probes[connection.first].location.head<2>() -
+            probes[connection.second].location.head<2>())
+        .squaredNorm();
+  };
+  std::stable_sort(bridges.begin(), bridges.end(),
+                   [&length](Connection const &a, Connection const &b) {
+                     return length(a) < length(b);
+                   });
+
+  // The triangulation of the representatives is connected, so a spanning
+  // forest of the bridges connects every component.
+  boost::disjoint_sets_with_storage<> joined(component_count);
+  for (auto const &[u, v] : bridges) {
+    unsigned u_set = joined.find_set(components[u]);
+    unsigned v_set = joined.find_set(components[v]);
+    if (u_set != v_set) {
+      joined.link(u_set, v_set);
+      boost::add_edge(u, v, *topology);
+    }
   }
 }
 
+void CreateTiledDelaunayConnections(std::vector<PopulationProbe> const &probes,
+                                    float tile_size, float tile_margin,
+                                    Topology *topology) {
+  if (probes.empty()) {
+    return;
+  }
+
+  TileGrid grid(probes, tile_size);
+  std::vector<std::vector<unsigned>> buckets = BucketProbesByTile(probes, grid);
+
+  // The tiles are triangulated a batch of one tile per worker at a time, and
+  // the connections of a batch are stitched before the next one starts. So
+  // beyond the topology itself, the memory is bounded by the batch.
+  unsigned batch_size = ParallelWorkerCount();
+  std::vector<std::vector<Connection>> batch_connections(batch_size);
+  for (unsigned first = 0; first < grid.TileCount(); first += batch_size) {
+    unsigned count = std::min(batch_size, grid.TileCount() - first);
+    ParallelFor(count, [first, tile_margin, &probes, &buckets, &grid,
+                        &batch_connections](unsigned i) {
+      batch_connections[i] =
+          TileConnections(first + i, tile_margin, probes, buckets, grid);
+    });
+
+    // Stitches in tile order to keep the edge order deterministic.
+    for (unsigned i = 0; i < count; ++i) {
+      AddConnections(batch_connections[i], topology);
+      std::vector<Connection>().swap(batch_connections[i]);
+    }
+  }
+
+  ConnectComponents(probes, buckets, grid, topology);
+}
+
+// Integer coordinate of a probe on the lattice.
+struct LatticeCell {
+  int column;
+  int row;
+};
+
+LatticeCell const kLatticeDiagonalOffsets[] = {{1, 1}, {1, -1}};
+LatticeCell const kLatticeAxisOffsets[] = {{1, 0}, {0, 1}};
+
+// The width, in cells, of the tiles whose components bridge the lattice gaps.
+float const kLatticeCellsPerBridgeTile = 16.0f;
+
+int64_t LatticeCellKey(LatticeCell const &cell) {
+  return (static_cast<int64_t>(cell.column) << 32) |
+         static_cast<uint32_t>(cell.row);
+}
+
+std::vector<LatticeCell>
+ToLatticeCells(std::vector<PopulationProbe> const &probes, float grid_size) {
+  Eigen::Vector2f origin = probes[0].location.head<2>();
+  for (auto const &probe : probes) {
+    origin = origin.cwiseMin(probe.location.head<2>());
+  }
+
+  std::vector<LatticeCell> cells(probes.size());
+  std::transform(probes.begin(), probes.end(), cells.begin(),
+                 [&origin, grid_size](PopulationProbe const &probe) {
+                   Eigen::Vector2f offset =
+                       (probe.location.head<2>() - origin) / grid_size;
+                   return LatticeCell{
+                       .column = static_cast<int>(std::lround(offset.x())),
+                       .row = static_cast<int>(std::lround(offset.y())),
+                   };
+                 });
+  return cells;
+}
+
+void CreateLatticeConnections(std::vector<PopulationProbe> const &probes,
+                              float grid_size, unsigned max_axis_gap,
+                              Topology *topology) {
+  if (probes.empty()) {
+    return;
+  }
+
+  std::vector<LatticeCell> cells = ToLatticeCells(probes, grid_size);
+
+  // The first probe snapped to a cell represents the cell. Later probes
+  // falling onto the same cell are attached to the representative.
+  std::unordered_map<int64_t, unsigned> occupants;
+  occupants.reserve(probes.size());
+  std::vector<Connection> connections;
+  connections.reserve(4 * probes.size());
+  for (unsigned i = 0; i < probes.size(); ++i) {
+    auto [it, inserted] = occupants.insert({LatticeCellKey(cells[i]), i});
+    if (!inserted) {
+      connections.push_back(Connection(it->second, i));
+    }
+  }
+
+  auto occupant = [&occupants](int column, int row) -> int64_t {
+    auto it = occupants.find(LatticeCellKey(LatticeCell{column, row}));
+    return it == occupants.end() ? -1 : static_cast<int64_t>(it->second);
+  };
+
+  // Only the forward half of the neighborhood is visited, so each pair of
+  // neighboring cells is considered once.
+  for (auto const &[_, u] : occupants) {
+    LatticeCell const &cell = cells[u];
+
+    for (LatticeCell const &offset : kLatticeDiagonalOffsets) {
+      int64_t v = occupant(cell.column + offset.column, cell.row + offset.row);
+      if (v >= 0) {
+        connections.push_back(Connection(u, v));
+      }
+    }
+
+    // Along the axes, it looks past empty cells for the nearest occupied one.
+    for (LatticeCell const &offset : kLatticeAxisOffsets) {
+      for (int step = 1; step <= static_cast<int>(max_axis_gap) + 1; ++step) {
+        int64_t v = occupant(cell.column + step * offset.column,
+                             cell.row + step * offset.row);
+        if (v >= 0) {
+          connections.push_back(Connection(u, v));
+          break;
+        }
+      }
+    }
+  }
+
+  // Hash map iteration order is unspecified. Sorting keeps the edge order
+  // deterministic.
+  for (auto &[u, v] : connections) {
+    if (u > v) {
+      std::swap(u, v);
+    }
+  }
+  std::sort(connections.begin(), connections.end());
+  AddConnections(connections, topology);
+
+  // Probes beyond max_axis_gap cells from any other, e.g. across the holes of
+  // a population grid, are left apart. The optimizer only removes candidate
+  // connections, so they are bridged the same way as the Delaunay tiles.
+  TileGrid grid(probes, kLatticeCellsPerBridgeTile * grid_size);
+  ConnectComponents(probes, BucketProbesByTile(probes, grid), grid, topology);
+}
+
+void SetEdgeCost(Topology *topology) {
+  auto [edges_begin, edges_end] = boost::edges(*topology);
+  std::vector<Topology::edge_descriptor> edges(edges_begin, edges_end);
+
+  ParallelForChunks(
+      edges.size(),
+      [&edges, topology](unsigned, unsigned begin, unsigned end) {
+        for (unsigned i = begin; i < end; ++i) {
+          float edge_static_cost = EstimateTravelTimeCost(
+              edges[i].m_source, edges[i].m_target, *topology);
+          boost::put(boost::edge_weight_t(), *topology, edges[i],
+                     edge_static_cost);
+        }
+      },
+      kMinEdgesPerChunk);
+}
+
 } // namespace
 
 Topology CreateDelaunayTopology(std::vector<PopulationProbe> const &probes) {
@@ -109,5 +507,28 @@ Topology CreateDelaunayTopology(std::vector<PopulationProbe> const &probes) {
   return topology;
 }
 
+Topology
+CreateTiledDelaunayTopology(std::vector<PopulationProbe> const &probes,
+                            float tile_size, float tile_margin) {
+  assert(tile_margin >= 0 && tile_margin <= tile_size);
+
+  Topology topology(probes.size());
+  SetVertexProperties(probes, &topology);
+  CreateTiledDelaunayConnections(probes, tile_size, tile_margin, &topology);
+  SetEdgeCost(&topology);
+  return topology;
+}
+
+Topology CreateLatticeTopology(std::vector<PopulationProbe> const &probes,
+                               float grid_size, unsigned max_axis_gap) {
+  assert(grid_size > 0);
+
+  Topology topology(probes.size());
+  SetVertexProperties(probes, &topology);
+  CreateLatticeConnections(probes, grid_size, max_axis_gap, &topology);
+  SetEdgeCost(&topology);
+  return topology;
+}
+
 } // namespace procedural
 } // namespace e8
@@ -27,5 +27,37 @@ namespace procedural {
 // Delaunay triangulation conditons.
 Topology CreateDelaunayTopology(std::vector<PopulationProbe> const &probes);
 
+// Approximates CreateDelaunayTopology() by triangulating square tiles of the
+// specified size independently and in parallel, then stitching the
+// connections. Every tile is extended by the margin on each side so that the
+// connections close to the tile border see their true neighbors. A connection
+// of the global triangulation which crosses a tile border is found only when
+// it's shorter than about twice the margin. The longer ones are missed, so the
+// components left apart are joined by the shortest connections amongst
+// representatives of every component in every tile, which may differ from the
+// global triangulation. The result is always connected. Only a batch of one
+// tile per worker is triangulated at a time, so besides the topology itself,
+// the peak memory grows with the tile size instead of the region size. The
+// margin must be within [0, tile_size].
+Topology
+CreateTiledDelaunayTopology(std::vector<PopulationProbe> const &probes,
+                            float tile_size, float tile_margin);
+
+// Creates a candidate topology over probes snapped to an axis aligned square
+// lattice of the specified grid size, e.g. the 200m grid of the population
+// probes. Each probe is connected to its occupied lattice neighbors, including
+// the diagonal ones. Along each axis, it connects to the nearest occupied cell
+// within max_axis_gap empty cells. Probes are hashed into integer cells, so the
+// lattice connections take O(n) time without any geometric predicate.
+// Off-lattice probes are rounded to the closest cell. The probes are expected
+// to be unique per cell, like those of a population grid: a probe rounded onto
+// an occupied cell is only connected to the cell's first probe, over a
+// connection as short as their offset. Since the lattice connections only run
+// in 8 directions, the street angles are discrete. The components the gaps
+// leave apart are joined the same way as by CreateTiledDelaunayTopology(), so
+// the result is always connected.
+Topology CreateLatticeTopology(std::vector<PopulationProbe> const &probes,
+                               float grid_size, unsigned max_axis_gap);
+
 } // namespace procedural
 } // namespace e8
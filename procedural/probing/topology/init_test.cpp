@@ -19,8 +19,10 @@
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/init.hpp"
 #include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/connected_components.hpp>
 #include <boost/test/unit_test.hpp>
 #include <eigen3/Eigen/Core>
+#include <random>
 #include <vector>
 
 namespace e8 {
@@ -70,6 +72,168 @@ BOOST_AUTO_TEST_CASE(WhenProbesAreSquare_ThenCheckTopologyIsMesh) {
                     1);
 }
 
+BOOST_AUTO_TEST_CASE(WhenProbesCoincide_ThenCheckTopologyIsConnected) {
+  std::vector<PopulationProbe> probes;
+  for (unsigned i = 0; i < 2; ++i) {
+    probes.push_back(PopulationProbe(
+        /*location=*/Eigen::Vector3f(0, 0, 0), /*population_grid_200=*/100.f));
+    probes.push_back(PopulationProbe(
+        /*location=*/Eigen::Vector3f(1000, 0, 0),
+        /*population_grid_200=*/100.f));
+  }
+  probes.push_back(PopulationProbe(
+      /*location=*/Eigen::Vector3f(0, 1000, 0), /*population_grid_200=*/100.f));
+
+  for (Topology const &topology :
+       {CreateDelaunayTopology(probes),
+        CreateTiledDelaunayTopology(probes, /*tile_size=*/2000.f,
+                                    /*tile_margin=*/1000.f)}) {
+    // The triangulation keeps the first probe of a location. The others are
+    // attached to it.
+    BOOST_CHECK(boost::edge(0, 2, topology).second);
+    BOOST_CHECK(boost::edge(1, 3, topology).second);
+    std::vector<unsigned> components(boost::num_vertices(topology));
+    BOOST_CHECK_EQUAL(
+        1, boost::connected_components(topology, components.data()));
+  }
+}
+
+std::vector<PopulationProbe> CreateJitteredGridProbes(unsigned side,
+                                                     float spacing) {
+  std::default_random_engine random_engine(13);
+  std::uniform_real_distribution<float> jitter(-0.3f * spacing,
+                                               0.3f * spacing);
+
+  std::vector<PopulationProbe> probes;
+  for (unsigned x = 0; x < side; ++x) {
+    for (unsigned y = 0; y < side; ++y) {
+      probes.push_back(PopulationProbe(
+          /*location=*/Eigen::Vector3f(spacing * x + jitter(random_engine),
+                                       spacing * y + jitter(random_engine), 0),
+          /*population_grid_200=*/100.f));
+    }
+  }
+  return probes;
+}
+
+unsigned CountEdgesMissingFrom(Topology const &topology,
+                               Topology const &reference) {
+  unsigned missing = 0;
+  for (auto [current, end] = boost::edges(topology); current != end;
+       ++current) {
+    if (!boost::edge(current->m_source, current->m_target, reference).second) {
+      ++missing;
+    }
+  }
+  return missing;
+}
+
+BOOST_AUTO_TEST_CASE(WhenTriangulateByTiles_ThenCheckTopologyMatchesGlobal) {
+  std::vector<PopulationProbe> probes =
+      CreateJitteredGridProbes(/*side=*/40, /*spacing=*/200.f);
+
+  Topology global = CreateDelaunayTopology(probes);
+  Topology tiled = CreateTiledDelaunayTopology(probes, /*tile_size=*/2000.f,
+                                               /*tile_margin=*/1000.f);
+
+  BOOST_CHECK_EQUAL(boost::num_vertices(global), boost::num_vertices(tiled));
+  BOOST_CHECK_CLOSE(static_cast<float>(boost::num_edges(global)),
+                    static_cast<float>(boost::num_edges(tiled)), 1);
+  BOOST_CHECK_LE(CountEdgesMissingFrom(tiled, global),
+                 boost::num_edges(global) / 100);
+  BOOST_CHECK_LE(CountEdgesMissingFrom(global, tiled),
+                 boost::num_edges(global) / 100);
+
+  for (auto [current, end] = boost::edges(tiled); current != end; ++current) {
+    BOOST_CHECK_GT(boost::get(boost::edge_weight_t(), tiled, *current), 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenTilesSplitSparseProbes_ThenCheckTopologyIsConnected) {
+  // Two towns 10km apart. The only connections between them are far longer
+  // than the margin, so no tile sees both ends of any of them.
+  std::vector<PopulationProbe> probes =
+      CreateJitteredGridProbes(/*side=*/5, /*spacing=*/200.f);
+  for (auto const &probe : CreateJitteredGridProbes(/*side=*/5,
+                                                    /*spacing=*/200.f)) {
+    probes.push_back(PopulationProbe(
+        /*location=*/probe.location + Eigen::Vector3f(10000.f, 0, 0),
+        /*population_grid_200=*/100.f));
+  }
+
+  Topology tiled = CreateTiledDelaunayTopology(probes, /*tile_size=*/2000.f,
+                                               /*tile_margin=*/1000.f);
+
+  std::vector<unsigned> components(boost::num_vertices(tiled));
+  BOOST_CHECK_EQUAL(1, boost::connected_components(tiled, components.data()));
+  for (auto [current, end] = boost::edges(tiled); current != end; ++current) {
+    BOOST_CHECK_GT(boost::get(boost::edge_weight_t(), tiled, *current), 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhenAllProbesFitInOneTile_ThenCheckTopologyIsGlobal) {
+  std::vector<PopulationProbe> probes =
+      CreateJitteredGridProbes(/*side=*/10, /*spacing=*/200.f);
+
+  Topology global = CreateDelaunayTopology(probes);
+  Topology tiled = CreateTiledDelaunayTopology(probes, /*tile_size=*/1e4f,
+                                               /*tile_margin=*/1e3f);
+
+  BOOST_CHECK_EQUAL(boost::num_edges(global), boost::num_edges(tiled));
+  BOOST_CHECK_EQUAL(0, CountEdgesMissingFrom(tiled, global));
+}
+
+BOOST_AUTO_TEST_CASE(WhenProbesFillLattice_ThenCheckTopologyIsFullMesh) {
+  std::vector<PopulationProbe> probes;
+  for (unsigned y = 0; y < 3; ++y) {
+    for (unsigned x = 0; x < 3; ++x) {
+      probes.push_back(PopulationProbe(
+          /*location=*/Eigen::Vector3f(200.f * x, 200.f * y, 0),
+          /*population_grid_200=*/100.f));
+    }
+  }
+
+  Topology topology = CreateLatticeTopology(probes, /*grid_size=*/200.f,
+                                            /*max_axis_gap=*/2);
+
+  // 12 axis aligned connections and 2 diagonals in each of the 4 squares.
+  BOOST_CHECK_EQUAL(20, boost::num_edges(topology));
+  BOOST_CHECK(boost::edge(0, 1, topology).second);
+  BOOST_CHECK(boost::edge(0, 3, topology).second);
+  BOOST_CHECK(boost::edge(0, 4, topology).second);
+  BOOST_CHECK(boost::edge(1, 3, topology).second);
+  BOOST_CHECK(!boost::edge(0, 2, topology).second);
+  BOOST_CHECK(!boost::edge(0, 8, topology).second);
+  BOOST_CHECK_CLOSE(1.f / 9, topology[4].importance, 1);
+}
+
+BOOST_AUTO_TEST_CASE(WhenLatticeHasGaps_ThenCheckTopologyIsConnected) {
+  std::vector<PopulationProbe> probes{
+      PopulationProbe(
+          /*location=*/Eigen::Vector3f(0, 0, 0), /*population_grid_200=*/100.f),
+      PopulationProbe(
+          /*location=*/Eigen::Vector3f(600, 0, 0),
+          /*population_grid_200=*/100.f),
+      PopulationProbe(
+          /*location=*/Eigen::Vector3f(0, 800, 0),
+          /*population_grid_200=*/100.f)};
+
+  Topology topology = CreateLatticeTopology(probes, /*grid_size=*/200.f,
+                                            /*max_axis_gap=*/2);
+
+  // The last probe is too far up for the lattice, so a single bridge joins it
+  // to the others.
+  BOOST_CHECK_EQUAL(2, boost::num_edges(topology));
+  BOOST_CHECK(boost::edge(0, 1, topology).second);
+  std::vector<unsigned> components(boost::num_vertices(topology));
+  BOOST_CHECK_EQUAL(1,
+                    boost::connected_components(topology, components.data()));
+  for (auto [current, end] = boost::edges(topology); current != end;
+       ++current) {
+    BOOST_CHECK_GT(boost::get(boost::edge_weight_t(), topology, *current), 0);
+  }
+}
+
 } // namespace
 } // namespace procedural
 } // namespace e8
@@ -82,13 +82,16 @@ void EdgesAffectedBy(std::unordered_set<Edge, EdgeHash> const &mutated_edges,
   }
 }
 
+float TravelTimeCostOf(unsigned u, unsigned v, Topology const &topology) {
+  auto [topology_edge, topology_existence] = boost::edge(u, v, topology);
+  assert(topology_existence);
+  return boost::get(boost::edge_weight_t(), topology, topology_edge);
+}
+
 void UpdateCostFor(Edge const &edge, Topology const &topology,
                    EfficiencyCostMap *cost_map) {
-  auto [topology_edge, topology_existence] =
-      boost::edge(std::get<0>(edge), std::get<1>(edge), topology);
-  assert(topology_existence);
   float travel_time_cost =
-      boost::get(boost::edge_weight_t(), topology, topology_edge);
+      TravelTimeCostOf(std::get<0>(edge), std::get<1>(edge), topology);
   float wait_time_cost =
       EstimateWaitTimeCost(std::get<0>(edge), std::get<1>(edge), *cost_map);
   float total_time_cost = TotalTimeCost(travel_time_cost, wait_time_cost);
@@ -144,6 +147,82 @@ void ApplyMutation(RevertibleEfficiencyMutation const &revertible,
   }
 }
 
+EfficiencyCostOverlay
+CreateEfficiencyCostOverlay(Mutation const &mutation, Topology const &topology,
+                            EfficiencyCostMap const &cost_map) {
+  auto deleted = [&mutation](unsigned u, unsigned v) {
+    return mutation.deletions.contains(Edge(u, v)) ||
+           mutation.deletions.contains(Edge(v, u));
+  };
+
+  // Relinks the endpoints of the mutated connections.
+  EfficiencyCostOverlay overlay;
+  std::vector<unsigned> endpoints;
+  auto relink = [&cost_map, &deleted, &overlay, &endpoints](unsigned endpoint) {
+    auto [it, inserted] = overlay.try_emplace(endpoint);
+    if (!inserted) {
+      return;
+    }
+    endpoints.push_back(endpoint);
+    for (auto [current, end] = boost::out_edges(endpoint, cost_map);
+         current != end; ++current) {
+      unsigned neighbor = boost::target(*current, cost_map);
+      if (!deleted(endpoint, neighbor)) {
+        it->second.push_back(std::make_pair(neighbor, 0.0f));
+      }
+    }
+  };
+  for (auto const &[u, v] : mutation.deletions) {
+    relink(u);
+    relink(v);
+  }
+  for (auto const &[u, v] : mutation.additions) {
+    relink(u);
+    relink(v);
+  }
+  for (auto const &[u, v] : mutation.additions) {
+    overlay[u].push_back(std::make_pair(v, 0.0f));
+    overlay[v].push_back(std::make_pair(u, 0.0f));
+  }
+
+  // The degrees of the endpoints change, and so do the costs of all their
+  // connections, as seen from both ends.
+  std::unordered_map<unsigned, unsigned> degrees;
+  for (unsigned endpoint : endpoints) {
+    degrees[endpoint] = overlay[endpoint].size();
+  }
+  auto degree = [&cost_map, &degrees](unsigned v) -> unsigned {
+    auto it = degrees.find(v);
+    return it != degrees.end() ? it->second : boost::degree(v, cost_map);
+  };
+  for (unsigned endpoint : endpoints) {
+    for (auto &[neighbor, edge_cost] : overlay[endpoint]) {
+      edge_cost = TotalTimeCost(
+          TravelTimeCostOf(endpoint, neighbor, topology),
+          EstimateWaitTimeCostByDegrees(degree(endpoint), degree(neighbor)));
+      if (degrees.contains(neighbor)) {
+        continue;
+      }
+
+      auto [it, inserted] = overlay.try_emplace(neighbor);
+      if (inserted) {
+        for (auto [current, end] = boost::out_edges(neighbor, cost_map);
+             current != end; ++current) {
+          it->second.push_back(std::make_pair(
+              boost::target(*current, cost_map),
+              boost::get(boost::edge_weight_t(), cost_map, *current)));
+        }
+      }
+      for (auto &[neighbor_neighbor, neighbor_edge_cost] : it->second) {
+        if (neighbor_neighbor == endpoint) {
+          neighbor_edge_cost = edge_cost;
+        }
+      }
+    }
+  }
+  return overlay;
+}
+
 void RevertMutation(RevertibleEfficiencyMutation const &revertible,
                     EfficiencyCostMap *cost_map) {
   // Removes added edges.
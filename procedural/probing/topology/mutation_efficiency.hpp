@@ -56,5 +56,14 @@ void ApplyMutation(RevertibleEfficiencyMutation const &revertible,
 void RevertMutation(RevertibleEfficiencyMutation const &revertible,
                     EfficiencyCostMap *cost_map);
 
+// Computes the costs the mutation would lead to as an overlay of the cost map,
+// assuming the mutation is generated based on the state of the cost map. The
+// overlay holds the connections of the probes whose degree changes, and of
+// their neighbors, with the same edge costs ApplyMutation() would set. The
+// cost map is left unchanged.
+EfficiencyCostOverlay
+CreateEfficiencyCostOverlay(Mutation const &mutation, Topology const &topology,
+                            EfficiencyCostMap const &cost_map);
+
 } // namespace procedural
 } // namespace e8
@@ -15,11 +15,17 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define BOOST_TEST_MAIN
+#include "procedural/probing/path/quantized.hpp"
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
+#include "procedural/probing/topology/edge_set.hpp"
 #include "procedural/probing/topology/mutation_efficiency.hpp"
 #include "procedural/probing/topology/objective_efficiency.hpp"
+#include "procedural/probing/topology/sampler.hpp"
+#include <array>
 #include <boost/test/unit_test.hpp>
 #include <random>
+#include <vector>
 
 namespace e8 {
 namespace procedural {
@@ -169,6 +175,48 @@ BOOST_AUTO_TEST_CASE(WhenMutateEdgesAndRevert_ThenCheckEfficiencyCostMap) {
   BOOST_CHECK_CLOSE(140, cost_12, 1);
 }
 
+BOOST_AUTO_TEST_CASE(WhenMutationIsOverlaid_ThenCheckObjectiveMatches) {
+  Topology topology = testing::CreateMeshTopology(/*side=*/5, /*scale=*/1e3f,
+                                                  /*population=*/4e3);
+  EfficiencyCostMap cost_map = CreateEfficiencyCostMapForTopology(topology);
+  EdgeSetState edge_set_state = CreateEdgeSetStateFor(topology);
+  SourcePopulationSampler source_population(topology);
+  VertexStore vertices = CreateVertexStoreFor(topology);
+
+  std::array<TimeCostPrecision, 3> const kPrecisions = {
+      TimeCostPrecision::kFloat, TimeCostPrecision::kDecisecond16,
+      TimeCostPrecision::kDecisecond32};
+  PhiloxEngine random_engine(7);
+  for (unsigned i = 0; i < 50; ++i) {
+    MutationProposal proposal = edge_set_state.Propose(
+        /*operation_count=*/3, random_engine.Substream(i));
+    EfficiencyCostOverlay overlay =
+        CreateEfficiencyCostOverlay(proposal.mutation, topology, cost_map);
+    std::vector<float> overlaid_scores;
+    for (TimeCostPrecision precision : kPrecisions) {
+      overlaid_scores.push_back(EvaluateEfficiencyObjective(
+          vertices, cost_map, overlay, source_population, precision));
+    }
+
+    // Keeps every other proposal, so the later ones start from a mutated cost
+    // map.
+    edge_set_state.Commit(proposal);
+    RevertibleEfficiencyMutation revertible(std::move(proposal.mutation),
+                                            cost_map);
+    ApplyMutation(revertible, topology, &cost_map);
+    for (unsigned p = 0; p < kPrecisions.size(); ++p) {
+      BOOST_CHECK_EQUAL(overlaid_scores[p],
+                        EvaluateEfficiencyObjective(vertices, cost_map,
+                                                    source_population,
+                                                    kPrecisions[p]));
+    }
+    if (i % 2 == 1) {
+      edge_set_state.Revert();
+      RevertMutation(revertible, &cost_map);
+    }
+  }
+}
+
 } // namespace
 } // namespace procedural
 } // namespace e8
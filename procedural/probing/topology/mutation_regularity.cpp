@@ -51,7 +51,7 @@ RevertibleRegularityMutation::RevertibleRegularityMutation(
 }
 
 RegularityScore ApplyMutation(RevertibleRegularityMutation const &revertible,
-                              Topology *topology,
+                              VertexStore const &vertices, Topology *topology,
                               RegularityScoreMap *score_map) {
   for (auto addition : revertible.mutation.additions) {
     auto [u, v] = addition;
@@ -74,7 +74,7 @@ RegularityScore ApplyMutation(RevertibleRegularityMutation const &revertible,
     assert(vertex < boost::num_vertices(*topology));
 
     float old_score = (*score_map)[vertex];
-    float new_score = RegularityObjectiveAt(vertex, *topology);
+    float new_score = RegularityObjectiveAt(vertex, *topology, vertices);
     score_diff += new_score - old_score;
 
     (*score_map)[vertex] = new_score;
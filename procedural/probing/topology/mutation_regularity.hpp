@@ -50,7 +50,7 @@ struct RevertibleRegularityMutation {
 // returns the updated objective score. It assumes the mutation is derived from
 // the current state of the topology.
 RegularityScore ApplyMutation(RevertibleRegularityMutation const &revertible,
-                              Topology *topology,
+                              VertexStore const &vertices, Topology *topology,
                               RegularityScoreMap *score_map);
 
 // Reverts the mutation previously applied to the topology and the regularity
@@ -30,7 +30,8 @@ namespace {
 BOOST_AUTO_TEST_CASE(WhenMutateGridTopology_ThenCheckRevertible) {
   Topology grid = testing::CreateGridTopology(/*side=*/3, /*scale=*/1000.f,
                                               /*population=*/1e3f);
-  RegularityScoreMap score_map = CreateRegularityScoreMapFor(grid);
+  VertexStore vertices = CreateVertexStoreFor(grid);
+  RegularityScoreMap score_map = CreateRegularityScoreMapFor(grid, vertices);
   float score = EvaluateRegularityObjective(score_map);
 
   Mutation mutation(/*num_additions=*/1, /*num_deletions=*/1);
@@ -55,7 +56,8 @@ BOOST_AUTO_TEST_CASE(WhenMutateGridTopology_ThenCheckRevertible) {
 BOOST_AUTO_TEST_CASE(WhenApplyAndRevertMutation_ThenCheckTopologyAndScore) {
   Topology grid = testing::CreateGridTopology(/*side=*/3, /*scale=*/1000.f,
                                               /*population=*/1e3f);
-  RegularityScoreMap score_map = CreateRegularityScoreMapFor(grid);
+  VertexStore vertices = CreateVertexStoreFor(grid);
+  RegularityScoreMap score_map = CreateRegularityScoreMapFor(grid, vertices);
   float score = EvaluateRegularityObjective(score_map);
 
   Mutation mutation(/*num_additions=*/1, /*num_deletions=*/1);
@@ -64,7 +66,7 @@ BOOST_AUTO_TEST_CASE(WhenApplyAndRevertMutation_ThenCheckTopologyAndScore) {
 
   RevertibleRegularityMutation revertible(std::move(mutation), score_map,
                                           score);
-  double new_score = ApplyMutation(revertible, &grid, &score_map);
+  double new_score = ApplyMutation(revertible, vertices, &grid, &score_map);
   BOOST_CHECK_CLOSE(-5.8f, new_score, 1.f);
   BOOST_CHECK_EQUAL(4, boost::num_edges(grid));
   BOOST_CHECK(boost::edge(0, 1, grid).second);
@@ -15,6 +15,12 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/topology/objective_efficiency.hpp"
+#include "procedural/probing/kernel/likelihood.hpp"
+#include "procedural/probing/parallel/parallel.hpp"
+#include "procedural/probing/path/delta_stepping.hpp"
+#include "procedural/probing/path/graph.hpp"
+#include "procedural/probing/path/multi_source.hpp"
+#include "procedural/probing/path/quantized.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/sampler.hpp"
 #include <algorithm>
@@ -22,9 +28,12 @@
 #include <boost/graph/dijkstra_shortest_paths.hpp>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <eigen3/Eigen/Core>
-#include <numbers>
+#include <functional>
+#include <queue>
 #include <random>
+#include <utility>
 #include <vector>
 
 namespace e8 {
@@ -47,6 +56,11 @@ constexpr float const kAcos04 = 1.159279481f;
 constexpr float const kAcos10 = 0.0f;
 constexpr float const kMaxTolerableTravelTimeSeconds = 3600.0f;
 
+unsigned const kMinEdgesPerChunk = 4096;
+
+// Below this size, a search is too short to be worth sharing amongst workers.
+unsigned const kMinVerticesPerParallelSearch = 1 << 14;
+
 float EstimateAverageSpeed(float local_population) {
   constexpr float scale = kLog9 / (kP10Population - kP50Population);
   float interpolant =
@@ -72,44 +86,294 @@ float EstimateAverageWaitTime(unsigned intersection_size) {
   }
 }
 
-float EstimateLikelihoodToTravel(float time_cost) {
-  assert(time_cost >= 0.0);
+TravelLikelihoodKernel const kTravelLikelihood(
+    /*phi=*/-kAcos10,
+    /*max_time_seconds=*/kMaxTolerableTravelTimeSeconds);
+
+float PopulationTrasnportedFromSource(unsigned source_index,
+                                      std::vector<float> const &target_costs,
+                                      VertexStore const &vertices) {
+  assert(target_costs.size() == vertices.size());
+
+  float proportion_transported =
+      kTravelLikelihood.MultiplyAccumulate(target_costs, vertices.importance);
+  return proportion_transported * vertices.local_population[source_index];
+}
 
-  if (time_cost > kMaxTolerableTravelTimeSeconds) {
-    return 0;
+// Lays the cost map out for the searches under path/. Every connection makes
+// an arc in both directions.
+PathGraph CreatePathGraph(EfficiencyCostMap const &cost_map) {
+  PathGraph graph;
+  graph.first_arcs.reserve(boost::num_vertices(cost_map) + 1);
+  graph.heads.reserve(2 * boost::num_edges(cost_map));
+  graph.costs.reserve(2 * boost::num_edges(cost_map));
+  graph.first_arcs.push_back(0);
+  for (unsigned v = 0; v < boost::num_vertices(cost_map); ++v) {
+    for (auto [current, end] = boost::out_edges(v, cost_map); current != end;
+         ++current) {
+      graph.heads.push_back(boost::target(*current, cost_map));
+      graph.costs.push_back(
+          boost::get(boost::edge_weight_t(), cost_map, *current));
+    }
+    graph.first_arcs.push_back(graph.heads.size());
   }
+  return graph;
+}
 
-  constexpr float phi = -kAcos10;
-  constexpr float omega =
-      (std::numbers::pi - phi) / kMaxTolerableTravelTimeSeconds;
-  return 0.5 * (1 + std::cos(omega * time_cost + phi));
+using SampleFn =
+    std::function<void(SourceSamplerInterface::Sample const &sample,
+                       std::vector<float> const &min_time_costs)>;
+
+// Same as SearchFromSamples() below, with quantized time costs.
+template <typename Tick>
+void SearchQuantizedFromSamples(
+    PathGraph const &path_graph,
+    std::vector<SourceSamplerInterface::Sample> const &samples,
+    SampleFn const &sample_fn) {
+  QuantizedPathGraph<Tick> graph = QuantizePathGraph<Tick>(path_graph);
+  Tick horizon = QuantizeTimeCost<Tick>(kMaxTolerableTravelTimeSeconds);
+
+  std::vector<Tick> min_ticks;
+  std::vector<float> min_time_costs;
+  for (auto const &sample : samples) {
+    assert(sample.source_index < graph.VertexCount());
+    BucketQueueShortestPaths(graph, sample.source_index, horizon, &min_ticks);
+    DequantizeTimeCosts(min_ticks, &min_time_costs);
+    sample_fn(sample, min_time_costs);
+  }
 }
 
-EfficiencyCostMap
-CreateEfficiencyCostMapWithConnections(Topology const &topology) {
-  assert(boost::num_vertices(topology) > 0);
-  EfficiencyCostMap result(boost::num_vertices(topology));
+// Searches the shortest paths from every sample, then calls
+// sample_fn(sample, min_time_costs) in the order of the samples. The time costs
+// beyond the horizon may be left out, which makes no difference to the travel
+// likelihood.
+void SearchFromSamples(
+    EfficiencyCostMap const &cost_map,
+    std::vector<SourceSamplerInterface::Sample> const &samples,
+    TimeCostPrecision precision, bool search_source_blocks,
+    SampleFn const &sample_fn) {
+  unsigned vertex_count = boost::num_vertices(cost_map);
 
-  auto [current, end] = boost::edges(topology);
-  for (; current != end; ++current) {
-    assert(!boost::edge(current->m_source, current->m_target, result).second);
-    boost::add_edge(current->m_source, current->m_target, result);
+  switch (precision) {
+  case TimeCostPrecision::kDecisecond16:
+    SearchQuantizedFromSamples<std::uint16_t>(CreatePathGraph(cost_map),
+                                              samples, sample_fn);
+    return;
+  case TimeCostPrecision::kDecisecond32:
+    SearchQuantizedFromSamples<std::uint32_t>(CreatePathGraph(cost_map),
+                                              samples, sample_fn);
+    return;
+  case TimeCostPrecision::kFloat:
+    break;
   }
 
-  return result;
+  std::vector<float> min_time_costs(vertex_count);
+  if (samples.size() < ParallelWorkerCount() &&
+      vertex_count >= kMinVerticesPerParallelSearch) {
+    // When there are too few samples to keep every worker busy, the workers
+    // share each search of a large map instead.
+    PathGraph path_graph = CreatePathGraph(cost_map);
+    float bucket_width = SuitableBucketWidth(path_graph);
+    for (auto const &sample : samples) {
+      assert(sample.source_index < vertex_count);
+      DeltaSteppingShortestPaths(path_graph, sample.source_index, bucket_width,
+                                 /*horizon=*/kMaxTolerableTravelTimeSeconds,
+                                 &min_time_costs);
+      sample_fn(sample, min_time_costs);
+    }
+    return;
+  }
+
+  if (!search_source_blocks) {
+    for (auto const &sample : samples) {
+      assert(sample.source_index < vertex_count);
+      EfficiencyCostMap::vertex_descriptor source =
+          boost::vertex(sample.source_index, cost_map);
+      boost::dijkstra_shortest_paths(cost_map, source,
+                                     boost::distance_map(&min_time_costs[0]));
+      sample_fn(sample, min_time_costs);
+    }
+    return;
+  }
+
+  // The samples are searched a block at a time, sharing the traversal of the
+  // cost map.
+  PathGraph path_graph = CreatePathGraph(cost_map);
+  std::vector<unsigned> sources;
+  std::vector<float> block_time_costs;
+  for (unsigned begin = 0; begin < samples.size(); begin += kSourceBlockSize) {
+    unsigned end = std::min<unsigned>(samples.size(), begin + kSourceBlockSize);
+    sources.clear();
+    for (unsigned i = begin; i < end; ++i) {
+      assert(samples[i].source_index < vertex_count);
+      sources.push_back(samples[i].source_index);
+    }
+    MultiSourceShortestPaths(path_graph, sources,
+                             /*horizon=*/kMaxTolerableTravelTimeSeconds,
+                             &block_time_costs);
+
+    unsigned const K = sources.size();
+    for (unsigned k = 0; k < K; ++k) {
+      for (unsigned v = 0; v < vertex_count; ++v) {
+        min_time_costs[v] = block_time_costs[v * K + k];
+      }
+      sample_fn(samples[begin + k], min_time_costs);
+    }
+  }
 }
 
-float PopulationTrasnportedFromSource(unsigned source_index,
-                                      std::vector<float> const &target_costs,
-                                      Topology const &topology) {
-  assert(target_costs.size() == boost::num_vertices(topology));
+// Same as boost::dijkstra_shortest_paths() over the cost map, except that the
+// connections of the probes in the overlay are read from it instead. The time
+// costs beyond the horizon are left unreached.
+void OverlaidShortestPaths(EfficiencyCostMap const &cost_map,
+                           EfficiencyCostOverlay const &overlay,
+                           unsigned source, float horizon,
+                           std::vector<float> *min_time_costs) {
+  using QueueEntry = std::pair<float, unsigned>;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>>
+      queue;
+  auto relax = [horizon, min_time_costs, &queue](unsigned head,
+                                                 float time_cost) {
+    if (time_cost < (*min_time_costs)[head] && time_cost <= horizon) {
+      (*min_time_costs)[head] = time_cost;
+      queue.push(QueueEntry(time_cost, head));
+    }
+  };
+
+  min_time_costs->assign(boost::num_vertices(cost_map), kUnreachedTimeCost);
+  relax(source, 0.0f);
+  while (!queue.empty()) {
+    auto [time_cost, v] = queue.top();
+    queue.pop();
+    if (time_cost > (*min_time_costs)[v]) {
+      // Superseded by a shorter path.
+      continue;
+    }
+
+    auto overlaid = overlay.find(v);
+    if (overlaid != overlay.end()) {
+      for (auto const &[neighbor, edge_cost] : overlaid->second) {
+        relax(neighbor, time_cost + edge_cost);
+      }
+      continue;
+    }
+    for (auto [current, end] = boost::out_edges(v, cost_map); current != end;
+         ++current) {
+      relax(boost::target(*current, cost_map),
+            time_cost +
+                boost::get(boost::edge_weight_t(), cost_map, *current));
+    }
+  }
+}
+
+// Same as OverlaidShortestPaths(), with the time costs quantized like
+// BucketQueueShortestPaths() does. The arc costs are quantized by
+// QuantizeArcCost() as they're relaxed, and the queue holds a bucket for each
+// quantum up to the horizon. The buckets are left empty for the next search.
+template <typename Tick>
+void OverlaidQuantizedShortestPaths(EfficiencyCostMap const &cost_map,
+                                    EfficiencyCostOverlay const &overlay,
+                                    unsigned source, Tick horizon,
+                                    std::vector<std::vector<unsigned>> *buckets,
+                                    std::vector<Tick> *ticks) {
+  assert(horizon < kUnreachedTicks<Tick>);
+
+  unsigned queued = 0;
+  auto relax = [horizon, buckets, ticks, &queued](unsigned head,
+                                                  std::uint64_t candidate) {
+    if (candidate <= horizon && candidate < (*ticks)[head]) {
+      (*ticks)[head] = static_cast<Tick>(candidate);
+      (*buckets)[candidate].push_back(head);
+      ++queued;
+    }
+  };
+
+  ticks->assign(boost::num_vertices(cost_map), kUnreachedTicks<Tick>);
+  buckets->resize(static_cast<std::size_t>(horizon) + 1);
+  relax(source, 0);
+  for (unsigned d = 0; queued > 0 && d <= horizon; ++d) {
+    std::vector<unsigned> &bucket = (*buckets)[d];
+
+    // Zero cost arcs append to the bucket being scanned, so its size is read
+    // on every iteration.
+    for (unsigned i = 0; i < bucket.size(); ++i) {
+      unsigned u = bucket[i];
+      if ((*ticks)[u] != d) {
+        // It was lowered into an earlier bucket after being queued here.
+        continue;
+      }
+
+      auto overlaid = overlay.find(u);
+      if (overlaid != overlay.end()) {
+        for (auto const &[neighbor, edge_cost] : overlaid->second) {
+          relax(neighbor, static_cast<std::uint64_t>(d) +
+                              QuantizeArcCost<Tick>(edge_cost));
+        }
+        continue;
+      }
+      for (auto [current, end] = boost::out_edges(u, cost_map); current != end;
+           ++current) {
+        relax(boost::target(*current, cost_map),
+              static_cast<std::uint64_t>(d) +
+                  QuantizeArcCost<Tick>(boost::get(boost::edge_weight_t(),
+                                                   cost_map, *current)));
+      }
+    }
+
+    queued -= bucket.size();
+    bucket.clear();
+  }
+}
+
+// Same as SearchOverlaidFromSamples() below, with quantized time costs.
+template <typename Tick>
+void SearchOverlaidQuantizedFromSamples(
+    EfficiencyCostMap const &cost_map, EfficiencyCostOverlay const &overlay,
+    std::vector<SourceSamplerInterface::Sample> const &samples,
+    SampleFn const &sample_fn) {
+  Tick horizon = QuantizeTimeCost<Tick>(kMaxTolerableTravelTimeSeconds);
+
+  std::vector<std::vector<unsigned>> buckets;
+  std::vector<Tick> min_ticks;
+  std::vector<float> min_time_costs;
+  for (auto const &sample : samples) {
+    assert(sample.source_index < boost::num_vertices(cost_map));
+    OverlaidQuantizedShortestPaths(cost_map, overlay, sample.source_index,
+                                   horizon, &buckets, &min_ticks);
+    DequantizeTimeCosts(min_ticks, &min_time_costs);
+    sample_fn(sample, min_time_costs);
+  }
+}
+
+// Same as SearchFromSamples(), over the cost map under the overlay. The time
+// costs are the same as the ones of SearchFromSamples() over the cost map the
+// overlay stands for, at the same precision.
+void SearchOverlaidFromSamples(
+    EfficiencyCostMap const &cost_map, EfficiencyCostOverlay const &overlay,
+    std::vector<SourceSamplerInterface::Sample> const &samples,
+    TimeCostPrecision precision, SampleFn const &sample_fn) {
+  switch (precision) {
+  case TimeCostPrecision::kDecisecond16:
+    SearchOverlaidQuantizedFromSamples<std::uint16_t>(cost_map, overlay,
+                                                      samples, sample_fn);
+    return;
+  case TimeCostPrecision::kDecisecond32:
+    SearchOverlaidQuantizedFromSamples<std::uint32_t>(cost_map, overlay,
+                                                      samples, sample_fn);
+    return;
+  case TimeCostPrecision::kFloat:
+    break;
+  }
 
-  float proportion_transported = 0.0f;
-  for (unsigned i = 0; i < target_costs.size(); ++i) {
-    proportion_transported +=
-        EstimateLikelihoodToTravel(target_costs[i]) * topology[i].importance;
+  std::vector<float> min_time_costs;
+  for (auto const &sample : samples) {
+    assert(sample.source_index < boost::num_vertices(cost_map));
+    OverlaidShortestPaths(cost_map, overlay, sample.source_index,
+                          /*horizon=*/kMaxTolerableTravelTimeSeconds,
+                          &min_time_costs);
+    sample_fn(sample, min_time_costs);
   }
-  return proportion_transported * topology[source_index].local_population;
 }
 
 } // namespace
@@ -129,8 +393,13 @@ float EstimateWaitTimeCost(unsigned u, unsigned v,
   assert(u < boost::num_vertices(cost_map));
   assert(v < boost::num_vertices(cost_map));
 
-  return 0.5 * (EstimateAverageWaitTime(boost::degree(u, cost_map)) +
-                EstimateAverageWaitTime(boost::degree(v, cost_map)));
+  return EstimateWaitTimeCostByDegrees(boost::degree(u, cost_map),
+                                       boost::degree(v, cost_map));
+}
+
+float EstimateWaitTimeCostByDegrees(unsigned u_degree, unsigned v_degree) {
+  return 0.5 * (EstimateAverageWaitTime(u_degree) +
+                EstimateAverageWaitTime(v_degree));
 }
 
 float TotalTimeCost(float travel_time_cost, float wait_time_cost) {
@@ -138,50 +407,122 @@ float TotalTimeCost(float travel_time_cost, float wait_time_cost) {
 }
 
 EfficiencyCostMap CreateEfficiencyCostMapForTopology(Topology const &topology) {
-  EfficiencyCostMap result = CreateEfficiencyCostMapWithConnections(topology);
-
-  auto [current, end] = boost::edges(result);
-  for (; current != end; ++current) {
-    assert(current->m_source < boost::num_vertices(topology));
-    assert(current->m_target < boost::num_vertices(topology));
-
-    auto [topology_edge, existence] =
-        boost::edge(current->m_source, current->m_target, topology);
-    assert(existence);
-
-    float travel_time_cost =
-        EstimateTravelTimeCost(current->m_source, current->m_target, topology);
-    float wait_time_cost =
-        EstimateWaitTimeCost(current->m_source, current->m_target, result);
-    boost::put(boost::edge_weight_t(), result, *current,
-               TotalTimeCost(travel_time_cost, wait_time_cost));
+  assert(boost::num_vertices(topology) > 0);
+  EfficiencyCostMap result(boost::num_vertices(topology));
+
+  std::vector<EfficiencyCostMap::edge_descriptor> edges;
+  edges.reserve(boost::num_edges(topology));
+  for (auto [current, end] = boost::edges(topology); current != end;
+       ++current) {
+    edges.push_back(
+        boost::add_edge(current->m_source, current->m_target, result).first);
   }
 
+  // The connections are final, so the edge costs can be computed
+  // independently.
+  ParallelForChunks(
+      edges.size(),
+      [&topology, &edges, &result](unsigned, unsigned begin, unsigned end) {
+        for (unsigned i = begin; i < end; ++i) {
+          unsigned u = edges[i].m_source;
+          unsigned v = edges[i].m_target;
+          float travel_time_cost = EstimateTravelTimeCost(u, v, topology);
+          float wait_time_cost = EstimateWaitTimeCost(u, v, result);
+          boost::put(boost::edge_weight_t(), result, edges[i],
+                     TotalTimeCost(travel_time_cost, wait_time_cost));
+        }
+      },
+      kMinEdgesPerChunk);
+
   return result;
 }
 
-float EvaluateEfficiencyObjective(
-    Topology const &topology, EfficiencyCostMap const &cost_map,
-    SourceSamplerInterface const &source_sampler) {
-  assert(boost::num_vertices(topology) == boost::num_vertices(cost_map));
+float EvaluateEfficiencyObjective(VertexStore const &vertices,
+                                  EfficiencyCostMap const &cost_map,
+                                  SourceSamplerInterface const &source_sampler,
+                                  TimeCostPrecision precision,
+                                  bool search_source_blocks) {
+  assert(vertices.size() == boost::num_vertices(cost_map));
   assert(boost::num_vertices(cost_map) > 0);
 
   float transported = 0.0f;
-  std::vector<float> min_time_costs(boost::num_vertices(cost_map));
-  for (auto const &sample : source_sampler.SourceSamples()) {
-    assert(sample.source_index < boost::num_vertices(cost_map));
-    EfficiencyCostMap::vertex_descriptor source =
-        boost::vertex(sample.source_index, cost_map);
-    boost::dijkstra_shortest_paths(cost_map, source,
-                                   boost::distance_map(&min_time_costs[0]));
-
-    transported += sample.frequency * sample.correction *
-                   PopulationTrasnportedFromSource(sample.source_index,
-                                                   min_time_costs, topology);
-  }
+  SearchFromSamples(
+      cost_map, source_sampler.SourceSamples(), precision,
+      search_source_blocks,
+      [&vertices, &transported](SourceSamplerInterface::Sample const &sample,
+                                std::vector<float> const &min_time_costs) {
+        transported += sample.frequency * sample.correction *
+                       PopulationTrasnportedFromSource(
+                           sample.source_index, min_time_costs, vertices);
+      });
+  return transported / source_sampler.SampleCount();
+}
 
+float EvaluateEfficiencyObjective(VertexStore const &vertices,
+                                  EfficiencyCostMap const &cost_map,
+                                  EfficiencyCostOverlay const &overlay,
+                                  SourceSamplerInterface const &source_sampler,
+                                  TimeCostPrecision precision) {
+  assert(vertices.size() == boost::num_vertices(cost_map));
+  assert(boost::num_vertices(cost_map) > 0);
+
+  float transported = 0.0f;
+  SearchOverlaidFromSamples(
+      cost_map, overlay, source_sampler.SourceSamples(), precision,
+      [&vertices, &transported](SourceSamplerInterface::Sample const &sample,
+                                std::vector<float> const &min_time_costs) {
+        transported += sample.frequency * sample.correction *
+                       PopulationTrasnportedFromSource(
+                           sample.source_index, min_time_costs, vertices);
+      });
   return transported / source_sampler.SampleCount();
 }
 
+std::vector<float> EvaluateEfficiencyObjectives(
+    std::vector<std::vector<float>> const &local_populations,
+    std::vector<std::vector<float>> const &importances,
+    EfficiencyCostMap const &cost_map,
+    SourceSamplerInterface const &source_sampler, TimeCostPrecision precision,
+    bool search_source_blocks) {
+  assert(local_populations.size() == importances.size());
+  assert(boost::num_vertices(cost_map) > 0);
+  for (unsigned m = 0; m < importances.size(); ++m) {
+    assert(local_populations[m].size() == boost::num_vertices(cost_map));
+    assert(importances[m].size() == boost::num_vertices(cost_map));
+  }
+
+  std::vector<float> transported(importances.size(), 0.0f);
+  std::vector<float> proportions_transported;
+  SearchFromSamples(
+      cost_map, source_sampler.SourceSamples(), precision,
+      search_source_blocks,
+      [&local_populations, &importances, &transported,
+       &proportions_transported](SourceSamplerInterface::Sample const &sample,
+                                 std::vector<float> const &min_time_costs) {
+        kTravelLikelihood.MultiplyAccumulate(min_time_costs, importances,
+                                             &proportions_transported);
+        for (unsigned m = 0; m < importances.size(); ++m) {
+          transported[m] += sample.frequency * sample.correction *
+                            proportions_transported[m] *
+                            local_populations[m][sample.source_index];
+        }
+      });
+
+  for (float &objective : transported) {
+    objective /= source_sampler.SampleCount();
+  }
+  return transported;
+}
+
+float EvaluateEfficiencyObjective(Topology const &topology,
+                                  EfficiencyCostMap const &cost_map,
+                                  SourceSamplerInterface const &source_sampler,
+                                  TimeCostPrecision precision,
+                                  bool search_source_blocks) {
+  return EvaluateEfficiencyObjective(CreateVertexStoreFor(topology), cost_map,
+                                     source_sampler, precision,
+                                     search_source_blocks);
+}
+
 } // namespace procedural
 } // namespace e8
@@ -16,10 +16,13 @@
 
 #pragma once
 
+#include "procedural/probing/path/quantized.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/sampler.hpp"
 #include <boost/graph/adjacency_list.hpp>
 #include <random>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace e8 {
@@ -34,6 +37,12 @@ using EfficiencyCostMap = boost::adjacency_list<
     /*DirectedS=*/boost::undirectedS, /*VertexProperty=*/boost::no_property,
     /*EdgeProperty=*/EfficiencyCost>;
 
+// The connections of the few probes a mutation touches, which replace theirs
+// in the cost map, so the mutated cost map can be searched without being
+// copied. Each connection is a pair of (neighbor, edge cost).
+using EfficiencyCostOverlay =
+    std::unordered_map<unsigned, std::vector<std::pair<unsigned, float>>>;
+
 // Estimates the number of seconds needed to travel from u to v, or in the
 // opposite direction, based on the size of the local population at u and v.
 // This estimate assumes there is a direct connection between u and v, and is
@@ -45,6 +54,10 @@ float EstimateTravelTimeCost(unsigned u, unsigned v, Topology const &topology);
 float EstimateWaitTimeCost(unsigned u, unsigned v,
                            EfficiencyCostMap const &cost_map);
 
+// Same as above, given the degrees of u and v instead, e.g. the ones they
+// would have after a mutation.
+float EstimateWaitTimeCostByDegrees(unsigned u_degree, unsigned v_degree);
+
 // Calculate the total edge cost, measured in seconds, based on the travel and
 // wait time.
 float TotalTimeCost(float travel_time_cost, float wait_time_cost);
@@ -74,10 +87,54 @@ EfficiencyCostMap CreateEfficiencyCostMapForTopology(Topology const &topology);
 // objective. The source_sampler allows this function to be evaluated on samples
 // of sources, bringing the complexity down to O(|S||E|log(|E|)), where S is the
 // sample set. Note, the sampled objective is an unbiased estimate, therefore
-// the values amongst different sample sets can be compared.
-float EvaluateEfficiencyObjective(Topology const &topology,
-                                  EfficiencyCostMap const &cost_map,
-                                  SourceSamplerInterface const &source_sampler);
+// the values amongst different sample sets can be compared. The samples are
+// searched one at a time. When search_source_blocks is set, the samples are
+// searched kSourceBlockSize at a time instead, see
+// MultiSourceShortestPaths(). When there are fewer samples than workers over
+// a large map, the workers share the search of each sample instead, see
+// DeltaSteppingShortestPaths(). With a quantized precision, every sample is
+// searched with a bucket queue over integer deciseconds instead, see
+// BucketQueueShortestPaths().
+float EvaluateEfficiencyObjective(
+    VertexStore const &vertices, EfficiencyCostMap const &cost_map,
+    SourceSamplerInterface const &source_sampler,
+    TimeCostPrecision precision = kDefaultTimeCostPrecision,
+    bool search_source_blocks = false);
+
+// Evaluates the above objective under several weightings at once, where C(s)
+// and f_X(t) are taken from local_populations[m] and importances[m] for the
+// m-th objective. The shortest paths from every sample are searched once and
+// shared amongst the weightings, so it costs about the same as a single
+// evaluation. The samples are drawn from one population only, so the
+// estimate stays unbiased for the others, but its variance grows as they
+// depart from it.
+std::vector<float> EvaluateEfficiencyObjectives(
+    std::vector<std::vector<float>> const &local_populations,
+    std::vector<std::vector<float>> const &importances,
+    EfficiencyCostMap const &cost_map,
+    SourceSamplerInterface const &source_sampler,
+    TimeCostPrecision precision = kDefaultTimeCostPrecision,
+    bool search_source_blocks = false);
+
+// Same as the first one, over the cost map under the overlay. Every sample is
+// searched up to the travel time horizon, by Dijkstra's algorithm or, with a
+// quantized precision, by a bucket queue. The score is the same as the first
+// one's over the cost map the overlay stands for, at the same precision. The
+// cost map is only read, so the evaluations of different overlays may run
+// concurrently.
+float EvaluateEfficiencyObjective(
+    VertexStore const &vertices, EfficiencyCostMap const &cost_map,
+    EfficiencyCostOverlay const &overlay,
+    SourceSamplerInterface const &source_sampler,
+    TimeCostPrecision precision = kDefaultTimeCostPrecision);
+
+// Same as the first one, but reads the vertex properties from the topology.
+// Prefer the first one when evaluating the objective repeatedly.
+float EvaluateEfficiencyObjective(
+    Topology const &topology, EfficiencyCostMap const &cost_map,
+    SourceSamplerInterface const &source_sampler,
+    TimeCostPrecision precision = kDefaultTimeCostPrecision,
+    bool search_source_blocks = false);
 
 } // namespace procedural
 } // namespace e8
@@ -15,6 +15,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define BOOST_TEST_MAIN
+#include "procedural/probing/parallel/parallel.hpp"
+#include "procedural/probing/path/quantized.hpp"
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/objective_efficiency.hpp"
 #include "procedural/probing/topology/sampler.hpp"
@@ -118,6 +121,24 @@ BOOST_AUTO_TEST_CASE(
   BOOST_CHECK_CLOSE(140, cost_23, 1);
 }
 
+BOOST_AUTO_TEST_CASE(WhenTopologyIsLarge_ThenCheckEfficiencyCostMapPerEdge) {
+  Topology topology = testing::CreateMeshTopology(/*side=*/60, /*scale=*/1e3f,
+                                                  /*population=*/4e5);
+  EfficiencyCostMap cost_map = CreateEfficiencyCostMapForTopology(topology);
+  BOOST_CHECK_EQUAL(boost::num_edges(topology), boost::num_edges(cost_map));
+
+  for (auto [current, end] = boost::edges(cost_map); current != end;
+       ++current) {
+    unsigned u = current->m_source;
+    unsigned v = current->m_target;
+    float expected_cost =
+        TotalTimeCost(EstimateTravelTimeCost(u, v, topology),
+                      EstimateWaitTimeCost(u, v, cost_map));
+    BOOST_CHECK_EQUAL(expected_cost,
+                      boost::get(boost::edge_weight_t(), cost_map, *current));
+  }
+}
+
 BOOST_AUTO_TEST_CASE(WhenEvaluateFullObjective_ThenCheckScore) {
   Topology topology = testing::CreateGridTopology(/*side=*/5, /*scale=*/1e3f,
                                                   /*population=*/4e3);
@@ -128,6 +149,97 @@ BOOST_AUTO_TEST_CASE(WhenEvaluateFullObjective_ThenCheckScore) {
   BOOST_CHECK_CLOSE(112, objective, 1);
 }
 
+BOOST_AUTO_TEST_CASE(WhenTimeCostsAreQuantized_ThenCheckScoreIsClose) {
+  Topology topology = testing::CreateMeshTopology(/*side=*/20, /*scale=*/1e3f,
+                                                  /*population=*/4e5);
+  EfficiencyCostMap cost_map = CreateEfficiencyCostMapForTopology(topology);
+
+  SourcePopulationSampler sampler(topology);
+  float objective = EvaluateEfficiencyObjective(topology, cost_map, sampler,
+                                                TimeCostPrecision::kFloat);
+  BOOST_CHECK_CLOSE(objective,
+                    EvaluateEfficiencyObjective(
+                        topology, cost_map, sampler,
+                        TimeCostPrecision::kDecisecond16),
+                    0.1f);
+  BOOST_CHECK_CLOSE(objective,
+                    EvaluateEfficiencyObjective(
+                        topology, cost_map, sampler,
+                        TimeCostPrecision::kDecisecond32),
+                    0.1f);
+}
+
+BOOST_AUTO_TEST_CASE(WhenSourcesAreSearchedInBlocks_ThenCheckScoreMatches) {
+  Topology topology = testing::CreateMeshTopology(/*side=*/20, /*scale=*/1e3f,
+                                                  /*population=*/4e5);
+  EfficiencyCostMap cost_map = CreateEfficiencyCostMapForTopology(topology);
+
+  SourcePopulationSampler sampler(topology);
+  BOOST_CHECK_CLOSE(EvaluateEfficiencyObjective(topology, cost_map, sampler,
+                                                TimeCostPrecision::kFloat),
+                    EvaluateEfficiencyObjective(
+                        topology, cost_map, sampler, TimeCostPrecision::kFloat,
+                        /*search_source_blocks=*/true),
+                    1e-3f);
+}
+
+BOOST_AUTO_TEST_CASE(WhenSearchesAreDeltaStepped_ThenCheckScoreMatches) {
+  // Large enough for the workers to share the search of each sample.
+  Topology topology = testing::CreateMeshTopology(/*side=*/130, /*scale=*/1e3f,
+                                                  /*population=*/4e5);
+  EfficiencyCostMap cost_map = CreateEfficiencyCostMapForTopology(topology);
+  SourceUniformSampler sampler(topology, /*sample_count=*/2, PhiloxEngine(13));
+  sampler.UpdateSamples();
+
+  // A single worker searches each sample by Dijkstra's algorithm, while more
+  // workers than samples share each search.
+  SetParallelThreadCount(1);
+  float sequential = EvaluateEfficiencyObjective(topology, cost_map, sampler,
+                                                 TimeCostPrecision::kFloat);
+  SetParallelThreadCount(4);
+  float parallel = EvaluateEfficiencyObjective(topology, cost_map, sampler,
+                                               TimeCostPrecision::kFloat);
+  SetParallelThreadCount(0);
+
+  BOOST_CHECK_GT(sequential, 0);
+  BOOST_CHECK_CLOSE(sequential, parallel, 1e-3f);
+}
+
+BOOST_AUTO_TEST_CASE(WhenWeightingsAreMany_ThenCheckEachObjective) {
+  Topology topology = testing::CreateMeshTopology(/*side=*/12, /*scale=*/1e3f,
+                                                  /*population=*/4e4);
+  EfficiencyCostMap cost_map = CreateEfficiencyCostMapForTopology(topology);
+  VertexStore vertices = CreateVertexStoreFor(topology);
+  SourcePopulationSampler sampler(topology);
+
+  // The original weighting, a doubled importance, and one where only the
+  // first half of the vertices matter.
+  VertexStore halved = vertices;
+  for (unsigned v = halved.size() / 2; v < halved.size(); ++v) {
+    halved.importance[v] = 0;
+  }
+  std::vector<float> doubled_importance = vertices.importance;
+  for (float &importance : doubled_importance) {
+    importance *= 2;
+  }
+
+  std::vector<float> objectives = EvaluateEfficiencyObjectives(
+      /*local_populations=*/{vertices.local_population,
+                             vertices.local_population,
+                             halved.local_population},
+      /*importances=*/
+      {vertices.importance, doubled_importance, halved.importance}, cost_map,
+      sampler);
+  BOOST_REQUIRE_EQUAL(3, objectives.size());
+
+  float objective = EvaluateEfficiencyObjective(vertices, cost_map, sampler);
+  BOOST_CHECK_CLOSE(objective, objectives[0], 1e-3f);
+  BOOST_CHECK_CLOSE(2 * objective, objectives[1], 1e-3f);
+  BOOST_CHECK_CLOSE(EvaluateEfficiencyObjective(halved, cost_map, sampler),
+                    objectives[2], 1e-3f);
+  BOOST_CHECK_LT(objectives[2], objective);
+}
+
 } // namespace
 } // namespace procedural
 } // namespace e8
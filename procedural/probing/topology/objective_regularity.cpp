@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/topology/objective_regularity.hpp"
+#include "procedural/probing/parallel/parallel.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include <algorithm>
 #include <boost/graph/adjacency_list.hpp>
@@ -26,12 +27,16 @@ namespace e8 {
 namespace procedural {
 namespace {
 
-RegularityScore MinimumDissimiarlity(unsigned u, Topology const &topology) {
+unsigned const kMinVerticesPerChunk = 4096;
+
+RegularityScore MinimumDissimiarlity(unsigned u, Topology const &topology,
+                                     VertexStore const &vertices) {
   auto [begin, end] = boost::adjacent_vertices(u, topology);
-  std::vector<Eigen::Vector3f> streets(boost::degree(u, topology));
-  Eigen::Vector3f const &origin = topology[u].location;
-  std::transform(begin, end, streets.begin(), [&origin, &topology](unsigned v) {
-    return (topology[v].location - origin).normalized();
+  std::vector<Eigen::Vector2f> streets(boost::degree(u, topology));
+  Eigen::Vector2f origin(vertices.x[u], vertices.y[u]);
+  std::transform(begin, end, streets.begin(), [&origin, &vertices](unsigned v) {
+    return (Eigen::Vector2f(vertices.x[v], vertices.y[v]) - origin)
+        .normalized();
   });
 
   RegularityScore min_dissim = std::numeric_limits<RegularityScore>::max();
@@ -45,13 +50,15 @@ RegularityScore MinimumDissimiarlity(unsigned u, Topology const &topology) {
 }
 
 RegularityScore
-RegularityObjectiveAt2WayIntersection(unsigned u, Topology const &topology) {
-  return 0.9f * MinimumDissimiarlity(u, topology);
+RegularityObjectiveAt2WayIntersection(unsigned u, Topology const &topology,
+                                      VertexStore const &vertices) {
+  return 0.9f * MinimumDissimiarlity(u, topology, vertices);
 }
 
 RegularityScore
-RegularityObjectiveAt3WayIntersection(unsigned u, Topology const &topology) {
-  float min_dissim = MinimumDissimiarlity(u, topology);
+RegularityObjectiveAt3WayIntersection(unsigned u, Topology const &topology,
+                                      VertexStore const &vertices) {
+  float min_dissim = MinimumDissimiarlity(u, topology, vertices);
   if (min_dissim < -.5f) {
     return -1.f;
   }
@@ -59,8 +66,9 @@ RegularityObjectiveAt3WayIntersection(unsigned u, Topology const &topology) {
 }
 
 RegularityScore
-RegularityObjectiveAt4WayIntersection(unsigned u, Topology const &topology) {
-  float min_dissim = MinimumDissimiarlity(u, topology);
+RegularityObjectiveAt4WayIntersection(unsigned u, Topology const &topology,
+                                      VertexStore const &vertices) {
+  float min_dissim = MinimumDissimiarlity(u, topology, vertices);
   if (min_dissim < -.5f) {
     return -1.f;
   }
@@ -69,28 +77,36 @@ RegularityObjectiveAt4WayIntersection(unsigned u, Topology const &topology) {
 
 } // namespace
 
-RegularityScore RegularityObjectiveAt(unsigned u, Topology const &topology) {
+RegularityScore RegularityObjectiveAt(unsigned u, Topology const &topology,
+                                      VertexStore const &vertices) {
   switch (boost::degree(u, topology)) {
   case 0:
     return -1.f;
   case 1:
     return -.9f;
   case 2:
-    return RegularityObjectiveAt2WayIntersection(u, topology);
+    return RegularityObjectiveAt2WayIntersection(u, topology, vertices);
   case 3:
-    return RegularityObjectiveAt3WayIntersection(u, topology);
+    return RegularityObjectiveAt3WayIntersection(u, topology, vertices);
   case 4:
-    return RegularityObjectiveAt4WayIntersection(u, topology);
+    return RegularityObjectiveAt4WayIntersection(u, topology, vertices);
   default:
     return -1.5f;
   }
 }
 
-RegularityScoreMap CreateRegularityScoreMapFor(Topology const &topology) {
+RegularityScoreMap CreateRegularityScoreMapFor(Topology const &topology,
+                                               VertexStore const &vertices) {
   RegularityScoreMap score_map(boost::num_vertices(topology));
-  for (unsigned i = 0; i < score_map.size(); ++i) {
-    score_map[i] = RegularityObjectiveAt(i, topology);
-  }
+  ParallelForChunks(
+      score_map.size(),
+      [&topology, &vertices, &score_map](unsigned, unsigned begin,
+                                         unsigned end) {
+        for (unsigned i = begin; i < end; ++i) {
+          score_map[i] = RegularityObjectiveAt(i, topology, vertices);
+        }
+      },
+      kMinVerticesPerChunk);
   return score_map;
 }
 
@@ -35,11 +35,14 @@ using RegularityScoreMap = std::vector<RegularityScore>;
 // three-way intersection, the three streets are expected to form a T shape. In
 // a four-way intersection, the four streets are expected to form a + shape.
 // Intersections with greater number of ways are more undesirable than those of
-// zero/one way.
-RegularityScore RegularityObjectiveAt(unsigned u, Topology const &topology);
+// zero/one way. The vertex locations are read from the vertex store, which
+// must be created from the topology.
+RegularityScore RegularityObjectiveAt(unsigned u, Topology const &topology,
+                                      VertexStore const &vertices);
 
 // Creates a score map from the specified topology.
-RegularityScoreMap CreateRegularityScoreMapFor(Topology const &topology);
+RegularityScoreMap CreateRegularityScoreMapFor(Topology const &topology,
+                                               VertexStore const &vertices);
 
 // Computes the total objective score for the entire score map. It basically
 // sums the objective scores over the vertices.
@@ -27,7 +27,8 @@ namespace {
 
 BOOST_AUTO_TEST_CASE(WhenAtZeroWayIntersection_ThenCheckRegularityScore) {
   Topology topology(1);
-  BOOST_CHECK_EQUAL(-1.f, RegularityObjectiveAt(0, topology));
+  BOOST_CHECK_EQUAL(
+      -1.f, RegularityObjectiveAt(0, topology, CreateVertexStoreFor(topology)));
 }
 
 BOOST_AUTO_TEST_CASE(WhenAtOneWayIntersection_ThenCheckRegularityScore) {
@@ -36,7 +37,8 @@ BOOST_AUTO_TEST_CASE(WhenAtOneWayIntersection_ThenCheckRegularityScore) {
   topology[1] = VertexProperties(Eigen::Vector3f(200, 0, 0), 0, 0);
   boost::add_edge(0, 1, topology);
 
-  BOOST_CHECK_EQUAL(-.9f, RegularityObjectiveAt(0, topology));
+  BOOST_CHECK_EQUAL(
+      -.9f, RegularityObjectiveAt(0, topology, CreateVertexStoreFor(topology)));
 }
 
 BOOST_AUTO_TEST_CASE(WhenAtTwoWayIntersection_ThenCheckRegularityScore) {
@@ -48,7 +50,9 @@ BOOST_AUTO_TEST_CASE(WhenAtTwoWayIntersection_ThenCheckRegularityScore) {
   boost::add_edge(0, 1, topology);
   boost::add_edge(0, 2, topology);
 
-  BOOST_CHECK_CLOSE(.64f, RegularityObjectiveAt(0, topology), 1.f);
+  BOOST_CHECK_CLOSE(
+      .64f, RegularityObjectiveAt(0, topology, CreateVertexStoreFor(topology)),
+      1.f);
 }
 
 BOOST_AUTO_TEST_CASE(
@@ -63,7 +67,9 @@ BOOST_AUTO_TEST_CASE(
   boost::add_edge(0, 2, topology);
   boost::add_edge(0, 3, topology);
 
-  BOOST_CHECK_CLOSE(.9f, RegularityObjectiveAt(0, topology), 1.f);
+  BOOST_CHECK_CLOSE(
+      .9f, RegularityObjectiveAt(0, topology, CreateVertexStoreFor(topology)),
+      1.f);
 }
 
 BOOST_AUTO_TEST_CASE(
@@ -78,7 +84,9 @@ BOOST_AUTO_TEST_CASE(
   boost::add_edge(0, 2, topology);
   boost::add_edge(0, 3, topology);
 
-  BOOST_CHECK_CLOSE(-1.f, RegularityObjectiveAt(0, topology), 1.f);
+  BOOST_CHECK_CLOSE(
+      -1.f, RegularityObjectiveAt(0, topology, CreateVertexStoreFor(topology)),
+      1.f);
 }
 
 BOOST_AUTO_TEST_CASE(
@@ -95,7 +103,9 @@ BOOST_AUTO_TEST_CASE(
   boost::add_edge(0, 3, topology);
   boost::add_edge(0, 4, topology);
 
-  BOOST_CHECK_CLOSE(1.f, RegularityObjectiveAt(0, topology), 1.f);
+  BOOST_CHECK_CLOSE(
+      1.f, RegularityObjectiveAt(0, topology, CreateVertexStoreFor(topology)),
+      1.f);
 }
 
 BOOST_AUTO_TEST_CASE(
@@ -112,13 +122,16 @@ BOOST_AUTO_TEST_CASE(
   boost::add_edge(0, 3, topology);
   boost::add_edge(0, 4, topology);
 
-  BOOST_CHECK_CLOSE(-1.f, RegularityObjectiveAt(0, topology), 1.f);
+  BOOST_CHECK_CLOSE(
+      -1.f, RegularityObjectiveAt(0, topology, CreateVertexStoreFor(topology)),
+      1.f);
 }
 
 BOOST_AUTO_TEST_CASE(WhenTopologyIsGrid_ThenCheckObjective) {
   Topology grid = testing::CreateGridTopology(/*side=*/10, /*scale=*/1000.f,
                                               /*population=*/1e3f);
-  RegularityScoreMap score_map = CreateRegularityScoreMapFor(grid);
+  RegularityScoreMap score_map =
+      CreateRegularityScoreMapFor(grid, CreateVertexStoreFor(grid));
   BOOST_CHECK_CLOSE(31.f, EvaluateRegularityObjective(score_map), 1.f);
 }
 
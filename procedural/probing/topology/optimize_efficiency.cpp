@@ -15,7 +15,11 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/topology/optimize_efficiency.hpp"
+#include "procedural/probing/parallel/parallel.hpp"
+#include "procedural/probing/random/philox.hpp"
+#include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/edge_set.hpp"
+#include "procedural/probing/topology/hill_climb.hpp"
 #include "procedural/probing/topology/mutation_efficiency.hpp"
 #include "procedural/probing/topology/objective_efficiency.hpp"
 #include <algorithm>
@@ -23,7 +27,11 @@
 #include <boost/log/trivial.hpp>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
 #include <utility>
+#include <vector>
 
 namespace e8 {
 namespace procedural {
@@ -72,44 +80,96 @@ Topology ToResultTopology(EfficiencyCostMap const &cost_map,
   return result;
 }
 
+// The objective policy of HillClimb() and HillClimbInBatches(), which climbs
+// the cost map. The proposals of a batch are scored through overlays of the
+// cost map, which is shared by the concurrent scorings and left unchanged.
+// Every score is evaluated at kDefaultTimeCostPrecision, so the overlaid ones
+// compare with the scores of the cost map itself.
+class EfficiencyObjectivePolicy {
+public:
+  EfficiencyObjectivePolicy(Topology const &topology,
+                            VertexStore const &vertices,
+                            SourcePopulationSampler const &source_population,
+                            EfficiencyCostMap *cost_map)
+      : topology_(topology), vertices_(vertices),
+        source_population_(source_population), cost_map_(cost_map) {}
+
+  float Apply(Mutation &&mutation) {
+    revertible_.emplace(std::move(mutation), *cost_map_);
+    ApplyMutation(*revertible_, topology_, cost_map_);
+    return EvaluateEfficiencyObjective(vertices_, *cost_map_,
+                                       source_population_);
+  }
+
+  void Revert() { RevertMutation(*revertible_, cost_map_); }
+
+  float Score(MutationProposal const &proposal) const {
+    return EvaluateEfficiencyObjective(
+        vertices_, *cost_map_,
+        CreateEfficiencyCostOverlay(proposal.mutation, topology_, *cost_map_),
+        source_population_);
+  }
+
+  void Commit(MutationProposal &&proposal) {
+    revertible_.emplace(std::move(proposal.mutation), *cost_map_);
+    ApplyMutation(*revertible_, topology_, cost_map_);
+  }
+
+  void ReportProgress(unsigned i, unsigned iteration_count, float score) {
+    procedural::ReportProgress(i, iteration_count, score,
+                               kMutationOperationCount,
+                               boost::num_edges(*cost_map_));
+  }
+
+private:
+  Topology const &topology_;
+  VertexStore const &vertices_;
+  SourcePopulationSampler const &source_population_;
+  EfficiencyCostMap *const cost_map_;
+  std::optional<RevertibleEfficiencyMutation> revertible_;
+};
+
 } // namespace
 
 OptimizeEfficiencyResult
 OptimizeEfficiency(Topology const &topology, unsigned iteration_count,
-                   std::default_random_engine *random_engine) {
-  EfficiencyCostMap cost_map = CreateEfficiencyCostMapForTopology(topology);
-  EdgeSetState edge_set_state = CreateEdgeSetStateFor(topology, random_engine);
+                   PhiloxEngine random_engine,
+                   unsigned speculation_count) {
+  assert(speculation_count > 0);
+  assert(static_cast<std::uint64_t>(iteration_count) * speculation_count <=
+         std::numeric_limits<std::uint32_t>::max());
+
+  std::vector<Edge> edges;
+  EfficiencyCostMap cost_map;
+  ParallelInvoke({
+      [&topology, &edges] { edges = EdgesOf(topology); },
+      [&topology, &cost_map] {
+        cost_map = CreateEfficiencyCostMapForTopology(topology);
+      },
+  });
+  EdgeSetState edge_set_state(std::move(edges));
   SourcePopulationSampler source_population(topology);
+  VertexStore vertices = CreateVertexStoreFor(topology);
 
-  EfficiencyCostMap best_cost_map = cost_map;
+  // The rejected mutations are reverted, or never applied, so the cost map
+  // always holds the best topology found so far.
   float best_score =
-      EvaluateEfficiencyObjective(topology, cost_map, source_population);
-
-  for (unsigned i = 0; i < iteration_count; ++i) {
-    unsigned operation_count = kMutationOperationCount;
-    ReportProgress(i, iteration_count, best_score, operation_count,
-                   boost::num_edges(cost_map));
-
-    Mutation mutation = edge_set_state.Mutate(operation_count);
-    RevertibleEfficiencyMutation revertible(std::move(mutation), cost_map);
-    ApplyMutation(revertible, topology, &cost_map);
-
-    float score =
-        EvaluateEfficiencyObjective(topology, cost_map, source_population);
-    if (score < best_score) {
-      RevertMutation(revertible, &cost_map);
-      edge_set_state.Revert();
-      continue;
-    }
-
-    best_cost_map = cost_map;
-    best_score = score;
+      EvaluateEfficiencyObjective(vertices, cost_map, source_population);
+  EfficiencyObjectivePolicy objective(topology, vertices, source_population,
+                                      &cost_map);
+  EdgeSetMutationPolicy mutation(kMutationOperationCount, random_engine,
+                                 &edge_set_state);
+  if (speculation_count > 1) {
+    HillClimbInBatches(iteration_count, speculation_count, best_score,
+                       &objective, &mutation);
+  } else {
+    HillClimb(iteration_count, best_score, &objective, &mutation);
   }
 
   return OptimizeEfficiencyResult{
-      .topology = ToResultTopology(best_cost_map, topology),
-      .score = EvaluateEfficiencyObjective(topology, best_cost_map,
-                                           source_population),
+      .topology = ToResultTopology(cost_map, topology),
+      .score =
+          EvaluateEfficiencyObjective(vertices, cost_map, source_population),
   };
 }
 
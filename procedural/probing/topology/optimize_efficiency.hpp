@@ -16,8 +16,8 @@
 
 #pragma once
 
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
-#include <random>
 
 namespace e8 {
 namespace procedural {
@@ -32,10 +32,16 @@ struct OptimizeEfficiencyResult {
 };
 
 // It performs combinatorial optimization over the efficiency objective on the
-// specified topology by hill climbing.
+// specified topology by hill climbing. When speculation_count is greater than
+// 1, every iteration evaluates that many independent mutations concurrently
+// and keeps the best one, if it doesn't lower the score, see
+// HillClimbInBatches(). The k-th mutation of
+// the i-th iteration draws from the (i * speculation_count + k)-th substream of
+// the random engine, so the result doesn't depend on the thread count.
 OptimizeEfficiencyResult
 OptimizeEfficiency(Topology const &topology, unsigned iteration_count,
-                   std::default_random_engine *random_engine);
+                   PhiloxEngine random_engine,
+                   unsigned speculation_count = 1);
 
 } // namespace procedural
 } // namespace e8
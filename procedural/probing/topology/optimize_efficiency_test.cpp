@@ -15,10 +15,13 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define BOOST_TEST_MAIN
+#include "procedural/probing/parallel/parallel.hpp"
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/optimize_efficiency.hpp"
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/test/unit_test.hpp>
+#include <vector>
 
 namespace e8 {
 namespace procedural {
@@ -27,13 +30,48 @@ namespace {
 BOOST_AUTO_TEST_CASE(WhenTopologyIsMeshGrid_ThenCheckEdgeCountIsLess) {
   Topology topology = testing::CreateMeshTopology(/*side=*/5, /*scale=*/1e3f,
                                                   /*population=*/4e3);
-  std::default_random_engine random_engine(13);
   OptimizeEfficiencyResult result =
-      OptimizeEfficiency(topology, /*iteration_count=*/10000, &random_engine);
+      OptimizeEfficiency(topology, /*iteration_count=*/10000, PhiloxEngine(13));
   BOOST_CHECK_CLOSE(147, result.score, 10);
   BOOST_CHECK_LT(boost::num_edges(result.topology), boost::num_edges(topology));
 }
 
+BOOST_AUTO_TEST_CASE(WhenMutationsAreSpeculated_ThenCheckScoreIsNotLowered) {
+  Topology topology = testing::CreateMeshTopology(/*side=*/5, /*scale=*/1e3f,
+                                                  /*population=*/4e3);
+  OptimizeEfficiencyResult initial =
+      OptimizeEfficiency(topology, /*iteration_count=*/0, PhiloxEngine(13));
+  OptimizeEfficiencyResult result =
+      OptimizeEfficiency(topology, /*iteration_count=*/2500, PhiloxEngine(13),
+                         /*speculation_count=*/4);
+  BOOST_CHECK_GE(result.score, initial.score);
+  BOOST_CHECK_CLOSE(147, result.score, 10);
+  BOOST_CHECK_LT(boost::num_edges(result.topology), boost::num_edges(topology));
+}
+
+BOOST_AUTO_TEST_CASE(WhenThreadCountChanges_ThenCheckSpeculationIsKept) {
+  Topology topology = testing::CreateMeshTopology(/*side=*/5, /*scale=*/1e3f,
+                                                  /*population=*/4e3);
+  std::vector<OptimizeEfficiencyResult> results;
+  for (unsigned thread_count : {1, 3}) {
+    SetParallelThreadCount(thread_count);
+    results.push_back(OptimizeEfficiency(topology, /*iteration_count=*/500,
+                                         PhiloxEngine(13),
+                                         /*speculation_count=*/4));
+  }
+  SetParallelThreadCount(0);
+
+  BOOST_CHECK_EQUAL(results[0].score, results[1].score);
+  BOOST_CHECK_EQUAL(boost::num_edges(results[0].topology),
+                    boost::num_edges(results[1].topology));
+  for (auto [current, end] = boost::edges(results[0].topology);
+       current != end; ++current) {
+    BOOST_CHECK(boost::edge(current->m_source, current->m_target,
+                            results[1].topology)
+                    .second);
+  }
+}
+
 } // namespace
 } // namespace procedural
 } // namespace e8
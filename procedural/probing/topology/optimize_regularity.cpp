@@ -15,15 +15,20 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/topology/optimize_regularity.hpp"
+#include "procedural/probing/parallel/parallel.hpp"
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/edge_set.hpp"
+#include "procedural/probing/topology/hill_climb.hpp"
 #include "procedural/probing/topology/mutation_regularity.hpp"
 #include "procedural/probing/topology/objective_regularity.hpp"
 #include <algorithm>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/log/trivial.hpp>
 #include <cmath>
-#include <random>
+#include <optional>
+#include <utility>
+#include <vector>
 
 namespace e8 {
 namespace procedural {
@@ -46,35 +51,63 @@ void ReportProgress(unsigned i, unsigned iteration_count, float score,
                           << edge_count;
 }
 
+// The objective policy of HillClimb(), which climbs the topology along with
+// its regularity score map.
+class RegularityObjectivePolicy {
+public:
+  RegularityObjectivePolicy(VertexStore const &vertices, float score,
+                            Topology *topology, RegularityScoreMap *score_map)
+      : vertices_(vertices), score_(score), topology_(topology),
+        score_map_(score_map) {}
+
+  float Apply(Mutation &&mutation) {
+    revertible_.emplace(std::move(mutation), *score_map_, score_);
+    score_ = ApplyMutation(*revertible_, vertices_, topology_, score_map_);
+    return score_;
+  }
+
+  void Revert() {
+    score_ = RevertMutation(*revertible_, topology_, score_map_);
+  }
+
+  void ReportProgress(unsigned i, unsigned iteration_count, float score) {
+    procedural::ReportProgress(i, iteration_count,
+                               score / boost::num_vertices(*topology_),
+                               boost::num_edges(*topology_));
+  }
+
+private:
+  VertexStore const &vertices_;
+  float score_;
+  Topology *const topology_;
+  RegularityScoreMap *const score_map_;
+  std::optional<RevertibleRegularityMutation> revertible_;
+};
+
 } // namespace
 
 OptimizeRegularityResult
 OptimizeRegularity(Topology const &topology, unsigned iteration_count,
-                   std::default_random_engine *random_engine) {
-  EdgeSetState edge_set_state = CreateEdgeSetStateFor(topology, random_engine);
-  RegularityScoreMap score_map = CreateRegularityScoreMapFor(topology);
+                   PhiloxEngine random_engine) {
+  VertexStore vertices = CreateVertexStoreFor(topology);
+  std::vector<Edge> edges;
+  RegularityScoreMap score_map;
+  ParallelInvoke({
+      [&topology, &edges] { edges = EdgesOf(topology); },
+      [&topology, &vertices, &score_map] {
+        score_map = CreateRegularityScoreMapFor(topology, vertices);
+      },
+  });
+  EdgeSetState edge_set_state(std::move(edges));
 
   float best_score = EvaluateRegularityObjective(score_map);
   Topology best_result = topology;
 
-  for (unsigned i = 0; i < iteration_count; ++i) {
-    unsigned operation_count = kMutationCount;
-    ReportProgress(i, iteration_count,
-                   best_score / boost::num_vertices(topology),
-                   boost::num_edges(best_result));
-
-    Mutation mutation = edge_set_state.Mutate(operation_count);
-    RevertibleRegularityMutation revertible(std::move(mutation), score_map,
-                                            best_score);
-    float new_score = ApplyMutation(revertible, &best_result, &score_map);
-    if (new_score >= best_score) {
-      best_score = new_score;
-      continue;
-    }
-
-    RevertMutation(revertible, &best_result, &score_map);
-    edge_set_state.Revert();
-  }
+  RegularityObjectivePolicy objective(vertices, best_score, &best_result,
+                                      &score_map);
+  EdgeSetMutationPolicy mutation(kMutationCount, random_engine,
+                                 &edge_set_state);
+  best_score = HillClimb(iteration_count, best_score, &objective, &mutation);
 
   return OptimizeRegularityResult{
       .topology = best_result,
@@ -16,8 +16,8 @@
 
 #pragma once
 
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
-#include <random>
 
 namespace e8 {
 namespace procedural {
@@ -35,7 +35,7 @@ struct OptimizeRegularityResult {
 // specified topology by hill climbing.
 OptimizeRegularityResult
 OptimizeRegularity(Topology const &topology, unsigned iteration_count,
-                   std::default_random_engine *random_engine);
+                   PhiloxEngine random_engine);
 
 } // namespace procedural
 } // namespace e8
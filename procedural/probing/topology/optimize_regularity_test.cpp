@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define BOOST_TEST_MAIN
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/optimize_regularity.hpp"
 #include <boost/graph/adjacency_list.hpp>
@@ -27,11 +28,20 @@ namespace {
 BOOST_AUTO_TEST_CASE(WhenTopologyIsMeshGrid_ThenCheckEdgeCountIsLess) {
   Topology topology = testing::CreateMeshTopology(/*side=*/5, /*scale=*/1e3f,
                                                   /*population=*/4e3);
-  std::default_random_engine random_engine(13);
-  OptimizeRegularityResult result =
-      OptimizeRegularity(topology, /*iteration_count=*/1000, &random_engine);
-  BOOST_CHECK_CLOSE(20, result.score, 10.f);
-  BOOST_CHECK_LT(boost::num_edges(result.topology), boost::num_edges(topology));
+
+  // Averages the scores over a few seeds, so that the check doesn't hinge on
+  // the draws of a single seed.
+  unsigned const first_seed = 13;
+  unsigned const seed_count = 8;
+  float score_sum = 0;
+  for (unsigned seed = first_seed; seed < first_seed + seed_count; ++seed) {
+    OptimizeRegularityResult result = OptimizeRegularity(
+        topology, /*iteration_count=*/1000, PhiloxEngine(seed));
+    BOOST_CHECK_LT(boost::num_edges(result.topology),
+                   boost::num_edges(topology));
+    score_sum += result.score;
+  }
+  BOOST_CHECK_CLOSE(20, score_sum / seed_count, 10.f);
 }
 
 } // namespace
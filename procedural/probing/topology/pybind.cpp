@@ -40,7 +40,13 @@ void RegisterProbeTopology(pybind11::module *m) {
 
   // Function.
   m->def("ComputeProbeTopology", &ComputeProbeTopology,
-         pybind11::return_value_policy::copy);
+         pybind11::return_value_policy::copy, pybind11::arg("probes"),
+         pybind11::arg("regularity_optimization_steps"),
+         pybind11::arg("efficiency_optimization_steps"),
+         pybind11::arg("lattice_grid_size") = 0.0f,
+         pybind11::arg("reorder_probes") = false,
+         pybind11::arg("efficiency_speculation_count") = 1,
+         pybind11::arg("delaunay_tile_size") = 0.0f);
 }
 
 } // namespace procedural
@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/topology/sampler.hpp"
+#include "procedural/probing/random/philox.hpp"
 #include <algorithm>
 #include <boost/graph/adjacency_list.hpp>
 #include <cassert>
@@ -31,26 +32,42 @@ using SourceFrequency = unsigned;
 
 float const kCdfMaxError = 1e-3f;
 
-std::vector<float> VertexPmf(Topology const &topology) {
+std::vector<float> VertexImportance(Topology const &topology) {
   unsigned vertex_count = boost::num_vertices(topology);
   assert(vertex_count > 0);
 
-  std::vector<float> pmf(vertex_count);
+  std::vector<float> importance(vertex_count);
   for (unsigned i = 0; i < vertex_count; ++i) {
     assert(topology[i].importance >= 0 && topology[i].importance <= 1);
-    pmf[i] = topology[i].importance;
+    importance[i] = topology[i].importance;
+  }
+  return importance;
+}
+
+std::vector<float> VertexPmf(std::vector<float> const &weights) {
+  assert(!weights.empty());
+
+  float total_weight = 0;
+  for (float weight : weights) {
+    assert(weight >= 0);
+    total_weight += weight;
+  }
+  assert(total_weight > 0);
+
+  std::vector<float> pmf(weights.size());
+  for (unsigned i = 0; i < weights.size(); ++i) {
+    pmf[i] = weights[i] / total_weight;
   }
   return pmf;
 }
 
-std::vector<float> VertexCdf(Topology const &topology) {
-  unsigned vertex_count = boost::num_vertices(topology);
-  assert(vertex_count);
+std::vector<float> VertexCdf(std::vector<float> const &pmf) {
+  assert(!pmf.empty());
 
-  std::vector<float> cdf(vertex_count);
-  cdf[0] = topology[0].importance;
-  for (unsigned i = 1; i < vertex_count; ++i) {
-    cdf[i] = cdf[i - 1] + topology[i].importance;
+  std::vector<float> cdf(pmf.size());
+  cdf[0] = pmf[0];
+  for (unsigned i = 1; i < pmf.size(); ++i) {
+    cdf[i] = cdf[i - 1] + pmf[i];
   }
 
   assert(std::abs(cdf.back() - 1.0f) < kCdfMaxError);
@@ -59,7 +76,7 @@ std::vector<float> VertexCdf(Topology const &topology) {
 
 unsigned NextImportanceSample(std::vector<float> const &vertex_cdf,
                               std::uniform_real_distribution<float> &unif,
-                              std::default_random_engine *random_engine) {
+                              PhiloxEngine *random_engine) {
   float u = unif(*random_engine);
   auto it = std::lower_bound(vertex_cdf.begin(), vertex_cdf.end(), u);
 
@@ -103,15 +120,16 @@ unsigned SourceSamplerInterface::PopulationCount() const {
 
 SourceUniformSampler::SourceUniformSampler(
     Topology const &topology, unsigned sample_count,
-    std::default_random_engine *random_engine)
+    PhiloxEngine random_engine)
     : SourceSamplerInterface(/*population_count=*/boost::num_vertices(topology),
                              sample_count),
-      random_engine_(random_engine),
+      random_engine_(random_engine), update_count_(0),
       unif_(0, boost::num_vertices(topology) - 1) {}
 
 void SourceUniformSampler::UpdateSamples() {
+  PhiloxEngine random_engine = random_engine_.Substream(update_count_++);
   std::unordered_map<unsigned, unsigned> sample_frequency = GenerateSamples(
-      sample_count_, [this] { return this->unif_(*this->random_engine_); });
+      sample_count_, [this, &random_engine] { return unif_(random_engine); });
 
   samples_.clear();
   std::transform(sample_frequency.begin(), sample_frequency.end(),
@@ -124,17 +142,24 @@ void SourceUniformSampler::UpdateSamples() {
 
 SourceImportanceSampler::SourceImportanceSampler(
     Topology const &topology, unsigned sample_count,
-    std::default_random_engine *random_engine)
-    : SourceSamplerInterface(/*population_count=*/boost::num_vertices(topology),
+    PhiloxEngine random_engine)
+    : SourceImportanceSampler(VertexImportance(topology), sample_count,
+                              random_engine) {}
+
+SourceImportanceSampler::SourceImportanceSampler(
+    std::vector<float> const &weights, unsigned sample_count,
+    PhiloxEngine random_engine)
+    : SourceSamplerInterface(/*population_count=*/weights.size(),
                              sample_count),
-      vertex_pmf_(VertexPmf(topology)), vertex_cdf_(VertexCdf(topology)),
-      random_engine_(random_engine), unif_(0, 1) {}
+      vertex_pmf_(VertexPmf(weights)), vertex_cdf_(VertexCdf(vertex_pmf_)),
+      random_engine_(random_engine), update_count_(0), unif_(0, 1) {}
 
 void SourceImportanceSampler::UpdateSamples() {
+  PhiloxEngine random_engine = random_engine_.Substream(update_count_++);
   std::unordered_map<unsigned, unsigned> sample_frequency =
-      GenerateSamples(sample_count_, [this] {
+      GenerateSamples(sample_count_, [this, &random_engine] {
         return NextImportanceSample(this->vertex_cdf_, this->unif_,
-                                    this->random_engine_);
+                                    &random_engine);
       });
 
   samples_.clear();
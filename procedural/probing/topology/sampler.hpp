@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include <random>
 #include <vector>
@@ -68,27 +69,36 @@ protected:
   std::vector<Sample> samples_;
 };
 
-// This sampler generates vertex samples uniformly over the topology.
+// This sampler generates vertex samples uniformly over the topology. The n-th
+// update draws from the n-th substream of the random engine.
 class SourceUniformSampler final : public SourceSamplerInterface {
 public:
   SourceUniformSampler(Topology const &topology, unsigned sample_count,
-                       std::default_random_engine *random_engine);
+                       PhiloxEngine random_engine);
   ~SourceUniformSampler() override = default;
 
   // O(s), where s is the sample size
   void UpdateSamples() override;
 
 private:
-  std::default_random_engine *const random_engine_;
+  PhiloxEngine const random_engine_;
+  unsigned update_count_;
   std::uniform_int_distribution<unsigned> unif_;
 };
 
 // This sampler generates vertex samples based on vertex importance. The
-// probability a vertex being sampled is it's importance.
+// probability a vertex being sampled is it's importance. Like the above, the
+// n-th update draws from the n-th substream of the random engine.
 class SourceImportanceSampler final : public SourceSamplerInterface {
 public:
   SourceImportanceSampler(Topology const &topology, unsigned sample_count,
-                          std::default_random_engine *random_engine);
+                          PhiloxEngine random_engine);
+
+  // Samples the vertices in proportion to the non-negative weights instead,
+  // e.g. their population.
+  SourceImportanceSampler(std::vector<float> const &weights,
+                          unsigned sample_count,
+                          PhiloxEngine random_engine);
   ~SourceImportanceSampler() override = default;
 
   // O(s*log(n)), where s is the sample count, and n is the vertex count.
@@ -97,7 +107,8 @@ public:
 private:
   std::vector<float> const vertex_pmf_;
   std::vector<float> const vertex_cdf_;
-  std::default_random_engine *const random_engine_;
+  PhiloxEngine const random_engine_;
+  unsigned update_count_;
   std::uniform_real_distribution<float> unif_;
 };
 
@@ -15,10 +15,10 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define BOOST_TEST_MAIN
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/sampler.hpp"
 #include <boost/test/unit_test.hpp>
-#include <random>
 #include <vector>
 
 namespace e8 {
@@ -28,6 +28,11 @@ namespace {
 unsigned const kSourceCount = 100;
 unsigned const kSampleCount = 10;
 
+// The estimates are averaged over the streams of a few seeds, so that the
+// checks don't hinge on the draws of a single seed.
+unsigned const kFirstSeed = 13;
+unsigned const kSeedCount = 8;
+
 float ValueOf(unsigned vertex_index) { return vertex_index; }
 
 Topology CreateSources(unsigned source_count) {
@@ -67,30 +72,60 @@ float EstimatedAverageValue(SourceSamplerInterface *sampler,
   return estimate_sum / num_experiments;
 }
 
+template <typename CreateSampler>
+float SeedAveragedValue(CreateSampler const &create_sampler,
+                        unsigned num_experiments) {
+  double estimate_sum = 0;
+  for (unsigned seed = kFirstSeed; seed < kFirstSeed + kSeedCount; ++seed) {
+    auto sampler = create_sampler(PhiloxEngine(seed));
+    BOOST_CHECK_EQUAL(kSourceCount, sampler.PopulationCount());
+    estimate_sum +=
+        EstimatedAverageValue(&sampler, kSourceCount, num_experiments);
+  }
+  return estimate_sum / kSeedCount;
+}
+
 float TrueAverageValue(unsigned source_count) {
   return (ValueOf(0) + ValueOf(source_count - 1)) / 2.0f;
 }
 
 BOOST_AUTO_TEST_CASE(CheckUniformSamplerBiasIsZero) {
   Topology sources = CreateSources(kSourceCount);
-  std::default_random_engine random_engine(/*seed=*/13U);
-  SourceUniformSampler sampler(sources, kSampleCount, &random_engine);
-  BOOST_CHECK_EQUAL(kSourceCount, sampler.PopulationCount());
-  BOOST_CHECK_CLOSE(
-      TrueAverageValue(kSourceCount),
-      EstimatedAverageValue(&sampler, kSourceCount, /*num_experiments=*/1000),
-      1);
+  BOOST_CHECK_CLOSE(TrueAverageValue(kSourceCount),
+                    SeedAveragedValue(
+                        [&sources](PhiloxEngine const &random_engine) {
+                          return SourceUniformSampler(sources, kSampleCount,
+                                                      random_engine);
+                        },
+                        /*num_experiments=*/1000),
+                    1);
 }
 
 BOOST_AUTO_TEST_CASE(CheckImportanceSamplerBiasIsZero) {
   Topology sources = CreateSources(kSourceCount);
-  std::default_random_engine random_engine(/*seed=*/13U);
-  SourceImportanceSampler sampler(sources, kSampleCount, &random_engine);
-  BOOST_CHECK_EQUAL(kSourceCount, sampler.PopulationCount());
-  BOOST_CHECK_CLOSE(
-      TrueAverageValue(kSourceCount),
-      EstimatedAverageValue(&sampler, kSourceCount, /*num_experiments=*/100),
-      1);
+  BOOST_CHECK_CLOSE(TrueAverageValue(kSourceCount),
+                    SeedAveragedValue(
+                        [&sources](PhiloxEngine const &random_engine) {
+                          return SourceImportanceSampler(sources, kSampleCount,
+                                                         random_engine);
+                        },
+                        /*num_experiments=*/100),
+                    1);
+}
+
+BOOST_AUTO_TEST_CASE(CheckWeightedImportanceSamplerBiasIsZero) {
+  std::vector<float> weights(kSourceCount);
+  for (unsigned i = 0; i < kSourceCount; ++i) {
+    weights[i] = 1e3f * ValueOf(i);
+  }
+  BOOST_CHECK_CLOSE(TrueAverageValue(kSourceCount),
+                    SeedAveragedValue(
+                        [&weights](PhiloxEngine const &random_engine) {
+                          return SourceImportanceSampler(weights, kSampleCount,
+                                                         random_engine);
+                        },
+                        /*num_experiments=*/100),
+                    1);
 }
 
 BOOST_AUTO_TEST_CASE(CheckPopulationSamplerReturnsThePopulation) {
@@ -15,13 +15,14 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/topology/topology.hpp"
+#include "procedural/probing/probe/ordering.hpp"
 #include "procedural/probing/probe/probe.hpp"
+#include "procedural/probing/random/philox.hpp"
 #include "procedural/probing/topology/definition.hpp"
 #include "procedural/probing/topology/init.hpp"
 #include "procedural/probing/topology/optimize_efficiency.hpp"
 #include "procedural/probing/topology/optimize_regularity.hpp"
 #include <algorithm>
-#include <random>
 #include <vector>
 
 namespace e8 {
@@ -29,13 +30,32 @@ namespace procedural {
 namespace {
 
 unsigned long const kSeed = 13L;
+float const kDelaunayTileMarginMeters = 2000.0f;
+unsigned const kLatticeMaxAxisGap = 2;
 
-std::vector<ProbeConnection> ToProbeConnection(Topology const &topology) {
+Topology CreateInitialTopology(std::vector<PopulationProbe> const &probes,
+                               float lattice_grid_size,
+                               float delaunay_tile_size) {
+  if (lattice_grid_size > 0) {
+    return CreateLatticeTopology(probes, lattice_grid_size,
+                                 kLatticeMaxAxisGap);
+  }
+  if (delaunay_tile_size > 0) {
+    return CreateTiledDelaunayTopology(
+        probes, delaunay_tile_size,
+        std::min(kDelaunayTileMarginMeters, delaunay_tile_size));
+  }
+  return CreateDelaunayTopology(probes);
+}
+
+std::vector<ProbeConnection> ToProbeConnection(Topology const &topology,
+                                               ProbeOrdering const &ordering) {
   auto [edge_it, _] = boost::edges(topology);
 
   std::vector<ProbeConnection> result(boost::num_edges(topology));
   for (auto &result_edge : result) {
-    result_edge = ProbeConnection(edge_it->m_source, edge_it->m_target);
+    result_edge = ProbeConnection(ordering.to_original[edge_it->m_source],
+                                  ordering.to_original[edge_it->m_target]);
     ++edge_it;
   }
 
@@ -47,16 +67,25 @@ std::vector<ProbeConnection> ToProbeConnection(Topology const &topology) {
 ProbeTopologyResult
 ComputeProbeTopology(std::vector<PopulationProbe> const &probes,
                      unsigned regularity_optimization_steps,
-                     unsigned efficiency_optimization_steps) {
-  Topology initial_topology = CreateDelaunayTopology(probes);
-  std::default_random_engine random_engine(kSeed);
-  OptimizeRegularityResult regularized_result = OptimizeRegularity(
-      initial_topology, regularity_optimization_steps, &random_engine);
-  OptimizeEfficiencyResult optimization_result =
-      OptimizeEfficiency(regularized_result.topology,
-                         efficiency_optimization_steps, &random_engine);
+                     unsigned efficiency_optimization_steps,
+                     float lattice_grid_size, bool reorder_probes,
+                     unsigned efficiency_speculation_count,
+                     float delaunay_tile_size) {
+  ProbeOrdering ordering = reorder_probes ? HilbertCurveOrdering(probes)
+                                          : IdentityOrdering(probes.size());
+  Topology initial_topology = CreateInitialTopology(
+      ReorderProbes(probes, ordering), lattice_grid_size, delaunay_tile_size);
+  // Each stage draws from its own stream, so changing the number of steps of
+  // one stage leaves the draws of the other unchanged.
+  PhiloxEngine random_engine(kSeed);
+  OptimizeRegularityResult regularized_result =
+      OptimizeRegularity(initial_topology, regularity_optimization_steps,
+                         random_engine.Fork(/*stream=*/0));
+  OptimizeEfficiencyResult optimization_result = OptimizeEfficiency(
+      regularized_result.topology, efficiency_optimization_steps,
+      random_engine.Fork(/*stream=*/1), efficiency_speculation_count);
   return ProbeTopologyResult{
-      .connections = ToProbeConnection(optimization_result.topology),
+      .connections = ToProbeConnection(optimization_result.topology, ordering),
       .score = optimization_result.score,
   };
 }
@@ -44,11 +44,25 @@ struct ProbeTopologyResult {
 };
 
 // It computes the connections amongst the specified population probes in a way
-// that the transportation between any two probes is reasonably efficient.
+// that the transportation between any two probes is reasonably efficient. When
+// lattice_grid_size is positive, the probes are assumed to be snapped to a
+// square lattice of that size, and the initial candidate connections are built
+// from the lattice neighbors instead of a Delaunay triangulation. When
+// reorder_probes is set, the probes are internally permuted along a Hilbert
+// curve for memory locality. The resulting connections always refer to the
+// caller's probe indices. Every efficiency optimization step evaluates
+// efficiency_speculation_count mutations concurrently, see
+// OptimizeEfficiency(). When delaunay_tile_size is positive, the Delaunay
+// triangulation is approximated by triangulating tiles of that size in
+// meters, which bounds its memory on large regions, see
+// CreateTiledDelaunayTopology().
 ProbeTopologyResult
 ComputeProbeTopology(std::vector<PopulationProbe> const &probes,
                      unsigned regularity_optimization_steps,
-                     unsigned efficiency_optimization_steps);
+                     unsigned efficiency_optimization_steps,
+                     float lattice_grid_size = 0, bool reorder_probes = false,
+                     unsigned efficiency_speculation_count = 1,
+                     float delaunay_tile_size = 0);
 
 } // namespace procedural
 } // namespace e8
@@ -15,6 +15,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "procedural/probing/flow/pybind.hpp"
+#include "procedural/probing/parallel/pybind.hpp"
 #include "procedural/probing/probe/pybind.hpp"
 #include "procedural/probing/topology/pybind.hpp"
 #include <pybind11/pybind11.h>
@@ -23,4 +24,5 @@ PYBIND11_MODULE(e8citydll, m) {
   e8::procedural::RegisterPopulationProbe(&m);
   e8::procedural::RegisterProbeTopology(&m);
   e8::procedural::RegisterFlowTopology(&m);
+  e8::procedural::RegisterParallel(&m);
 }